@@ -5,8 +5,11 @@
 
 #include <boost/interprocess/sync/scoped_lock.hpp>
 #include <boost/thread/thread.hpp>
+#include <boost/atomic.hpp>
 #include <boost/foreach.hpp>
 #include <boost/lexical_cast.hpp>
+#include <fstream>
+#include <mutex>
 #include <cpprest/uri.h>
 #include <cpprest/json.h>
 #include <cpprest/http_client.h>
@@ -24,6 +27,9 @@ TimeSeriesDuplicator::TimeSeriesDuplicator() {
   _isRunning = false;
   _shouldRun = true;
   _pctCompleteFetch = 0;
+  _sourceConcurrency = 1;
+  _rescanWindow = 0;
+  _backfillConcurrency = 1;
   logLevel = RTX_DUPLICATOR_LOGLEVEL_INFO;
 }
 
@@ -56,6 +62,7 @@ void TimeSeriesDuplicator::_refreshDestinations() {
   {
     scoped_lock<boost::signals2::mutex> mx(_mutex);
     _destinationSeries.clear();
+    _highWater.clear();
     
     for(TimeSeries::_sp source : _sourceSeries) {
       // make a simple modular ts
@@ -69,6 +76,39 @@ void TimeSeriesDuplicator::_refreshDestinations() {
 }
 
 
+void TimeSeriesDuplicator::setSourceConcurrency(int nThreads) {
+  _sourceConcurrency = (nThreads > 0) ? nThreads : 1;
+}
+
+int TimeSeriesDuplicator::sourceConcurrency() {
+  return _sourceConcurrency;
+}
+
+void TimeSeriesDuplicator::setRescanWindow(time_t seconds) {
+  _rescanWindow = (seconds > 0) ? seconds : 0;
+}
+
+time_t TimeSeriesDuplicator::rescanWindow() {
+  return _rescanWindow;
+}
+
+void TimeSeriesDuplicator::setBackfillConcurrency(int nThreads) {
+  _backfillConcurrency = (nThreads > 0) ? nThreads : 1;
+}
+
+int TimeSeriesDuplicator::backfillConcurrency() {
+  return _backfillConcurrency;
+}
+
+void TimeSeriesDuplicator::setCheckpointFile(const std::string& path) {
+  _checkpointFile = path;
+}
+
+std::string TimeSeriesDuplicator::checkpointFile() {
+  return _checkpointFile;
+}
+
+
 void TimeSeriesDuplicator::catchUpAndRun(time_t fetchWindow, time_t frequency, time_t backfill, time_t lag, time_t chunkSize, time_t rateLimit) {
   boost::thread t(&TimeSeriesDuplicator::_catchupLoop, this, fetchWindow, frequency, backfill, lag, chunkSize, rateLimit);
   _dupeBackground.swap(t);
@@ -134,7 +174,8 @@ void TimeSeriesDuplicator::_dupeLoop(time_t win, time_t freq, time_t lag) {
       
       _isRunning = true;
       
-      pair<time_t,int> fetchRes = this->_fetchAll(nextFetch - win, nextFetch);
+      // only what is new since the last pass (plus the re-scan window), but never more than a full window.
+      pair<time_t,int> fetchRes = this->_fetchIncremental(nextFetch - win, nextFetch);
       time_t fetchDuration = fetchRes.first;
       int nPoints = fetchRes.second;
       if (saveMetrics) {
@@ -209,55 +250,118 @@ void TimeSeriesDuplicator::_backfillLoop(time_t start, time_t lag, time_t chunk,
     metricsTimeElapased->setRecord(_destinationRecord);
   }
   
-  time_t nextFetch = start + chunk;
   _shouldRun = true;
   
+  if (chunk <= 0) {
+    _logLine("invalid chunk size", RTX_DUPLICATOR_LOGLEVEL_ERROR);
+    return;
+  }
+  
+  vector<TimeSeries::_sp> sources, destinations;
+  {
+    scoped_lock<boost::signals2::mutex> mx(_mutex);
+    sources = _sourceSeries;
+    destinations = _destinationSeries;
+  }
+  
+  const time_t end = time(NULL) - lag;
+  map<string,time_t> checkpoints = this->_loadCheckpoints();
+  
+  // each series starts where its checkpoint says it left off.
+  vector<time_t> seriesStart;
+  size_t nChunksTotal = 0;
+  for (TimeSeries::_sp ts : destinations) {
+    time_t from = start;
+    auto found = checkpoints.find(ts->name());
+    if (found != checkpoints.end() && found->second > from) {
+      from = found->second;
+    }
+    seriesStart.push_back(from);
+    if (from < end) {
+      nChunksTotal += (size_t)((end - from + chunk - 1) / chunk);
+    }
+  }
+  
   stringstream s;
   s << "Starting catchup from " << start << " in " << chunk << "second chunks";
+  if (!checkpoints.empty()) {
+    s << " (resuming " << checkpoints.size() << " series from checkpoint)";
+  }
   this->_logLine(s.str(),RTX_DUPLICATOR_LOGLEVEL_INFO);
   
-  bool inThePast = start < time(NULL) - lag;
-  
   _pctCompleteFetch = 0.;
+  _isRunning = true;
   
-  while (_shouldRun && inThePast) {
-    time_t thisLoop = time(NULL) - lag;
-    _isRunning = true;
-    time_t fetchEndTime = nextFetch;
-    if (nextFetch > thisLoop) {
-      fetchEndTime = thisLoop;
-      inThePast = false;
-    }
-    
-    pair<time_t,int> fetchRes = this->_fetchAll(nextFetch - chunk, fetchEndTime, false);
-    time_t fetchDuration = fetchRes.first;
-    int nPoints = fetchRes.second;
-    
-    nextFetch += chunk;
-    
-    _pctCompleteFetch = (double)(nextFetch - start) / (double)(thisLoop - start) ;
-    
-    char *tstr = asctime(localtime(&fetchEndTime));
-    tstr[24] = '\0';
-    stringstream ss;
-    ss << "RETROSPECTIVE Fetch: (" << tstr << ") " << nPoints << " points in " << fetchDuration << " seconds.";
-    this->_logLine(ss.str(), RTX_DUPLICATOR_LOGLEVEL_INFO);
-    if (rateLimit > 0 && inThePast) {
-      ss.clear();
-      ss << "\nRate Limited - Waiting for " << rateLimit << " seconds";
-      this->_logLine(ss.str(), RTX_DUPLICATOR_LOGLEVEL_VERBOSE);
-    }
-    
-    if (saveMetrics) {
-      metricsPointCount->insert(Point(time(NULL), (double)nPoints));
-      metricsTimeElapased->insert(Point(time(NULL), (double)fetchDuration));
-    }
-    
-    time_t wakeup = time(NULL) + rateLimit;
-    while (_shouldRun && rateLimit > 0 && wakeup > time(NULL) && inThePast) {
+  // rateLimit is the minimum spacing between chunk queries against any one source record.
+  std::mutex stateMtx;
+  map<PointRecord::_sp, time_t> nextAllowed;
+  size_t nChunksDone = 0;
+  
+  auto waitForTurn = [&](PointRecord::_sp record) -> bool {
+    while (_shouldRun) {
+      {
+        std::lock_guard<std::mutex> lock(stateMtx);
+        time_t now = time(NULL);
+        if (nextAllowed[record] <= now) {
+          nextAllowed[record] = now + rateLimit;
+          return true;
+        }
+      }
       boost::this_thread::sleep_for(boost::chrono::seconds(1));
     }
+    return false;
+  };
+  
+  // workers take whole series; a series' chunks are copied in order so that its checkpoint is a single time.
+  boost::atomic<size_t> next(0);
+  boost::thread_group workers;
+  int nWorkers = _backfillConcurrency;
+  for (int iWorker = 0; iWorker < nWorkers; ++iWorker) {
+    workers.create_thread([&]() {
+      size_t iSeries;
+      while (_shouldRun && (iSeries = next++) < destinations.size()) {
+        TimeSeries::_sp dest = destinations.at(iSeries);
+        PointRecord::_sp sourceRecord = sources.at(iSeries)->rootTimeSeries()->record();
+        
+        for (time_t chunkStart = seriesStart.at(iSeries); chunkStart < end; chunkStart += chunk) {
+          if (rateLimit > 0 && !waitForTurn(sourceRecord)) {
+            break;
+          }
+          if (!_shouldRun) {
+            break;
+          }
+          time_t chunkEnd = std::min(chunkStart + chunk, end);
+          time_t fStart = time(NULL);
+          int nPoints = 0;
+          try {
+            dest->resetCache();
+            nPoints = (int)dest->pointCollection(TimeRange(chunkStart, chunkEnd)).count();
+          } catch (const std::exception &e) {
+            this->_logLine(dest->name() + " : " + e.what(), RTX_DUPLICATOR_LOGLEVEL_WARN);
+            break; // leave the checkpoint where it is, so this chunk is retried next time.
+          }
+          time_t fetchDuration = time(NULL) - fStart;
+          
+          std::lock_guard<std::mutex> lock(stateMtx);
+          checkpoints[dest->name()] = chunkEnd;
+          this->_saveCheckpoints(checkpoints);
+          ++nChunksDone;
+          _pctCompleteFetch = (double)nChunksDone / (double)nChunksTotal;
+          
+          char *tstr = asctime(localtime(&chunkEnd));
+          tstr[24] = '\0';
+          stringstream ss;
+          ss << "RETROSPECTIVE Fetch: " << dest->name() << " (" << tstr << ") " << nPoints << " points in " << fetchDuration << " seconds.";
+          this->_logLine(ss.str(), RTX_DUPLICATOR_LOGLEVEL_VERBOSE);
+          if (saveMetrics) {
+            metricsPointCount->insert(Point(time(NULL), (double)nPoints));
+            metricsTimeElapased->insert(Point(time(NULL), (double)fetchDuration));
+          }
+        }
+      }
+    });
   }
+  workers.join_all();
   
   // outside the loop means it was cancelled by user.
   _isRunning = false;
@@ -265,11 +369,91 @@ void TimeSeriesDuplicator::_backfillLoop(time_t start, time_t lag, time_t chunk,
   if (!_shouldRun) {
     _logLine("Stopped Duplication by User Request", RTX_DUPLICATOR_LOGLEVEL_INFO);
   }
+  else {
+    stringstream ss;
+    ss << "RETROSPECTIVE complete: " << nChunksDone << " of " << nChunksTotal << " chunks copied.";
+    _logLine(ss.str(), RTX_DUPLICATOR_LOGLEVEL_INFO);
+  }
   
 }
 
 
+map<string,time_t> TimeSeriesDuplicator::_loadCheckpoints() {
+  map<string,time_t> checkpoints;
+  if (_checkpointFile.empty()) {
+    return checkpoints;
+  }
+  ifstream in(_checkpointFile);
+  string line;
+  while (getline(in, line)) {
+    // name <tab> completed-through time. names may contain anything but a tab.
+    size_t tab = line.rfind('\t');
+    if (tab == string::npos) {
+      continue;
+    }
+    try {
+      checkpoints[line.substr(0, tab)] = boost::lexical_cast<time_t>(line.substr(tab + 1));
+    } catch (const boost::bad_lexical_cast&) {
+      _logLine("ignoring malformed checkpoint line: " + line, RTX_DUPLICATOR_LOGLEVEL_WARN);
+    }
+  }
+  return checkpoints;
+}
+
+void TimeSeriesDuplicator::_saveCheckpoints(const std::map<std::string,time_t>& checkpoints) {
+  if (_checkpointFile.empty()) {
+    return;
+  }
+  // write aside and rename, so a crash mid-write leaves the previous checkpoint intact.
+  string tmpPath = _checkpointFile + ".tmp";
+  {
+    ofstream out(tmpPath, ios::trunc);
+    for (auto& cp : checkpoints) {
+      out << cp.first << '\t' << cp.second << '\n';
+    }
+    if (!out.good()) {
+      _logLine("could not write checkpoint file " + tmpPath, RTX_DUPLICATOR_LOGLEVEL_WARN);
+      return;
+    }
+  }
+  if (rename(tmpPath.c_str(), _checkpointFile.c_str()) != 0) {
+    _logLine("could not replace checkpoint file " + _checkpointFile, RTX_DUPLICATOR_LOGLEVEL_WARN);
+  }
+}
+
+
 std::pair<time_t,int> TimeSeriesDuplicator::_fetchAll(time_t start, time_t end, bool updatePctComplete) {
+  size_t nSeries;
+  {
+    scoped_lock<boost::signals2::mutex> mx(_mutex);
+    nSeries = _destinationSeries.size();
+  }
+  vector<TimeRange> ranges(nSeries, TimeRange(start, end));
+  return this->_fetchRanges(ranges, updatePctComplete);
+}
+
+std::pair<time_t,int> TimeSeriesDuplicator::_fetchIncremental(time_t floor, time_t end) {
+  vector<TimeRange> ranges;
+  {
+    scoped_lock<boost::signals2::mutex> mx(_mutex);
+    for(TimeSeries::_sp ts : _destinationSeries) {
+      // first time through, pick up where a previous run left off.
+      if (_highWater.count(ts->name()) == 0) {
+        Point last = _destinationRecord->pointBefore(ts->name(), end + 1);
+        _highWater[ts->name()] = last.isValid ? last.time : 0;
+      }
+      time_t hw = _highWater[ts->name()];
+      time_t start = floor;
+      if (hw > 0 && hw - _rescanWindow > floor) {
+        start = hw - _rescanWindow;
+      }
+      ranges.push_back(TimeRange(start, end));
+    }
+  }
+  return this->_fetchRanges(ranges, true);
+}
+
+std::pair<time_t,int> TimeSeriesDuplicator::_fetchRanges(const std::vector<TimeRange>& ranges, bool updatePctComplete) {
   const time_t six_hours = 60*60*6;
   scoped_lock<boost::signals2::mutex> mx(_mutex);
   time_t fStart = time(NULL);
@@ -278,19 +462,35 @@ std::pair<time_t,int> TimeSeriesDuplicator::_fetchAll(time_t start, time_t end,
     _pctCompleteFetch = 0.;
   }
   
+  size_t nSeries = _destinationSeries.size();
+  if (ranges.size() != nSeries || nSeries == 0) {
+    return make_pair(time(NULL) - fStart, nPoints); // series changed underneath us
+  }
+  
   for(TimeSeries::_sp ts : _destinationSeries) {
     ts->resetCache();
   }
   
-  size_t nSeries = _destinationSeries.size();
+  TimeRange span = ranges.front();
+  for (const TimeRange& r : ranges) {
+    span.start = RTX_MIN(span.start, r.start);
+    span.end = RTX_MAX(span.end, r.end);
+  }
+  
   auto db = dynamic_pointer_cast<DbPointRecord>(_destinationRecord);
   if (db) {
-    db->willQuery(TimeRange(start-six_hours,end+six_hours));
+    db->willQuery(TimeRange(span.start-six_hours,span.end+six_hours));
   }
   
-  for(TimeSeries::_sp ts : _destinationSeries) {
+  // fetch source data concurrently, so the copy below only reads from source caches.
+  this->_prefetchSources(ranges);
+  
+  // write-through is serial, and batched into one bulk operation on the destination.
+  _destinationRecord->beginBulkOperation();
+  for (size_t i = 0; i < nSeries; ++i) {
+    TimeSeries::_sp ts = _destinationSeries.at(i);
     if (_shouldRun) {
-      PointCollection pc = ts->pointCollection(TimeRange(start, end));
+      PointCollection pc = ts->pointCollection(ranges.at(i));
       stringstream tsSS;
 //      tsSS << ts->name() << " : " << pc.count() << " points (max:" << pc.max() << " min:" << pc.min() << " avg:" << pc.mean() << ")";
       this->_logLine(tsSS.str(),RTX_DUPLICATOR_LOGLEVEL_VERBOSE);
@@ -298,15 +498,71 @@ std::pair<time_t,int> TimeSeriesDuplicator::_fetchAll(time_t start, time_t end,
         _pctCompleteFetch += 1./(double)nSeries;
       }
       nPoints += pc.count();
+      if (pc.count() > 0) {
+        time_t last = pc.timeRange().end;
+        if (last > _highWater[ts->name()]) {
+          _highWater[ts->name()] = last;
+        }
+      }
     }
     
   }
+  _destinationRecord->endBulkOperation();
   if (updatePctComplete) {
     _pctCompleteFetch = 1.;
   }
   return make_pair(time(NULL) - fStart, nPoints);
 }
 
+void TimeSeriesDuplicator::_prefetchSources(const std::vector<TimeRange>& ranges) {
+  // group by the record that actually serves the data
+  map<PointRecord::_sp, vector<size_t> > groups;
+  for (size_t i = 0; i < _sourceSeries.size() && i < ranges.size(); ++i) {
+    groups[_sourceSeries.at(i)->rootTimeSeries()->record()].push_back(i);
+  }
+  
+  int nWorkers = _sourceConcurrency;
+  boost::thread_group groupThreads;
+  
+  for (auto& group : groups) {
+    PointRecord::_sp record = group.first;
+    vector<size_t> members = group.second;
+    
+    groupThreads.create_thread([=,&ranges]() {
+      // one batched multi-series query, if the adapter supports it.
+      auto db = dynamic_pointer_cast<DbPointRecord>(record);
+      if (db) {
+        TimeRange span = ranges.at(members.front());
+        for (size_t m : members) {
+          span.start = RTX_MIN(span.start, ranges.at(m).start);
+          span.end = RTX_MAX(span.end, ranges.at(m).end);
+        }
+        db->willQuery(span);
+      }
+      
+      // then a bounded number of workers per record pull from a shared index.
+      boost::atomic<size_t> next(0);
+      boost::thread_group workers;
+      for (int i = 0; i < nWorkers; ++i) {
+        workers.create_thread([&]() {
+          size_t iMember;
+          while (_shouldRun && (iMember = next++) < members.size()) {
+            TimeSeries::_sp source = _sourceSeries.at(members.at(iMember));
+            try {
+              source->points(ranges.at(members.at(iMember)));
+            } catch (const std::exception &e) {
+              this->_logLine(source->name() + " : " + e.what(), RTX_DUPLICATOR_LOGLEVEL_WARN);
+            }
+          }
+        });
+      }
+      workers.join_all();
+    });
+  }
+  
+  groupThreads.join_all();
+}
+
 
 bool TimeSeriesDuplicator::isRunning() {
   return _isRunning;
@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 #include <list>
+#include <map>
 
 #define RTX_DUPLICATOR_LOGLEVEL_ERROR   0
 #define RTX_DUPLICATOR_LOGLEVEL_WARN    1
@@ -35,12 +36,24 @@ namespace RTX {
     // view / change state
     void catchUpAndRun(time_t fetchWindow, time_t frequency, time_t backfill, time_t lag, time_t chunkSize = 24*60*60, time_t rateLimit = 0);
     void run(time_t fetchWindow, time_t frequency, time_t lag); /// run starting now
-    void runRetrospective(time_t start, time_t lag, time_t retroChunkSize, time_t rateLimit = 0); // catch up to current and stop
+    void runRetrospective(time_t start, time_t lag, time_t retroChunkSize, time_t rateLimit = 0); // catch up to current and stop. rateLimit: min seconds between chunks from one source record
     void stop();
     bool isRunning();
     double pctCompleteFetch();
     void wait();
     
+    // fetching
+    void setSourceConcurrency(int nThreads); /// concurrent fetches per source record (default 1)
+    int sourceConcurrency();
+    void setRescanWindow(time_t seconds); /// continuous runs re-fetch this far behind each series' last copied point, for late-arriving data (default 0)
+    time_t rescanWindow();
+    
+    // retrospective
+    void setBackfillConcurrency(int nThreads); /// series copied at once during a backfill (default 1)
+    int backfillConcurrency();
+    void setCheckpointFile(const std::string& path); /// backfill progress is saved here, and resumed from on the next run
+    std::string checkpointFile();
+    
     // logging
     void setLoggingFunction(RTX_Duplicator_log_callback);
     RTX_Duplicator_log_callback loggingFunction();
@@ -54,6 +67,16 @@ namespace RTX {
     PointRecord::_sp _destinationRecord;
     std::vector<TimeSeries::_sp> _sourceSeries, _destinationSeries;
     std::pair<time_t,int> _fetchAll(time_t start, time_t end, bool updatePctComplete = true);
+    std::pair<time_t,int> _fetchIncremental(time_t floor, time_t end);
+    std::pair<time_t,int> _fetchRanges(const std::vector<TimeRange>& ranges, bool updatePctComplete);
+    void _prefetchSources(const std::vector<TimeRange>& ranges);
+    int _sourceConcurrency;
+    std::map<std::string, time_t> _highWater; /// last copied point time, per destination series
+    time_t _rescanWindow;
+    int _backfillConcurrency;
+    std::string _checkpointFile;
+    std::map<std::string,time_t> _loadCheckpoints();
+    void _saveCheckpoints(const std::map<std::string,time_t>& checkpoints);
     double _pctCompleteFetch;
     bool _isRunning;
     void _refreshDestinations();
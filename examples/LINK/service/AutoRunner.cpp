@@ -7,6 +7,11 @@
 
 #include "AutoRunner.hpp"
 #include <sstream>
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <algorithm>
 
 using namespace RTX;
 using namespace std;
@@ -17,6 +22,9 @@ AutoRunner::AutoRunner() {
   _is_running_token = false;
   _cancellation_token = false;
   _pct = 0;
+  _adaptive = false;
+  _nWorkers = 1;
+  _queryRate = 0;
   setMetricsCallback([](int n, int t){
     // no-op by default.
     cout << "points: " << n << " time: " << t << endl;
@@ -32,6 +40,9 @@ void AutoRunner::setSeries(std::vector<TimeSeries::_sp> series) {
     TsEntry e;
     e.series = s;
     e.lastGood = 0; // never
+    e.lastData = 0;
+    e.interval = 0;
+    e.misses = 0;
     _series.push_back(e);
   }
 }
@@ -43,6 +54,12 @@ void AutoRunner::setParams(bool smartQueries, int maxWindowSeconds, int frequenc
   _throttle = throttleSeconds;
 }
 
+void AutoRunner::setScheduling(bool adaptive, int nWorkers, double queriesPerSecond) {
+  _adaptive = adaptive;
+  _nWorkers = (nWorkers > 0) ? nWorkers : 1;
+  _queryRate = queriesPerSecond;
+}
+
 void AutoRunner::run(time_t since) {
   
   // avoid accidental LONG querys
@@ -57,7 +74,12 @@ void AutoRunner::run(time_t since) {
   }
   
   _task = std::async(launch::async, [&]() -> void {
-    this->_runLoop(_cancellation_token);
+    if (_adaptive) {
+      this->_adaptiveLoop(_cancellation_token);
+    }
+    else {
+      this->_runLoop(_cancellation_token);
+    }
   });
   
 }
@@ -194,6 +216,172 @@ void AutoRunner::_runLoop(std::atomic_bool &cancel) {
 }
 
 
+#pragma mark - adaptive scheduling
 
+void AutoRunner::_adaptiveLoop(std::atomic_bool &cancel) {
+  _is_running_token = true;
+  _pct = 0;
+  _log("Starting adaptive scheduler", RTX_AUTORUNNER_LOGLEVEL_INFO);
+  
+  // min-heap of (next due time, series index). a series is out of the heap while a worker has it.
+  typedef pair<time_t,size_t> dueEntry;
+  priority_queue<dueEntry, vector<dueEntry>, greater<dueEntry> > schedule;
+  mutex mtx;
+  condition_variable scheduleChanged;
+  
+  time_t start = time(NULL);
+  for (size_t i = 0; i < _series.size(); ++i) {
+    schedule.push(make_pair(start, i));
+  }
+  
+  // global query budget, as a token bucket.
+  const double bucketSize = std::max(_queryRate, 1.0);
+  double tokens = bucketSize;
+  auto lastRefill = chrono::steady_clock::now();
+  auto takeToken = [&]() -> bool {
+    if (_queryRate <= 0) {
+      return true;
+    }
+    while (!cancel) {
+      {
+        lock_guard<mutex> lock(mtx);
+        auto now = chrono::steady_clock::now();
+        double elapsed = chrono::duration<double>(now - lastRefill).count();
+        lastRefill = now;
+        tokens = std::min(tokens + elapsed * _queryRate, bucketSize);
+        if (tokens >= 1.0) {
+          tokens -= 1.0;
+          return true;
+        }
+      }
+      this_thread::sleep_for(shortTime);
+    }
+    return false;
+  };
+  
+  size_t nCaughtUp = 0;
+  vector<bool> caughtUp(_series.size(), false);
+  
+  auto worker = [&]() {
+    while (!cancel) {
+      size_t iSeries;
+      {
+        unique_lock<mutex> lock(mtx);
+        // wake for the earliest due series, or periodically to notice cancellation.
+        while (!cancel && (schedule.empty() || schedule.top().first > time(NULL))) {
+          scheduleChanged.wait_for(lock, shortTime);
+        }
+        if (cancel) {
+          break;
+        }
+        iSeries = schedule.top().second;
+        schedule.pop();
+      }
+      
+      time_t nextDue = time(NULL);
+      if (takeToken()) {
+        try {
+          nextDue = this->_pollAdaptive(_series[iSeries], time(NULL));
+        } catch (const std::exception &e) {
+          _log(_series[iSeries].series->name() + " : " + e.what(), RTX_AUTORUNNER_LOGLEVEL_WARN);
+          nextDue = time(NULL) + std::max(_freq, 1);
+        }
+      }
+      
+      {
+        lock_guard<mutex> lock(mtx);
+        if (!caughtUp[iSeries] && time(NULL) - _series[iSeries].lastGood <= (_window + _freq)) {
+          caughtUp[iSeries] = true;
+          ++nCaughtUp;
+          _pct = (double)nCaughtUp / (double)_series.size();
+        }
+        schedule.push(make_pair(nextDue, iSeries));
+      }
+      scheduleChanged.notify_one();
+    }
+  };
+  
+  vector<thread> workers;
+  for (int i = 0; i < _nWorkers; ++i) {
+    workers.push_back(thread(worker));
+  }
+  for (auto& t : workers) {
+    t.join();
+  }
+  
+  _logFn("Process has completed.");
+  _is_running_token = false;
+  _cancellation_token = false;
+  _pct = 0;
+}
 
-
+time_t AutoRunner::_pollAdaptive(TsEntry &e, time_t now) {
+  stringstream ss;
+  
+  // behind by more than a window: catch up one window at a time, and come straight back.
+  if (now - e.lastGood > (_window + _freq)) {
+    time_t qEnd = std::min(e.lastGood + (time_t)_window, now);
+    auto points = e.series->points(TimeRange(e.lastGood, qEnd));
+    e.lastGood = qEnd;
+    if (!points.empty()) {
+      e.lastData = std::max(e.lastData, points.back().time);
+    }
+    ss << "Backfill Operation: Fetched " << points.size() << " points for " << e.series->name();
+    _log(ss.str(), RTX_AUTORUNNER_LOGLEVEL_VERBOSE);
+    return now;
+  }
+  
+  auto points = e.series->points(TimeRange(e.lastGood, now));
+  
+  // learn the update interval from the spacing of newly seen points (exponentially weighted).
+  const double alpha = 0.3;
+  auto fresh = upper_bound(points.begin(), points.end(), Point(e.lastData), &Point::comparePointTime);
+  size_t nFresh = distance(fresh, points.end());
+  if (nFresh > 0) {
+    time_t newest = points.back().time;
+    double observed = 0;
+    if (nFresh > 1) {
+      observed = double(newest - fresh->time) / double(nFresh - 1);
+    }
+    else if (e.lastData > 0) {
+      observed = double(newest - e.lastData);
+    }
+    if (observed > 0) {
+      e.interval = (e.interval > 0) ? alpha * observed + (1. - alpha) * e.interval : observed;
+    }
+    e.lastData = newest;
+    e.misses = 0;
+  }
+  else {
+    ++e.misses;
+  }
+  
+  // polling never happens more often than _freq, and never less often than the window.
+  const time_t floorInterval = std::max(_freq, 1);
+  const time_t ceilInterval = std::max((time_t)_window, floorInterval);
+  time_t nextDue;
+  if (e.misses == 0 && e.interval > 0) {
+    nextDue = e.lastData + (time_t)e.interval;
+  }
+  else {
+    // data is late, or the cadence is not known yet. back off from the base cadence.
+    nextDue = now + (floorInterval << std::min(e.misses, 16));
+  }
+  nextDue = std::max(nextDue, now + floorInterval);
+  nextDue = std::min(nextDue, now + ceilInterval);
+  
+  if (_smart) {
+    if (points.size() > 0) {
+      e.lastGood = points.back().time;
+    }
+  }
+  else {
+    // window-length queries ending at the next poll.
+    e.lastGood = nextDue - _window;
+  }
+  
+  ss << "Fetched " << points.size() << " points for " << e.series->name() << ". Next poll in " << (nextDue - now) << "s (interval " << (int)e.interval << "s)";
+  _log(ss.str(), RTX_AUTORUNNER_LOGLEVEL_VERBOSE);
+  
+  return nextDue;
+}
@@ -26,6 +26,7 @@ namespace RTX {
     AutoRunner();
     void setSeries(std::vector<TimeSeries::_sp> series);
     void setParams(bool smartQueries, int maxWindowSeconds, int frequencySeconds, int throttleSeconds);
+    void setScheduling(bool adaptive, int nWorkers, double queriesPerSecond); /// adaptive: poll each series when it is predicted to have new data. queriesPerSecond <= 0 is unlimited.
     void run(time_t since);
     void cancel();
     void wait();
@@ -44,16 +45,24 @@ namespace RTX {
     int _window;
     int _freq;
     int _throttle;
+    bool _adaptive;
+    int _nWorkers;
+    double _queryRate;
     double _pct;
     
     class TsEntry {
     public:
       TimeSeries::_sp series;
       time_t lastGood;
+      time_t lastData;  // time of the newest point seen
+      double interval;  // learned update interval (seconds)
+      int misses;       // consecutive polls with no new data
     };
     std::vector<TsEntry> _series;
     
     void _runLoop(std::atomic_bool& cancel);
+    void _adaptiveLoop(std::atomic_bool& cancel);
+    time_t _pollAdaptive(TsEntry& e, time_t now);
     void _log(std::string msg, int msgLevel);
     
   };
@@ -0,0 +1,623 @@
+//
+//  LinkBinarySerialization.cpp
+//  LINK-service
+//
+
+#include "LinkBinarySerialization.hpp"
+#include "rtxExceptions.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace RTX;
+using namespace std;
+
+/*
+ snapshot layout. all integers little-endian, doubles as their IEEE-754 bit pattern.
+
+ "RTXG" | u32 version | u32 object count | objects... | u32 root count | u32 root ids...
+
+ each object is a u8 type tag followed by its fields. references to other objects are u32 ids:
+ zero is null, otherwise the 1-based position in the object table. an object only ever refers
+ to objects that come before it, so loading is a single pass.
+ */
+static const char _snapshotMagic[4] = {'R','T','X','G'};
+static const uint32_t _snapshotVersion = 1;
+
+namespace {
+  enum BinaryTag : uint8_t {
+    tagClock = 1,
+    tagTimeSeries,
+    tagFilter,
+    tagConstant,
+    tagOffset,
+    tagGain,
+    tagMultiplier,
+    tagMovingAverage,
+    tagDerivative,
+    tagValidRange,
+    tagThreshold,
+    tagLag,
+    tagInversion,
+    tagIntegrator,
+    tagStats,
+    tagFailover,
+    tagMathOps,
+    tagRecord,
+    tagSqlite,
+    tagInflux,
+    tagInfluxUdp,
+    tagOdbc,
+    tagPi
+  };
+
+  void _putU8(string& b, uint8_t v) {
+    b.push_back((char)v);
+  }
+  void _putUint(string& b, uint64_t v, size_t nBytes) {
+    for (size_t i = 0; i < nBytes; ++i) {
+      b.push_back((char)((v >> (8 * i)) & 0xFF));
+    }
+  }
+  void _putU32(string& b, uint32_t v) {
+    _putUint(b, v, 4);
+  }
+  void _putI64(string& b, int64_t v) {
+    _putUint(b, (uint64_t)v, 8);
+  }
+  void _putF64(string& b, double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    _putUint(b, bits, 8);
+  }
+  void _putStr(string& b, const string& s) {
+    _putU32(b, (uint32_t)s.size());
+    b += s;
+  }
+  void _putUnits(string& b, const Units& u) {
+    b += u.encode();
+  }
+
+  template<typename T> RTX_object::_sp _newObj() {
+    return RTX_object::_sp( new T );
+  }
+
+  RTX_object::_sp _newObjectWithTag(uint8_t tag) {
+    switch (tag) {
+      case tagClock:          return _newObj<Clock>();
+      case tagTimeSeries:     return _newObj<TimeSeries>();
+      case tagFilter:         return _newObj<TimeSeriesFilter>();
+      case tagConstant:       return _newObj<ConstantTimeSeries>();
+      case tagOffset:         return _newObj<OffsetTimeSeries>();
+      case tagGain:           return _newObj<GainTimeSeries>();
+      case tagMultiplier:     return _newObj<MultiplierTimeSeries>();
+      case tagMovingAverage:  return _newObj<MovingAverage>();
+      case tagDerivative:     return _newObj<FirstDerivative>();
+      case tagValidRange:     return _newObj<ValidRangeTimeSeries>();
+      case tagThreshold:      return _newObj<ThresholdTimeSeries>();
+      case tagLag:            return _newObj<LagTimeSeries>();
+      case tagInversion:      return _newObj<InversionTimeSeries>();
+      case tagIntegrator:     return _newObj<IntegratorTimeSeries>();
+      case tagStats:          return _newObj<StatsTimeSeries>();
+      case tagFailover:       return _newObj<FailoverTimeSeries>();
+      case tagMathOps:        return _newObj<MathOpsTimeSeries>();
+      case tagRecord:         return _newObj<PointRecord>();
+      case tagSqlite:         return _newObj<SqlitePointRecord>();
+      case tagInflux:         return _newObj<InfluxDbPointRecord>();
+      case tagInfluxUdp:      return _newObj<InfluxUdpPointRecord>();
+      case tagOdbc:           return _newObj<OdbcPointRecord>();
+      case tagPi:             return _newObj<PiPointRecord>();
+      default:
+        throw RtxException("Object type not recognized: " + to_string((int)tag));
+    }
+  }
+}
+
+
+namespace RTX {
+  class BinaryGraphWriter {
+  public:
+    BinaryGraphWriter() : count(0) {};
+
+    // returns the id of the object, writing it (and anything it refers to) to the table first if needed.
+    uint32_t ref(RTX_object::_sp obj) {
+      if (!obj) {
+        return 0;
+      }
+      auto found = ids.find(obj.get());
+      if (found != ids.end()) {
+        return found->second;
+      }
+      if (open.count(obj.get())) {
+        throw RtxException("Reference cycle in object graph");
+      }
+      open.insert(obj.get());
+      SerializerBinary s(*this);
+      obj->accept(s);
+      open.erase(obj.get());
+      if (s.bytes().empty()) {
+        string desc = "Object type not supported";
+        auto ts = dynamic_pointer_cast<TimeSeries>(obj);
+        if (ts) {
+          desc += ": " + ts->name();
+        }
+        throw RtxException(desc);
+      }
+      table += s.bytes();
+      ids[obj.get()] = ++count;
+      return count;
+    }
+
+    string table;
+    uint32_t count;
+    unordered_map<RTX_object*, uint32_t> ids;
+    unordered_set<RTX_object*> open;
+  };
+
+
+  class BinaryGraphReader {
+  public:
+    BinaryGraphReader(const string& bytes) {
+      p = (const unsigned char*)bytes.data();
+      end = p + bytes.size();
+    };
+
+    size_t remaining() {
+      return (size_t)(end - p);
+    }
+    const unsigned char* take(size_t n) {
+      if (remaining() < n) {
+        throw RtxException("Snapshot is truncated");
+      }
+      const unsigned char* here = p;
+      p += n;
+      return here;
+    }
+    uint64_t uint(size_t nBytes) {
+      const unsigned char* b = take(nBytes);
+      uint64_t v = 0;
+      for (size_t i = 0; i < nBytes; ++i) {
+        v |= ((uint64_t)b[i]) << (8 * i);
+      }
+      return v;
+    }
+    uint8_t u8() {
+      return *take(1);
+    }
+    uint32_t u32() {
+      return (uint32_t)uint(4);
+    }
+    int64_t i64() {
+      return (int64_t)uint(8);
+    }
+    double f64() {
+      uint64_t bits = uint(8);
+      double d;
+      memcpy(&d, &bits, sizeof(d));
+      return d;
+    }
+    string str() {
+      uint32_t len = u32();
+      const unsigned char* b = take(len);
+      return string((const char*)b, len);
+    }
+    Units units() {
+      const unsigned char* b = take(Units::encodedSize);
+      return Units::decode(string((const char*)b, Units::encodedSize));
+    }
+    template<class T> std::shared_ptr<T> ref() {
+      uint32_t id = u32();
+      if (id == 0) {
+        return std::shared_ptr<T>();
+      }
+      if (id > objects.size()) {
+        throw RtxException("Forward or invalid reference in snapshot");
+      }
+      auto obj = dynamic_pointer_cast<T>(objects[id - 1]);
+      if (!obj) {
+        throw RtxException("Reference to an object of the wrong type in snapshot");
+      }
+      return obj;
+    }
+
+    const unsigned char *p, *end;
+    vector<RTX_object::_sp> objects;
+    // record links are made at the end, in bulk, so that each record registers its series in one go.
+    unordered_map<PointRecord*, pair<PointRecord::_sp, vector<TimeSeries::_sp> > > recordSeries;
+  };
+}
+
+
+#pragma mark Serializer
+
+string SerializerBinary::to_binary(const vector<RTX_object::_sp>& roots) {
+  BinaryGraphWriter w;
+  vector<uint32_t> rootIds;
+  rootIds.reserve(roots.size());
+  try {
+    for (auto obj : roots) {
+      rootIds.push_back(w.ref(obj));
+    }
+  } catch (const std::exception &e) {
+    cerr << "could not write binary snapshot: " << e.what() << endl;
+    return string();
+  }
+
+  string out;
+  out.reserve(w.table.size() + 16 + 4 * rootIds.size());
+  out.append(_snapshotMagic, 4);
+  _putU32(out, _snapshotVersion);
+  _putU32(out, w.count);
+  out += w.table;
+  _putU32(out, (uint32_t)rootIds.size());
+  for (uint32_t id : rootIds) {
+    _putU32(out, id);
+  }
+  return out;
+}
+
+SerializerBinary::SerializerBinary(BinaryGraphWriter& writer) : _w(writer) {
+  //**//
+}
+
+const string& SerializerBinary::bytes() {
+  return _b;
+}
+
+void SerializerBinary::visit(Clock &c) {
+  _putU8(_b, tagClock);
+  _putU32(_b, (uint32_t)c.period());
+  _putI64(_b, (int64_t)c.start());
+  _putStr(_b, c.name());
+}
+
+/******* TIMESERIES *******/
+void SerializerBinary::_series(TimeSeries &ts) {
+  _putStr(_b, ts.name());
+  _putStr(_b, ts.userDescription());
+  _putI64(_b, (int64_t)ts.expectedPeriod());
+  _putUnits(_b, ts.units());
+  // only persistent records are worth a reference. anything else is per-series scratch space.
+  _putU32(_b, _w.ref(dynamic_pointer_cast<DbPointRecord>(ts.record())));
+}
+
+// filter parameters are written first; they are restored before the source is attached,
+// and the units last, so that the loaded filter ends up exactly as configured.
+void SerializerBinary::_filter(TimeSeriesFilter &ts) {
+  _putU32(_b, _w.ref(ts.source()));
+  TimeSeries::_sp secondary;
+  TimeSeriesFilterSecondary *sec = dynamic_cast<TimeSeriesFilterSecondary*>(&ts);
+  if (sec) {
+    secondary = sec->secondary();
+  }
+  _putU32(_b, _w.ref(secondary));
+  _putU32(_b, _w.ref(ts.clock()));
+  _putU8(_b, (uint8_t)ts.resampleMode());
+  this->_series(ts);
+}
+
+void SerializerBinary::_stats(BaseStatsTimeSeries &ts) {
+  _putU32(_b, _w.ref(ts.window()));
+  _putU8(_b, (uint8_t)ts.samplingMode());
+  _putU8(_b, ts.summaryOnly() ? 1 : 0);
+}
+
+void SerializerBinary::visit(TimeSeries &ts) {
+  _putU8(_b, tagTimeSeries);
+  this->_series(ts);
+}
+void SerializerBinary::visit(TimeSeriesFilter &ts) {
+  _putU8(_b, tagFilter);
+  this->_filter(ts);
+}
+void SerializerBinary::visit(ConstantTimeSeries &ts) {
+  _putU8(_b, tagConstant);
+  _putF64(_b, ts.value());
+  _putU32(_b, _w.ref(ts.clock()));
+  this->_series(ts);
+}
+void SerializerBinary::visit(OffsetTimeSeries &ts) {
+  _putU8(_b, tagOffset);
+  _putF64(_b, ts.offset());
+  this->_filter(ts);
+}
+void SerializerBinary::visit(GainTimeSeries &ts) {
+  _putU8(_b, tagGain);
+  _putF64(_b, ts.gain());
+  _putUnits(_b, ts.gainUnits());
+  this->_filter(ts);
+}
+void SerializerBinary::visit(MultiplierTimeSeries &ts) {
+  _putU8(_b, tagMultiplier);
+  _putU8(_b, (uint8_t)ts.multiplierMode());
+  this->_filter(ts);
+}
+void SerializerBinary::visit(MovingAverage &ts) {
+  _putU8(_b, tagMovingAverage);
+  _putU32(_b, (uint32_t)ts.windowSize());
+  this->_filter(ts);
+}
+void SerializerBinary::visit(FirstDerivative &ts) {
+  _putU8(_b, tagDerivative);
+  this->_filter(ts);
+}
+void SerializerBinary::visit(ValidRangeTimeSeries &ts) {
+  _putU8(_b, tagValidRange);
+  auto range = ts.range();
+  _putF64(_b, range.first);
+  _putF64(_b, range.second);
+  _putU8(_b, (uint8_t)ts.mode());
+  this->_filter(ts);
+}
+void SerializerBinary::visit(ThresholdTimeSeries &ts) {
+  _putU8(_b, tagThreshold);
+  _putF64(_b, ts.threshold());
+  _putF64(_b, ts.value());
+  _putU8(_b, (uint8_t)ts.mode());
+  this->_filter(ts);
+}
+void SerializerBinary::visit(LagTimeSeries &ts) {
+  _putU8(_b, tagLag);
+  _putI64(_b, (int64_t)ts.offset());
+  this->_filter(ts);
+}
+void SerializerBinary::visit(InversionTimeSeries &ts) {
+  _putU8(_b, tagInversion);
+  this->_filter(ts);
+}
+void SerializerBinary::visit(IntegratorTimeSeries &ts) {
+  _putU8(_b, tagIntegrator);
+  _putU32(_b, _w.ref(ts.resetClock()));
+  this->_filter(ts);
+}
+void SerializerBinary::visit(StatsTimeSeries &ts) {
+  _putU8(_b, tagStats);
+  _putU8(_b, (uint8_t)ts.statsType());
+  _putF64(_b, ts.arbitraryPercentile());
+  this->_stats(ts);
+  this->_filter(ts);
+}
+void SerializerBinary::visit(FailoverTimeSeries &ts) {
+  _putU8(_b, tagFailover);
+  _putI64(_b, (int64_t)ts.maximumStaleness());
+  this->_filter(ts);
+}
+void SerializerBinary::visit(MathOpsTimeSeries &ts) {
+  _putU8(_b, tagMathOps);
+  _putU8(_b, (uint8_t)ts.mathOpsType());
+  _putF64(_b, ts.argument());
+  this->_filter(ts);
+}
+
+/******* POINTRECORD *******/
+void SerializerBinary::_db(DbPointRecord &pr) {
+  _putStr(_b, pr.name());
+  _putStr(_b, pr.connectionString());
+  _putU8(_b, pr.readonly() ? 1 : 0);
+}
+void SerializerBinary::visit(PointRecord &pr) {
+  _putU8(_b, tagRecord);
+  _putStr(_b, pr.name());
+}
+void SerializerBinary::visit(SqlitePointRecord &pr) {
+  _putU8(_b, tagSqlite);
+  this->_db(pr);
+}
+void SerializerBinary::visit(InfluxDbPointRecord &pr) {
+  _putU8(_b, tagInflux);
+  this->_db(pr);
+}
+void SerializerBinary::visit(InfluxUdpPointRecord &pr) {
+  _putU8(_b, tagInfluxUdp);
+  this->_db(pr);
+}
+void SerializerBinary::visit(OdbcPointRecord &pr) {
+  _putU8(_b, tagOdbc);
+  this->_db(pr);
+  _putStr(_b, pr.driver());
+  _putStr(_b, pr.metaQuery());
+  _putStr(_b, pr.rangeQuery());
+  _putU8(_b, (uint8_t)pr.timeFormat());
+}
+void SerializerBinary::visit(PiPointRecord &pr) {
+  _putU8(_b, tagPi);
+  this->_db(pr);
+  _putStr(_b, pr.tagSearchPath());
+  _putStr(_b, pr.conversions());
+}
+
+
+
+#pragma mark Deserializer
+
+vector<RTX_object::_sp> DeserializerBinary::from_binary(const string& bytes) {
+  vector<RTX_object::_sp> roots;
+  try {
+    BinaryGraphReader r(bytes);
+    if (memcmp(r.take(4), _snapshotMagic, 4) != 0) {
+      throw RtxException("Not a binary snapshot");
+    }
+    uint32_t version = r.u32();
+    if (version != _snapshotVersion) {
+      throw RtxException("Unsupported snapshot version: " + to_string(version));
+    }
+    uint32_t count = r.u32();
+    if (count > r.remaining()) {
+      throw RtxException("Snapshot is truncated");
+    }
+    r.objects.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      RTX_object::_sp obj = _newObjectWithTag(r.u8());
+      DeserializerBinary d(r);
+      obj->accept(d);
+      r.objects.push_back(obj);
+    }
+    uint32_t nRoots = r.u32();
+    if (nRoots > r.remaining()) {
+      throw RtxException("Snapshot is truncated");
+    }
+    roots.reserve(nRoots);
+    for (uint32_t i = 0; i < nRoots; ++i) {
+      roots.push_back(r.ref<RTX_object>());
+    }
+    for (auto& rs : r.recordSeries) {
+      TimeSeries::setRecordForSeries(rs.second.second, rs.second.first);
+    }
+  } catch (const std::exception &e) {
+    cerr << "could not read binary snapshot: " << e.what() << endl;
+    return vector<RTX_object::_sp>();
+  }
+  return roots;
+}
+
+DeserializerBinary::DeserializerBinary(BinaryGraphReader& reader) : _r(reader) {
+  //**//
+}
+
+void DeserializerBinary::visit(Clock &c) {
+  c.setPeriod((int)_r.u32());
+  c.setStart((time_t)_r.i64());
+  c.setName(_r.str());
+}
+
+/******* TIMESERIES *******/
+void DeserializerBinary::_series(TimeSeries &ts) {
+  ts.setName(_r.str());
+  ts.setUserDescription(_r.str());
+  ts.setExpectedPeriod((time_t)_r.i64());
+  ts.setUnits(_r.units());
+  PointRecord::_sp pr = _r.ref<PointRecord>();
+  if (pr) {
+    auto& rs = _r.recordSeries[pr.get()];
+    rs.first = pr;
+    rs.second.push_back(ts.sp());
+  }
+}
+
+void DeserializerBinary::_filter(TimeSeriesFilter &ts) {
+  TimeSeries::_sp source = _r.ref<TimeSeries>();
+  TimeSeries::_sp secondary = _r.ref<TimeSeries>();
+  Clock::_sp clock = _r.ref<Clock>();
+  ResampleMode mode = (ResampleMode)_r.u8();
+  if (source) {
+    ts.setSource(source);
+  }
+  TimeSeriesFilterSecondary *sec = dynamic_cast<TimeSeriesFilterSecondary*>(&ts);
+  if (sec && secondary) {
+    sec->setSecondary(secondary);
+  }
+  ts.setClock(clock);
+  ts.setResampleMode(mode);
+  this->_series(ts);
+}
+
+void DeserializerBinary::_stats(BaseStatsTimeSeries &ts) {
+  ts.setWindow(_r.ref<Clock>());
+  ts.setSamplingMode((BaseStatsTimeSeries::StatsSamplingMode_t)_r.u8());
+  ts.setSummaryOnly(_r.u8() != 0);
+}
+
+void DeserializerBinary::visit(TimeSeries &ts) {
+  this->_series(ts);
+}
+void DeserializerBinary::visit(TimeSeriesFilter &ts) {
+  this->_filter(ts);
+}
+void DeserializerBinary::visit(ConstantTimeSeries &ts) {
+  ts.setValue(_r.f64());
+  ts.setClock(_r.ref<Clock>());
+  this->_series(ts);
+}
+void DeserializerBinary::visit(OffsetTimeSeries &ts) {
+  ts.setOffset(_r.f64());
+  this->_filter(ts);
+}
+void DeserializerBinary::visit(GainTimeSeries &ts) {
+  ts.setGain(_r.f64());
+  ts.setGainUnits(_r.units());
+  this->_filter(ts);
+}
+void DeserializerBinary::visit(MultiplierTimeSeries &ts) {
+  ts.setMultiplierMode((MultiplierTimeSeries::MultiplierMode)_r.u8());
+  this->_filter(ts);
+}
+void DeserializerBinary::visit(MovingAverage &ts) {
+  ts.setWindowSize((int)_r.u32());
+  this->_filter(ts);
+}
+void DeserializerBinary::visit(FirstDerivative &ts) {
+  this->_filter(ts);
+}
+void DeserializerBinary::visit(ValidRangeTimeSeries &ts) {
+  double min = _r.f64();
+  double max = _r.f64();
+  ts.setRange(min, max);
+  ts.setMode((ValidRangeTimeSeries::filterMode_t)_r.u8());
+  this->_filter(ts);
+}
+void DeserializerBinary::visit(ThresholdTimeSeries &ts) {
+  ts.setThreshold(_r.f64());
+  ts.setValue(_r.f64());
+  ts.setMode((ThresholdTimeSeries::thresholdMode_t)_r.u8());
+  this->_filter(ts);
+}
+void DeserializerBinary::visit(LagTimeSeries &ts) {
+  ts.setOffset((time_t)_r.i64());
+  this->_filter(ts);
+}
+void DeserializerBinary::visit(InversionTimeSeries &ts) {
+  this->_filter(ts);
+}
+void DeserializerBinary::visit(IntegratorTimeSeries &ts) {
+  ts.setResetClock(_r.ref<Clock>());
+  this->_filter(ts);
+}
+void DeserializerBinary::visit(StatsTimeSeries &ts) {
+  ts.setStatsType((StatsTimeSeries::StatsTimeSeriesType)_r.u8());
+  ts.setArbitraryPercentile(_r.f64());
+  this->_stats(ts);
+  this->_filter(ts);
+}
+void DeserializerBinary::visit(FailoverTimeSeries &ts) {
+  ts.setMaximumStaleness((time_t)_r.i64());
+  this->_filter(ts);
+}
+void DeserializerBinary::visit(MathOpsTimeSeries &ts) {
+  ts.setMathOpsType((MathOpsTimeSeries::MathOpsTimeSeriesType)_r.u8());
+  ts.setArgument(_r.f64());
+  this->_filter(ts);
+}
+
+/******* POINTRECORD *******/
+void DeserializerBinary::_db(DbPointRecord &pr) {
+  pr.setName(_r.str());
+  pr.setConnectionString(_r.str());
+  pr.setReadonly(_r.u8() != 0);
+}
+void DeserializerBinary::visit(PointRecord &pr) {
+  pr.setName(_r.str());
+}
+void DeserializerBinary::visit(SqlitePointRecord &pr) {
+  this->_db(pr);
+}
+void DeserializerBinary::visit(InfluxDbPointRecord &pr) {
+  this->_db(pr);
+}
+void DeserializerBinary::visit(InfluxUdpPointRecord &pr) {
+  this->_db(pr);
+}
+void DeserializerBinary::visit(OdbcPointRecord &pr) {
+  this->_db(pr);
+  pr.setDriver(_r.str());
+  pr.setMetaQuery(_r.str());
+  pr.setRangeQuery(_r.str());
+  pr.setTimeFormat((PointRecordTime::time_format_t)_r.u8());
+}
+void DeserializerBinary::visit(PiPointRecord &pr) {
+  this->_db(pr);
+  pr.setTagSearchPath(_r.str());
+  pr.setConversions(_r.str());
+}
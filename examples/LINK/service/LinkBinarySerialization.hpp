@@ -0,0 +1,174 @@
+//
+//  LinkBinarySerialization.hpp
+//  LINK-service
+//
+
+#ifndef LinkBinarySerialization_hpp
+#define LinkBinarySerialization_hpp
+
+#include <string>
+#include <vector>
+
+#include "rtxMacros.h"
+
+#include "Units.h"
+#include "Clock.h"
+#include "TimeSeries.h"
+#include "TimeSeriesFilter.h"
+#include "ConcreteDbRecords.h"
+
+#include "ConstantTimeSeries.h"
+#include "OffsetTimeSeries.h"
+#include "GainTimeSeries.h"
+#include "MultiplierTimeSeries.h"
+#include "MovingAverage.h"
+#include "FirstDerivative.h"
+#include "ValidRangeTimeSeries.h"
+#include "ThresholdTimeSeries.h"
+#include "LagTimeSeries.h"
+#include "InversionTimeSeries.h"
+#include "IntegratorTimeSeries.h"
+#include "StatsTimeSeries.h"
+#include "FailoverTimeSeries.h"
+#include "MathOpsTimeSeries.h"
+
+namespace RTX {
+
+  class BinaryGraphWriter;
+  class BinaryGraphReader;
+
+  /*!
+   \class SerializerBinary
+   \brief Snapshot a configured object graph (series, filters, clocks, records) into a compact binary form.
+
+   Every object is written once, into a table ordered so that anything an object refers to (source, secondary, clock, record) comes before it. Shared references are kept: two filters on the same clock still share one clock after loading. Units are stored inline in their binary encoding.
+
+   Series are only linked to database records. A series on its own in-memory record gets a fresh one when it is loaded.
+   */
+  class SerializerBinary : public BaseVisitor,
+  public Visitor<Clock>,
+  public Visitor<TimeSeries>,
+  public Visitor<TimeSeriesFilter>,
+  public Visitor<ConstantTimeSeries>,
+  public Visitor<OffsetTimeSeries>,
+  public Visitor<GainTimeSeries>,
+  public Visitor<MultiplierTimeSeries>,
+  public Visitor<MovingAverage>,
+  public Visitor<FirstDerivative>,
+  public Visitor<ValidRangeTimeSeries>,
+  public Visitor<ThresholdTimeSeries>,
+  public Visitor<LagTimeSeries>,
+  public Visitor<InversionTimeSeries>,
+  public Visitor<IntegratorTimeSeries>,
+  public Visitor<StatsTimeSeries>,
+  public Visitor<FailoverTimeSeries>,
+  public Visitor<MathOpsTimeSeries>,
+  public Visitor<PointRecord>,
+  public Visitor<SqlitePointRecord>,
+  public Visitor<InfluxDbPointRecord>,
+  public Visitor<InfluxUdpPointRecord>,
+  public Visitor<OdbcPointRecord>,
+  public Visitor<PiPointRecord>
+  {
+  public:
+    static std::string to_binary(const std::vector<RTX_object::_sp>& roots); /// empty string if any object in the graph can't be written
+
+    SerializerBinary(BinaryGraphWriter& writer);
+    void visit(Clock &c);
+    void visit(TimeSeries &ts);
+    void visit(TimeSeriesFilter &ts);
+    void visit(ConstantTimeSeries &ts);
+    void visit(OffsetTimeSeries &ts);
+    void visit(GainTimeSeries &ts);
+    void visit(MultiplierTimeSeries &ts);
+    void visit(MovingAverage &ts);
+    void visit(FirstDerivative &ts);
+    void visit(ValidRangeTimeSeries &ts);
+    void visit(ThresholdTimeSeries &ts);
+    void visit(LagTimeSeries &ts);
+    void visit(InversionTimeSeries &ts);
+    void visit(IntegratorTimeSeries &ts);
+    void visit(StatsTimeSeries &ts);
+    void visit(FailoverTimeSeries &ts);
+    void visit(MathOpsTimeSeries &ts);
+    void visit(PointRecord &pr);
+    void visit(SqlitePointRecord &pr);
+    void visit(InfluxDbPointRecord &pr);
+    void visit(InfluxUdpPointRecord &pr);
+    void visit(OdbcPointRecord &pr);
+    void visit(PiPointRecord &pr);
+    const std::string& bytes();
+
+  private:
+    void _series(TimeSeries &ts);
+    void _filter(TimeSeriesFilter &ts);
+    void _stats(BaseStatsTimeSeries &ts);
+    void _db(DbPointRecord &pr);
+    BinaryGraphWriter& _w;
+    std::string _b;
+  };
+
+
+  class DeserializerBinary : public BaseVisitor,
+  public Visitor<Clock>,
+  public Visitor<TimeSeries>,
+  public Visitor<TimeSeriesFilter>,
+  public Visitor<ConstantTimeSeries>,
+  public Visitor<OffsetTimeSeries>,
+  public Visitor<GainTimeSeries>,
+  public Visitor<MultiplierTimeSeries>,
+  public Visitor<MovingAverage>,
+  public Visitor<FirstDerivative>,
+  public Visitor<ValidRangeTimeSeries>,
+  public Visitor<ThresholdTimeSeries>,
+  public Visitor<LagTimeSeries>,
+  public Visitor<InversionTimeSeries>,
+  public Visitor<IntegratorTimeSeries>,
+  public Visitor<StatsTimeSeries>,
+  public Visitor<FailoverTimeSeries>,
+  public Visitor<MathOpsTimeSeries>,
+  public Visitor<PointRecord>,
+  public Visitor<SqlitePointRecord>,
+  public Visitor<InfluxDbPointRecord>,
+  public Visitor<InfluxUdpPointRecord>,
+  public Visitor<OdbcPointRecord>,
+  public Visitor<PiPointRecord>
+  {
+  public:
+    static std::vector<RTX_object::_sp> from_binary(const std::string& bytes); /// the roots, in the order given to to_binary. empty if the snapshot is not readable.
+
+    DeserializerBinary(BinaryGraphReader& reader);
+    void visit(Clock &c);
+    void visit(TimeSeries &ts);
+    void visit(TimeSeriesFilter &ts);
+    void visit(ConstantTimeSeries &ts);
+    void visit(OffsetTimeSeries &ts);
+    void visit(GainTimeSeries &ts);
+    void visit(MultiplierTimeSeries &ts);
+    void visit(MovingAverage &ts);
+    void visit(FirstDerivative &ts);
+    void visit(ValidRangeTimeSeries &ts);
+    void visit(ThresholdTimeSeries &ts);
+    void visit(LagTimeSeries &ts);
+    void visit(InversionTimeSeries &ts);
+    void visit(IntegratorTimeSeries &ts);
+    void visit(StatsTimeSeries &ts);
+    void visit(FailoverTimeSeries &ts);
+    void visit(MathOpsTimeSeries &ts);
+    void visit(PointRecord &pr);
+    void visit(SqlitePointRecord &pr);
+    void visit(InfluxDbPointRecord &pr);
+    void visit(InfluxUdpPointRecord &pr);
+    void visit(OdbcPointRecord &pr);
+    void visit(PiPointRecord &pr);
+
+  private:
+    void _series(TimeSeries &ts);
+    void _filter(TimeSeriesFilter &ts);
+    void _stats(BaseStatsTimeSeries &ts);
+    void _db(DbPointRecord &pr);
+    BinaryGraphReader& _r;
+  };
+}
+
+#endif /* LinkBinarySerialization_hpp */
@@ -0,0 +1,109 @@
+//
+//  LinkRequestPool.cpp
+//  LINK-service
+//
+
+#include "LinkRequestPool.hpp"
+
+#include <iostream>
+#include <algorithm>
+
+using namespace RTX;
+using namespace std;
+
+
+LinkRequestPool::LinkRequestPool(size_t nWorkers, size_t maxQueued) {
+  _maxQueued = (maxQueued > 0) ? maxQueued : 1;
+  _shouldRun = true;
+  nWorkers = (nWorkers > 0) ? nWorkers : 1;
+  for (size_t i = 0; i < nWorkers; ++i) {
+    _workers.push_back(thread(&LinkRequestPool::_work, this));
+  }
+}
+
+LinkRequestPool::~LinkRequestPool() {
+  {
+    lock_guard<mutex> lock(_mtx);
+    _shouldRun = false;
+  }
+  _cond.notify_all();
+  for (auto& t : _workers) {
+    if (t.joinable()) {
+      t.join();
+    }
+  }
+}
+
+bool LinkRequestPool::submit(std::function<void ()> job) {
+  {
+    lock_guard<mutex> lock(_mtx);
+    if (!_shouldRun || _queue.size() >= _maxQueued) {
+      return false;
+    }
+    _queue.push_back(job);
+  }
+  _cond.notify_one();
+  return true;
+}
+
+size_t LinkRequestPool::queued() {
+  lock_guard<mutex> lock(_mtx);
+  return _queue.size();
+}
+
+size_t LinkRequestPool::capacity() {
+  return _maxQueued;
+}
+
+void LinkRequestPool::_work() {
+  while (true) {
+    std::function<void()> job;
+    {
+      unique_lock<mutex> lock(_mtx);
+      _cond.wait(lock, [&]{ return !_queue.empty() || !_shouldRun; });
+      if (!_shouldRun) {
+        return; // queued requests are dropped; their connections close with the listener.
+      }
+      job = std::move(_queue.front());
+      _queue.pop_front();
+    }
+    try {
+      job();
+    } catch (const std::exception &e) {
+      cerr << "request handler failed: " << e.what() << endl;
+    }
+  }
+}
+
+
+#pragma mark - stats
+
+LinkEndpointStats::LinkEndpointStats() {
+  _since = chrono::steady_clock::now();
+}
+
+void LinkEndpointStats::record(const std::string &endpoint, std::chrono::steady_clock::duration elapsed, bool ok) {
+  double micros = chrono::duration<double, micro>(elapsed).count();
+  lock_guard<mutex> lock(_mtx);
+  Counter& c = _counters[endpoint];
+  c.count++;
+  if (!ok) {
+    c.errors++;
+  }
+  c.totalMicros += micros;
+  c.maxMicros = std::max(c.maxMicros, micros);
+}
+
+void LinkEndpointStats::reject(const std::string &endpoint) {
+  lock_guard<mutex> lock(_mtx);
+  _counters[endpoint].rejected++;
+}
+
+map<string, LinkEndpointStats::Counter> LinkEndpointStats::counters() {
+  lock_guard<mutex> lock(_mtx);
+  return _counters;
+}
+
+double LinkEndpointStats::uptimeSeconds() {
+  return chrono::duration<double>(chrono::steady_clock::now() - _since).count();
+}
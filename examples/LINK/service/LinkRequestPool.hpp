@@ -0,0 +1,67 @@
+//
+//  LinkRequestPool.hpp
+//  LINK-service
+//
+
+#ifndef LinkRequestPool_hpp
+#define LinkRequestPool_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+namespace RTX {
+
+  // a bounded queue of request handlers, run by a fixed number of workers.
+  // submit() refuses work instead of blocking once the queue is full,
+  // so that the caller can answer "busy" right away.
+  class LinkRequestPool {
+  public:
+    LinkRequestPool(size_t nWorkers, size_t maxQueued);
+    ~LinkRequestPool();
+    bool submit(std::function<void()> job);
+    size_t queued();
+    size_t capacity();
+
+  private:
+    void _work();
+    std::deque<std::function<void()> > _queue;
+    size_t _maxQueued;
+    bool _shouldRun;
+    std::mutex _mtx;
+    std::condition_variable _cond;
+    std::vector<std::thread> _workers;
+  };
+
+
+  // per-endpoint request counters
+  class LinkEndpointStats {
+  public:
+    class Counter {
+    public:
+      Counter() : count(0), errors(0), rejected(0), totalMicros(0), maxMicros(0) {};
+      size_t count, errors, rejected;
+      double totalMicros, maxMicros;
+    };
+    LinkEndpointStats();
+    void record(const std::string& endpoint, std::chrono::steady_clock::duration elapsed, bool ok);
+    void reject(const std::string& endpoint);
+    std::map<std::string, Counter> counters();
+    double uptimeSeconds();
+
+  private:
+    std::mutex _mtx;
+    std::map<std::string, Counter> _counters;
+    std::chrono::steady_clock::time_point _since;
+  };
+
+}
+
+#endif /* LinkRequestPool_hpp */
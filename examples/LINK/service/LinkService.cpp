@@ -6,7 +6,11 @@
 #include <cpprest/uri.h>
 #include <cpprest/json.h>
 #include <cpprest/http_client.h>
+#include <cpprest/producerconsumerstream.h>
+#include <boost/lexical_cast.hpp>
 #include <map>
+#include <cstring>
+#include <thread>
 
 using namespace std;
 using namespace RTX;
@@ -56,7 +60,7 @@ pplx::task<void> _link_respond(http_request message, json::value js, status_code
   return message.reply(response);
 }
 
-LinkService::LinkService(uri uri) : _listener(uri) {
+LinkService::LinkService(uri uri) : _listener(uri), _readPool(4, 64), _writePool(1, 16) {
   _listener.support(methods::GET,  std::bind(&LinkService::_get,    this, std::placeholders::_1));
   _listener.support(methods::PUT,  std::bind(&LinkService::_put,    this, std::placeholders::_1));
   _listener.support(methods::POST, std::bind(&LinkService::_post,   this, std::placeholders::_1));
@@ -73,6 +77,9 @@ LinkService::LinkService(uri uri) : _listener(uri) {
   _options.throttle = 0;
   _options.window = 0;
   _options.smart = false;
+  _options.adaptive = false;
+  _options.workers = 1;
+  _options.queryRate = 0;
   
   _metrics.count.reset(new TimeSeries());
   _metrics.time.reset(new TimeSeries());
@@ -91,7 +98,54 @@ pplx::task<void> LinkService::close() {
 }
 
 
+#pragma mark - dispatch
+
+static string _link_endpoint_name(const string& method, http_request& message) {
+  auto paths = uri::split_path(uri::decode(message.relative_uri().path()));
+  return method + " /" + (paths.empty() ? string("") : paths[0]);
+}
+
+void LinkService::_dispatch(LinkRequestPool& pool, const std::string& endpoint, http_request message, std::function<void(http_request)> handler) {
+  auto queuedAt = chrono::steady_clock::now();
+  bool accepted = pool.submit([=]() {
+    bool ok = true;
+    try {
+      handler(message);
+    } catch (const std::exception &e) {
+      ok = false;
+      message.reply(_link_error_response(status_codes::InternalError, e.what()));
+    }
+    // latency includes time spent waiting in the queue.
+    _stats.record(endpoint, chrono::steady_clock::now() - queuedAt, ok);
+  });
+  if (!accepted) {
+    _stats.reject(endpoint);
+    http_response r = _link_error_response(status_codes::ServiceUnavailable, "service is busy");
+    r.headers().add(U("Retry-After"), U("1"));
+    message.reply(r);
+  }
+}
+
 void LinkService::_get(http_request message) {
+  string endpoint = _link_endpoint_name("GET", message);
+  
+  // monitoring endpoints answer right away, even while the workers are busy.
+  if (endpoint == "GET /ping" || endpoint == "GET /stats") {
+    auto start = chrono::steady_clock::now();
+    this->_handle_get(message);
+    _stats.record(endpoint, chrono::steady_clock::now() - start, true);
+    return;
+  }
+  
+  this->_dispatch(_readPool, endpoint, message, bind(&LinkService::_handle_get, this, placeholders::_1));
+}
+
+void LinkService::_post(http_request message) {
+  // changes are applied one at a time, in order.
+  this->_dispatch(_writePool, _link_endpoint_name("POST", message), message, bind(&LinkService::_handle_post, this, placeholders::_1));
+}
+
+void LinkService::_handle_get(http_request message) {
   
   //cout << "GET: " << message.relative_uri().to_string() << endl;
   
@@ -113,7 +167,10 @@ void LinkService::_get(http_request message) {
     {"odbc",   std::bind(&LinkService::_get_odbc_drivers, this, std::placeholders::_1)},
     {"units",  std::bind(&LinkService::_get_units,        this, std::placeholders::_1)},
     {"options",std::bind(&LinkService::_get_options,      this, std::placeholders::_1)},
-    {"config", std::bind(&LinkService::_get_config,       this, std::placeholders::_1)}
+    {"config", std::bind(&LinkService::_get_config,       this, std::placeholders::_1)},
+    {"data",   std::bind(&LinkService::_get_data,         this, std::placeholders::_1)},
+    {"stats",  std::bind(&LinkService::_get_stats,        this, std::placeholders::_1)},
+    {"snapshot", std::bind(&LinkService::_get_snapshot,   this, std::placeholders::_1)}
   };
   
   if (responders.count(entryPoint)) {
@@ -129,8 +186,23 @@ void LinkService::_put(http_request message) {
   
 }
 
-void LinkService::_post(http_request message) {
+void LinkService::_handle_post(http_request message) {
 //  cout << message.to_string() << endl;
+  auto paths = uri::split_path(uri::decode(message.relative_uri().path()));
+  if(paths.size() == 0) {
+    _link_respond(message, JSV::object(), status_codes::BadRequest);
+    return;
+  }
+  string entry = paths[0];
+  
+  if (entry == "snapshot") {
+    // binary body, not json.
+    vector<unsigned char> body = message.extract_vector().get();
+    http_response response = this->_post_snapshot(string(body.begin(), body.end()));
+    message.reply(response).wait();
+    return;
+  }
+  
   JSV js = message.extract_json().get();
   
   const map< string, std::function<http_response(JSV)> > responders = {
@@ -144,12 +216,6 @@ void LinkService::_post(http_request message) {
     {"log",         bind(&LinkService::_post_logmessage, this, placeholders::_1)}
   };
   
-  auto paths = uri::split_path(uri::decode(message.relative_uri().path()));
-  if(paths.size() == 0) {
-    _link_respond(message, JSV::object(), status_codes::BadRequest);
-    return;
-  }
-  string entry = paths[0];
   if (responders.count(entry)) {
     http_response response = responders.at(entry)(js);
     message.reply(response).wait(); // block since this may change things
@@ -317,11 +383,47 @@ http_response LinkService::_get_options(http_request message) {
   o["backfill"] = JSV(_options.backfill / (60 * 60 * 24)); // days
   o["throttle"] = JSV(_options.throttle); // seconds
   o["smart"] = JSV(_options.smart);
+  o["adaptive"] = JSV(_options.adaptive);
+  o["workers"] = JSV(_options.workers);
+  o["query_rate"] = JSV(_options.queryRate); // queries per second, 0 = unlimited
   
   response.set_body(o);
   return response;
 }
 
+http_response LinkService::_get_stats(http_request message) {
+  http_response response = _link_empty_response();
+  double uptime = _stats.uptimeSeconds();
+  
+  JSV queues = JSV::object();
+  queues["read"] = JSV::object();
+  queues["read"]["queued"] = JSV((int)_readPool.queued());
+  queues["read"]["capacity"] = JSV((int)_readPool.capacity());
+  queues["write"] = JSV::object();
+  queues["write"]["queued"] = JSV((int)_writePool.queued());
+  queues["write"]["capacity"] = JSV((int)_writePool.capacity());
+  
+  JSV endpoints = JSV::object();
+  for (auto& entry : _stats.counters()) {
+    const LinkEndpointStats::Counter& c = entry.second;
+    JSV e = JSV::object();
+    e["count"] = JSV((int)c.count);
+    e["errors"] = JSV((int)c.errors);
+    e["rejected"] = JSV((int)c.rejected);
+    e["mean_ms"] = JSV(c.count > 0 ? c.totalMicros / c.count / 1000. : 0.);
+    e["max_ms"] = JSV(c.maxMicros / 1000.);
+    e["per_second"] = JSV(uptime > 0 ? c.count / uptime : 0.);
+    endpoints[entry.first] = e;
+  }
+  
+  JSV stats = JSV::object();
+  stats["uptime"] = JSV(uptime); // seconds
+  stats["queues"] = queues;
+  stats["endpoints"] = endpoints;
+  response.set_body(stats);
+  return response;
+}
+
 http_response LinkService::_get_config(http_request message) {
   JSV config = JSV::object();
   http_response response = _link_empty_response();
@@ -336,6 +438,221 @@ http_response LinkService::_get_config(http_request message) {
   return response;
 }
 
+http_response LinkService::_get_snapshot(http_request message) {
+  // roots: source record, destination record, then each configured filter (which carries its source series).
+  vector<RTX_object::_sp> roots = {_sourceRecord, _destinationRecord};
+  roots.reserve(2 + _destinationSeries.size());
+  for (auto ts : _destinationSeries) {
+    roots.push_back(ts);
+  }
+  string bytes = SerializerBinary::to_binary(roots);
+  if (bytes.empty()) {
+    return _link_error_response(status_codes::InternalError, "Configuration could not be written as a snapshot");
+  }
+  http_response response = _link_empty_response();
+  response.set_body(vector<unsigned char>(bytes.begin(), bytes.end()));
+  response.headers().set_content_type(U("application/octet-stream"));
+  return response;
+}
+
+
+#pragma mark - bulk data
+
+// binary framing helpers. all integers little-endian, doubles as their IEEE-754 bit pattern.
+static void _link_put_uint(string& out, uint64_t v, size_t nBytes) {
+  for (size_t i = 0; i < nBytes; ++i) {
+    out.push_back((char)((v >> (8 * i)) & 0xFF));
+  }
+}
+
+static void _link_put_double(string& out, double d) {
+  uint64_t bits;
+  memcpy(&bits, &d, sizeof(bits));
+  _link_put_uint(out, bits, 8);
+}
+
+static string _link_json_string(const string& str) {
+  return JSV(str).serialize();
+}
+
+http_response LinkService::_get_data(http_request message) {
+  // GET /data?start=<unix>&end=<unix>[&series=a,b,c][&format=csv|json|binary][&record=source|destination][&chunk=<seconds>]
+  auto query = uri::split_query(message.request_uri().query());
+  for (auto& kv : query) {
+    kv.second = uri::decode(kv.second);
+  }
+  auto param = [&](const string& key, const string& dflt) -> string {
+    return query.count(key) ? query.at(key) : dflt;
+  };
+  
+  time_t start, end, chunk;
+  try {
+    start = boost::lexical_cast<time_t>(param("start", "0"));
+    end = boost::lexical_cast<time_t>(param("end", "0"));
+    chunk = boost::lexical_cast<time_t>(param("chunk", "86400"));
+  } catch (const boost::bad_lexical_cast&) {
+    return _link_error_response(status_codes::BadRequest, "start, end and chunk must be integer unix times/seconds");
+  }
+  if (start <= 0 || end <= start || chunk <= 0) {
+    return _link_error_response(status_codes::BadRequest, "invalid time range");
+  }
+  
+  string format = param("format", "csv");
+  string contentType;
+  if (format == "csv") {
+    contentType = "text/csv";
+  }
+  else if (format == "json") {
+    contentType = "application/json";
+  }
+  else if (format == "binary") {
+    contentType = "application/octet-stream";
+  }
+  else {
+    return _link_error_response(status_codes::BadRequest, "unknown format: " + format);
+  }
+  
+  // which record, and what we know about its series.
+  PointRecord::_sp record;
+  map<string,string> knownUnits;
+  if (param("record", "destination") == "source") {
+    record = _sourceRecord;
+    for (auto ts : _sourceSeries) {
+      knownUnits[ts->name()] = ts->units().to_string();
+    }
+  }
+  else {
+    record = _destinationRecord;
+    for (auto ts : _destinationSeries) {
+      knownUnits[ts->name()] = ts->units().to_string();
+    }
+  }
+  if (!record) {
+    return _link_error_response(status_codes::ExpectationFailed, "record is not configured");
+  }
+  
+  vector<string> names;
+  if (query.count("series")) {
+    stringstream ss(query.at("series"));
+    string name;
+    while (getline(ss, name, ',')) {
+      if (!name.empty()) {
+        names.push_back(name);
+      }
+    }
+  }
+  else {
+    for (auto& known : knownUnits) {
+      names.push_back(known.first);
+    }
+  }
+  
+  // the body is produced on another thread while the listener streams it out (chunked transfer encoding).
+  concurrency::streams::producer_consumer_buffer<uint8_t> buf;
+  http_response response = _link_empty_response();
+  response.set_body(buf.create_istream(), contentType);
+  
+  pplx::create_task([=]() mutable {
+    const size_t maxBuffered = 4 * 1024 * 1024;
+    auto emit = [&](const string& bytes) {
+      if (bytes.empty()) {
+        return;
+      }
+      // back-pressure: don't get too far ahead of a slow client.
+      while (buf.in_avail() > maxBuffered) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+      }
+      buf.putn_nocopy((const uint8_t*)bytes.data(), bytes.size()).wait();
+    };
+    
+    try {
+      auto db = dynamic_pointer_cast<DbPointRecord>(record);
+      string out;
+      if (format == "csv") {
+        emit("series,time,value,quality,confidence\n");
+      }
+      else if (format == "json") {
+        emit("{\"start\":" + to_string(start) + ",\"end\":" + to_string(end) + ",\"series\":[");
+      }
+      else {
+        out = "RTXD";
+        _link_put_uint(out, 1, 4); // version
+        emit(out);
+      }
+      
+      bool firstSeries = true;
+      for (const string& name : names) {
+        if (format == "json") {
+          string units = knownUnits.count(name) ? knownUnits.at(name) : "";
+          emit((firstSeries ? "" : ",") + string("{\"name\":") + _link_json_string(name) + ",\"units\":" + _link_json_string(units) + ",\"points\":[");
+        }
+        firstSeries = false;
+        
+        bool firstPoint = true;
+        for (time_t cStart = start; cStart <= end; cStart += chunk) {
+          TimeRange r(cStart, std::min(cStart + chunk - 1, end));
+          if (db) {
+            db->willQuery(r); // one wide query per chunk, shared by the remaining series
+          }
+          vector<Point> points = record->pointsInRange(name, r);
+          if (points.empty()) {
+            continue;
+          }
+          out.clear();
+          if (format == "csv") {
+            stringstream ss;
+            ss.precision(15);
+            for (const Point& p : points) {
+              ss << name << ',' << p.time << ',' << p.value << ',' << (int)p.quality << ',' << p.confidence << '\n';
+            }
+            out = ss.str();
+          }
+          else if (format == "json") {
+            stringstream ss;
+            ss.precision(15);
+            for (const Point& p : points) {
+              ss << (firstPoint ? "" : ",") << '[' << p.time << ',' << p.value << ',' << (int)p.quality << ']';
+              firstPoint = false;
+            }
+            out = ss.str();
+          }
+          else {
+            // block: name length (u16), name, point count (u32), then (time i64, value f64, quality u8, confidence f64) per point
+            _link_put_uint(out, name.size(), 2);
+            out += name;
+            _link_put_uint(out, points.size(), 4);
+            for (const Point& p : points) {
+              _link_put_uint(out, (uint64_t)p.time, 8);
+              _link_put_double(out, p.value);
+              _link_put_uint(out, (uint8_t)p.quality, 1);
+              _link_put_double(out, p.confidence);
+            }
+          }
+          emit(out);
+        }
+        
+        if (format == "json") {
+          emit("]}");
+        }
+      }
+      
+      if (format == "json") {
+        emit("]}");
+      }
+      else if (format == "binary") {
+        out.clear();
+        _link_put_uint(out, 0, 2); // zero-length name terminates the stream
+        emit(out);
+      }
+    } catch (const std::exception &e) {
+      cerr << "bulk data stream aborted: " << e.what() << endl;
+    }
+    buf.close(std::ios_base::out).wait();
+  });
+  
+  return response;
+}
+
 
 #pragma mark - POST
 
@@ -532,6 +849,58 @@ http_response LinkService::_post_destination(JSV js) {
   return r;
 }
 
+http_response LinkService::_post_snapshot(const std::string& bytes) {
+  _statusMessage = "restoring configuration snapshot";
+  http_response r = _link_empty_response();
+  cout << "=====================================\n";
+  cout << "== RESTORING SNAPSHOT\n";
+  
+  vector<RTX_object::_sp> objs = DeserializerBinary::from_binary(bytes);
+  DbPointRecord::_sp source = (objs.size() >= 2) ? dynamic_pointer_cast<DbPointRecord>(objs[0]) : DbPointRecord::_sp();
+  if (!source) {
+    cout << "== snapshot not recognized\n";
+    _statusMessage = "";
+    return _link_error_response(status_codes::NotAcceptable, "Snapshot not recognized");
+  }
+  
+  _sourceRecord = source;
+  _sourceRecord->dbConnect();
+  
+  _sourceSeries.clear();
+  _destinationSeries.clear();
+  _translation.clear();
+  for (size_t i = 2; i < objs.size(); ++i) {
+    auto filter = dynamic_pointer_cast<TimeSeriesFilter>(objs[i]);
+    if (!filter || !filter->source()) {
+      continue;
+    }
+    _sourceSeries.push_back(filter->source());
+    _destinationSeries.push_back(filter);
+    _translation[filter->source()] = filter;
+  }
+  vector<RTX::TimeSeries::_sp> series(_destinationSeries.begin(), _destinationSeries.end());
+  _runner.setSeries(series);
+  cout << "== " << series.size() << " series\n";
+  
+  _destinationRecord = dynamic_pointer_cast<DbPointRecord>(objs[1]);
+  if (_destinationRecord) {
+    _destinationRecord->setReadonly(false);
+    _destinationRecord->dbConnect();
+    if (_destinationRecord->isConnected()) {
+      this->refreshDestinationSeriesRecords();
+    }
+    else {
+      string err = "Destination Record: " + _destinationRecord->errorMessage;
+      cout << "== err: " << err << '\n';
+      r = _link_error_response(status_codes::NotAcceptable, err);
+    }
+  }
+  
+  cout << "=====================================" << endl;
+  _statusMessage = "";
+  return r;
+}
+
 void LinkService::refreshDestinationSeriesRecords() {
   _destinationRecord->beginBulkOperation();
   for (auto ts : _destinationSeries) {
@@ -610,6 +979,7 @@ http_response LinkService::_post_options(JSV js) {
   
   // expecting :
   // {'interval': ###, 'window': ###, 'backfill': ###, 'smart': bool}
+  // optional: {'adaptive': bool, 'workers': ###, 'query_rate': ###}
   
   if (!js.is_object()) {
     r = _link_error_response(status_codes::ExpectationFailed, "data is not a json object");
@@ -624,6 +994,15 @@ http_response LinkService::_post_options(JSV js) {
       _options.backfill = o["backfill"].as_integer() * 60 * 60 * 24;
       _options.throttle = o["throttle"].as_integer(); // seconds
       _options.smart = o["smart"].as_bool();
+      if (o.find("adaptive") != o.end()) {
+        _options.adaptive = o["adaptive"].as_bool();
+      }
+      if (o.find("workers") != o.end()) {
+        _options.workers = o["workers"].as_integer();
+      }
+      if (o.find("query_rate") != o.end()) {
+        _options.queryRate = o["query_rate"].as_double();
+      }
       r = _link_empty_response();
     } catch (std::exception &e) {
       r = _link_error_response(status_codes::MethodNotAllowed, e.what());
@@ -678,6 +1057,7 @@ void LinkService::runDuplication() {
   time_t since = time(NULL) - _options.backfill;
   
   _runner.setParams(_options.smart, _options.window, _options.frequency, _options.throttle);
+  _runner.setScheduling(_options.adaptive, _options.workers, _options.queryRate);
   _runner.run(since);
 }
 
@@ -26,8 +26,10 @@
 #include "ConcreteDbRecords.h"
 
 #include "LinkJsonSerialization.hpp"
+#include "LinkBinarySerialization.hpp"
 
 #include "AutoRunner.hpp"
+#include "LinkRequestPool.hpp"
 
 using web::http::http_request;
 using web::http::http_response;
@@ -49,6 +51,11 @@ namespace RTX {
     void _post(http_request message);
     void _delete(http_request message);
     
+    // handlers run on the worker pools: reads in parallel, writes one at a time.
+    void _dispatch(LinkRequestPool& pool, const std::string& endpoint, http_request message, std::function<void(http_request)> handler);
+    void _handle_get(http_request message);
+    void _handle_post(http_request message);
+    
     http_response _get_ping(http_request message);
     http_response _get_timeseries(http_request message);
     http_response _get_runState(http_request message);
@@ -58,6 +65,9 @@ namespace RTX {
     http_response _get_units(http_request message);
     http_response _get_options(http_request message);
     http_response _get_config(http_request message);
+    http_response _get_data(http_request message); /// bulk range read, streamed as csv, json or binary
+    http_response _get_stats(http_request message); /// per-endpoint latency and throughput
+    http_response _get_snapshot(http_request message); /// binary snapshot of records and series, for a fast restore
     
     http_response _post_config(web::json::value json);
     http_response _post_timeseries(web::json::value json);
@@ -67,6 +77,7 @@ namespace RTX {
     http_response _post_destination(web::json::value json);
     http_response _post_analytics(web::json::value json);
     http_response _post_logmessage(web::json::value json);
+    http_response _post_snapshot(const std::string& bytes);
     
     void refreshDestinationSeriesRecords();
 
@@ -85,6 +96,9 @@ namespace RTX {
     struct Options {
       int window, frequency, backfill, throttle;
       bool smart;
+      bool adaptive;
+      int workers;
+      double queryRate;
     } _options;
     
     boost::signals2::mutex _dupeMutex;
@@ -97,6 +111,10 @@ namespace RTX {
       TimeSeries::_sp time;
     } _metrics;
     
+    // declared last, so that the workers are stopped before anything they use is destroyed.
+    LinkEndpointStats _stats;
+    LinkRequestPool _readPool, _writePool;
+    
   };
 }
 
@@ -10,6 +10,7 @@
 #include <limits>
 
 #include "AggregatorTimeSeries.h"
+#include "RtxArena.h"
 #include <boost/foreach.hpp>
 #include <boost/range/adaptors.hpp>
 #include <set>
@@ -77,6 +78,7 @@ void AggregatorTimeSeries::addSource(TimeSeries::_sp timeSeries, double multipli
   }
   
   _tsList.push_back((AggregatorSource){timeSeries,multiplier});
+  timeSeries->filterDidAddSource(share_me(this));
   this->invalidate();
 }
 
@@ -95,6 +97,7 @@ void AggregatorTimeSeries::removeSource(TimeSeries::_sp timeSeries) {
   }
   // save the new source list
   _tsList = newSourceList;
+  timeSeries->filterDidRemoveSource(share_me(this));
   
   this->invalidate();
 }
@@ -211,7 +214,7 @@ std::set<time_t> AggregatorTimeSeries::timeValuesInRange(TimeRange range) {
 }
 
 PointCollection AggregatorTimeSeries::filterPointsInRange(TimeRange range) {
-  set<time_t> droppedTimes;
+  RtxArena::set<time_t> droppedTimes;
   vector<Point> aggregated;
   double nSources = (double)(this->sources().size());
   
@@ -239,12 +242,12 @@ PointCollection AggregatorTimeSeries::filterPointsInRange(TimeRange range) {
   
   
   // asynchronously get source series
-  vector< future< map< time_t, Point> > > aggSeriesData;
+  vector< future< vector<Point> > > aggSeriesData;
   auto mySources = this->sources();
   auto mode = this->_mode;
   for(AggregatorSource sd : mySources) {
     
-    auto task = async(launch::async, [=]() -> map< time_t, Point> {
+    auto task = async(launch::async, [=]() -> vector<Point> {
       TimeSeries::_sp sourceTs = sd.timeseries;
       double multiplier = sd.multiplier;
       TimeRange componentRange = range;
@@ -258,12 +261,13 @@ PointCollection AggregatorTimeSeries::filterPointsInRange(TimeRange range) {
       }
       componentCollection.convertToUnits(this->units());
       
-      // make it easy to find any times that were dropped (bad points from a source series)
-      map<time_t, Point> sourcePointMap;
+      // time-ordered, so the aggregation below can walk it alongside the output times
+      vector<Point> sourcePoints;
+      sourcePoints.reserve(componentCollection.count());
       componentCollection.apply([&](Point& p){
-        sourcePointMap[p.time] = p * multiplier;
+        sourcePoints.push_back(p * multiplier);
       });
-      return sourcePointMap;
+      return sourcePoints;
     });
     
     aggSeriesData.push_back( std::move(task) ); //push_back;
@@ -271,16 +275,21 @@ PointCollection AggregatorTimeSeries::filterPointsInRange(TimeRange range) {
   
   
   
-  set<time_t> unionSet;
+  RtxArena::set<time_t> unionSet;
   
   for(auto &task : aggSeriesData) {
     
-    map<time_t, Point> sourcePointMap = task.get();
+    vector<Point> sourcePoints = task.get();
+    auto sourceIt = sourcePoints.cbegin();
+    const auto sourceEnd = sourcePoints.cend();
     
     // do the aggregation.
     for(Point& p: aggregated) {
-      if (sourcePointMap.count(p.time) > 0) {
-        Point pointToAggregate = sourcePointMap[p.time]; // already multiplied
+      while (sourceIt != sourceEnd && (sourceIt->time < p.time || (sourceIt + 1 != sourceEnd && (sourceIt + 1)->time == p.time))) {
+        ++sourceIt; // on duplicate times, the last one wins
+      }
+      if (sourceIt != sourceEnd && sourceIt->time == p.time) {
+        Point pointToAggregate = *sourceIt; // already multiplied
         
         switch (_mode) {
           case AggregatorModeSum:
@@ -336,7 +345,7 @@ PointCollection AggregatorTimeSeries::filterPointsInRange(TimeRange range) {
     }
   }
   
-  PointCollection data(goodPoints, this->units());
+  PointCollection data(std::move(goodPoints), this->units());
   data.resample(desiredTimes);
   
   return data;
@@ -361,3 +370,18 @@ bool AggregatorTimeSeries::canChangeToUnits(Units units) {
     return false;
   }
 }
+
+vector<TimeSeries::_sp> AggregatorTimeSeries::inputs() {
+  vector<TimeSeries::_sp> in;
+  for (const AggregatorSource& aggSource : this->sources()) {
+    in.push_back(aggSource.timeseries);
+  }
+  return in;
+}
+
+TimeSeriesFilter::Reach AggregatorTimeSeries::reach() {
+  // every component is resampled onto the output times
+  Reach r;
+  r.resampleNeighbors = true;
+  return r;
+}
@@ -67,6 +67,8 @@ namespace RTX {
     bool canChangeToUnits(Units units);
     
     virtual bool hasUpstreamSeries(TimeSeries::_sp other);
+    virtual std::vector<TimeSeries::_sp> inputs();
+    virtual Reach reach();
     
     // chainable
     AggregatorTimeSeries::_sp add(TimeSeries::_sp ts, double multiplier) {this->addSource(ts,multiplier); return share_me(this);};
@@ -52,7 +52,7 @@ BaseStatsTimeSeries::StatsSamplingMode_t BaseStatsTimeSeries::samplingMode() {
   return _samplingMode;
 }
 
-BaseStatsTimeSeries::rangeGroup BaseStatsTimeSeries::subRanges(set<time_t> times) {
+BaseStatsTimeSeries::rangeGroup BaseStatsTimeSeries::subRanges(const set<time_t>& times) {
   rangeGroup group;
     
   if (times.size() == 0 || !this->window()) {
@@ -67,13 +67,18 @@ BaseStatsTimeSeries::rangeGroup BaseStatsTimeSeries::subRanges(set<time_t> times
   
   time_t t_lag  = 0, t_lead = 0;
   
-  map<StatsSamplingMode_t, function<void()> > windowSetters({
-    {StatsSamplingModeLeading,  [&](){t_lead += w;} },
-    {StatsSamplingModeLagging,  [&](){t_lag += w;} },
-    {StatsSamplingModeCentered, [&](){time_t h = w / 2; t_lag += h; t_lead += h;} }
-  });
-  
-  windowSetters.at(this->samplingMode())();  
+  switch (this->samplingMode()) {
+    case StatsSamplingModeLeading:
+      t_lead += w;
+      break;
+    case StatsSamplingModeLagging:
+      t_lag += w;
+      break;
+    case StatsSamplingModeCentered:
+      t_lag += w / 2;
+      t_lead += w / 2;
+      break;
+  }
     
   // force a pre-cache on the source time series
   group.retainedCollection = sourceTs->pointCollection(TimeRange(fromTime - t_lag, toTime + t_lead));
@@ -95,8 +100,24 @@ BaseStatsTimeSeries::rangeGroup BaseStatsTimeSeries::subRanges(set<time_t> times
   return group;
 }
 
-
-
-
-
-
+TimeSeriesFilter::Reach BaseStatsTimeSeries::reach() {
+  Reach r = TimeSeriesFilter::reach();
+  if (!this->window()) {
+    return r;
+  }
+  // same window placement as subRanges
+  time_t w = this->window()->period();
+  switch (this->samplingMode()) {
+    case StatsSamplingModeLeading:
+      r.lookAhead = w;
+      break;
+    case StatsSamplingModeLagging:
+      r.lookBehind = w;
+      break;
+    case StatsSamplingModeCentered:
+      r.lookBehind = w / 2;
+      r.lookAhead = w / 2;
+      break;
+  }
+  return r;
+}
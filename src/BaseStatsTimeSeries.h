@@ -12,6 +12,7 @@
 #include <iostream>
 #include "TimeSeriesFilter.h"
 #include "PointCollection.h"
+#include "RtxArena.h"
 
 namespace RTX {
   
@@ -49,7 +50,7 @@ namespace RTX {
       StatsSamplingModeCentered = 2   /*!< Use a centered sampling window */
     } StatsSamplingMode_t;
     
-    typedef std::map< time_t,PointCollection::pvRange > subrangeMap; 
+    typedef RtxArena::map< time_t,PointCollection::pvRange > subrangeMap; // lives in the query's arena; see RtxArena
     
     struct rangeGroup {
       PointCollection retainedCollection;
@@ -72,9 +73,11 @@ namespace RTX {
     BaseStatsTimeSeries::_sp window(Clock::_sp w) {this->setWindow(w); return share_me(this);};
     BaseStatsTimeSeries::_sp mode(StatsSamplingMode_t mode) {this->setSamplingMode(mode); return share_me(this);};
     
+    Reach reach();
+    
   protected:
     virtual PointCollection filterPointsInRange(TimeRange range) = 0; // pure virtual. don't use this class directly.
-    rangeGroup subRanges(std::set<time_t> times);
+    rangeGroup subRanges(const std::set<time_t>& times);
     
   private:
     Clock::_sp _window;
@@ -20,7 +20,7 @@ using boost::signals2::mutex;
 using boost::interprocess::scoped_lock;
 
 
-BufferPointRecord::BufferPointRecord(int defaultCapacity) {
+BufferPointRecord::BufferPointRecord(int defaultCapacity) : _liveEdgeCapacity(0), _regularStorage(false) {
   _defaultCapacity = defaultCapacity;
 }
 
@@ -38,55 +38,79 @@ std::ostream& BufferPointRecord::toStream(std::ostream &stream) {
 
 bool BufferPointRecord::registerAndGetIdentifierForSeriesWithUnits(std::string recordName, Units units) {
   // register the recordName internally and generate a buffer and mutex
+  SeriesHandle handle = this->handleForIdentifier(recordName);
   scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
-  if (_keyedBuffers.find(recordName) != _keyedBuffers.end()) {
+  auto existing = _keyedBuffers.find(handle);
+  if (existing != _keyedBuffers.end()) {
     // got the name - do the units match?
-    Buffer b = _keyedBuffers[recordName];
-    if (b.units == units) {
+    if (existing->second.units == units) {
       // total match! use it.
       return true;
     }
     else {
-      _keyedBuffers.erase(recordName);
+      _keyedBuffers.erase(existing);
     }
   }
   
   // check to see that it's not there
-  if (_keyedBuffers.find(recordName) == _keyedBuffers.end()) {
+  if (_keyedBuffers.find(handle) == _keyedBuffers.end()) {
     Buffer b;
     b.circularBuffer.set_capacity(_defaultCapacity);
     b.units = units;
-    _keyedBuffers[recordName] = b;
+    size_t liveCapacity = _liveEdgeCapacity.load();
+    if (liveCapacity > 0) {
+      b.live = make_shared<LiveEdge>(liveCapacity);
+    }
+    _keyedBuffers[handle] = b;
+    if (b.live) {
+      this->_publishLiveEdges();
+    }
+    this->_catalogChanged();
   }
   
   return true;
 }
 
 IdentifierUnitsList BufferPointRecord::identifiersAndUnits() {
-  IdentifierUnitsList list;
-  std::map<std::string,pair<Units,string> > *ids = list.get();
+  scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
+  vector<pair<string,Units> > ids;
+  ids.reserve(_keyedBuffers.size());
   for (const auto &p : _keyedBuffers) {
-    (*ids)[p.first] = {p.second.units, p.second.units.to_string()};
+    ids.push_back(make_pair(this->identifierForHandle(p.first), p.second.units));
   }
+  IdentifierUnitsList list;
+  list.set(ids);
   return list;
 }
 
 Point BufferPointRecord::point(const string& identifier, time_t time) {
+  return BufferPointRecord::point(this->handleForIdentifier(identifier), time);
+}
+
+Point BufferPointRecord::point(SeriesHandle series, time_t time) {
   
-  Point bp = PointRecord::point(identifier,time);
+  Point bp = this->_cachedPoint(series, time);
   if (bp.isValid) {
     return bp;
   }
   
   scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
   
-  auto it = _keyedBuffers.find(identifier);
+  auto it = _keyedBuffers.find(series);
   if (it == _keyedBuffers.end()) {
     // nobody here by that name
     return Point();
   }
   
   // get the constituents
+  this->_mergeLiveEdge(it->second);
+  if (it->second.dense) {
+    Point p = it->second.regular.point(time);
+    if (p.isValid) {
+      this->_cachePoint(series, p);
+    }
+    return p;
+  }
   PointBuffer& buffer = (it->second.circularBuffer);
   
   if (buffer.empty()) {
@@ -103,7 +127,7 @@ Point BufferPointRecord::point(const string& identifier, time_t time) {
     PointBuffer::iterator pbIt = std::lower_bound(startIterator, buffer.end(), finder, &Point::comparePointTime);
     if (pbIt != buffer.end() && pbIt->time == time) {
       Point p = *pbIt;
-      PointRecord::addPoint(identifier, p);
+      this->_cachePoint(series, p);
       return p;
     }
     else {
@@ -118,12 +142,21 @@ Point BufferPointRecord::point(const string& identifier, time_t time) {
 
 
 Point BufferPointRecord::pointBefore(const string& identifier, time_t time, WhereClause q) {
+  return BufferPointRecord::pointBefore(this->handleForIdentifier(identifier), time, q);
+}
+
+Point BufferPointRecord::pointBefore(SeriesHandle series, time_t time, WhereClause q) {
   
   scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
   
   Point foundPoint;
   
-  auto vRange = this->range(identifier);
+  auto it = _keyedBuffers.find(series);
+  if (it == _keyedBuffers.end()) {
+    return foundPoint;
+  }
+  this->_mergeLiveEdge(it->second);
+  TimeRange vRange(_firstPoint(it->second).time, _lastPoint(it->second).time);
   if (!vRange.contains(time)) {
     // don't bother if its' not in range
     return foundPoint;
@@ -132,7 +165,14 @@ Point BufferPointRecord::pointBefore(const string& identifier, time_t time, Wher
   //TimePointPair_t finder(time, PointPair_t(0,0));
   Point finder(time, 0);
   
-  auto it = _keyedBuffers.find(identifier);
+  if (it != _keyedBuffers.end() && it->second.dense) {
+    auto accept = (q.clauses.empty()) ? std::function<bool(const Point&)>() : [&](const Point& p) { return q.filter(p); };
+    foundPoint = it->second.regular.pointBefore(time, accept);
+    if (foundPoint.isValid) {
+      this->_cachePoint(series, foundPoint);
+    }
+    return foundPoint;
+  }
   if (it != _keyedBuffers.end()) {
     // get the constituents
     PointBuffer& buffer = (it->second.circularBuffer);
@@ -144,12 +184,12 @@ Point BufferPointRecord::pointBefore(const string& identifier, time_t time, Wher
         // and we're not at the end, so the point is within the continuous buffer
         // we want the previous point
         foundPoint = *(--it);
-        PointRecord::addPoint(identifier, foundPoint);
+        this->_cachePoint(series, foundPoint);
       }
       else if ((--it)->time == time - 1) {
         // edge case where end of buffer is adjacent to requested time
         foundPoint = *it;
-        PointRecord::addPoint(identifier, foundPoint);
+        this->_cachePoint(series, foundPoint);
       }
     }
     
@@ -163,7 +203,7 @@ Point BufferPointRecord::pointBefore(const string& identifier, time_t time, Wher
       }
       if (it != buffer.begin()) {
         foundPoint = *it;
-        PointRecord::addPoint(identifier, foundPoint);
+        this->_cachePoint(series, foundPoint);
         return foundPoint;
       }
     }
@@ -175,12 +215,21 @@ Point BufferPointRecord::pointBefore(const string& identifier, time_t time, Wher
 
 // pre-supposes that the time supplied is within my buffer.
 Point BufferPointRecord::pointAfter(const string& identifier, time_t time, WhereClause q) {
+  return BufferPointRecord::pointAfter(this->handleForIdentifier(identifier), time, q);
+}
+
+Point BufferPointRecord::pointAfter(SeriesHandle series, time_t time, WhereClause q) {
   
   scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
   
   Point foundPoint;
   
-  auto vRange = this->range(identifier);
+  auto it = _keyedBuffers.find(series);
+  if (it == _keyedBuffers.end()) {
+    return foundPoint;
+  }
+  this->_mergeLiveEdge(it->second);
+  TimeRange vRange(_firstPoint(it->second).time, _lastPoint(it->second).time);
   if (!vRange.contains(time)) {
     // don't bother if its' not in range
     return foundPoint;
@@ -189,7 +238,14 @@ Point BufferPointRecord::pointAfter(const string& identifier, time_t time, Where
   //TimePointPair_t finder(time, PointPair_t(0,0));
   Point finder(time, 0);
   
-  auto it = _keyedBuffers.find(identifier);
+  if (it != _keyedBuffers.end() && it->second.dense) {
+    auto accept = (q.clauses.empty()) ? std::function<bool(const Point&)>() : [&](const Point& p) { return q.filter(p); };
+    foundPoint = it->second.regular.pointAfter(time, accept);
+    if (foundPoint.isValid) {
+      this->_cachePoint(series, foundPoint);
+    }
+    return foundPoint;
+  }
   if (it != _keyedBuffers.end()) {
     // get the constituents
     PointBuffer& buffer = (it->second.circularBuffer);
@@ -202,7 +258,7 @@ Point BufferPointRecord::pointAfter(const string& identifier, time_t time, Where
         // either we're not at the beginning, so the point is within the continuous buffer -
         // or edge case where beginning of buffer is adjacent to requested time
         foundPoint = *it;
-        PointRecord::addPoint(identifier, foundPoint); // single point cache layer
+        this->_cachePoint(series, foundPoint); // single point cache layer
       }
     }
     
@@ -216,7 +272,7 @@ Point BufferPointRecord::pointAfter(const string& identifier, time_t time, Where
       }
       if (it != buffer.end()) {
         foundPoint = *it;
-        PointRecord::addPoint(identifier, foundPoint);
+        this->_cachePoint(series, foundPoint);
         return foundPoint;
       }
     }
@@ -228,6 +284,10 @@ Point BufferPointRecord::pointAfter(const string& identifier, time_t time, Where
 
 
 std::vector<Point> BufferPointRecord::pointsInRange(const string& identifier, TimeRange range) {
+  return BufferPointRecord::pointsInRange(this->handleForIdentifier(identifier), range);
+}
+
+std::vector<Point> BufferPointRecord::pointsInRange(SeriesHandle series, TimeRange range) {
   
   scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
   
@@ -236,9 +296,13 @@ std::vector<Point> BufferPointRecord::pointsInRange(const string& identifier, Ti
   //TimePointPair_t finder(startTime, PointPair_t(0,0));
   Point finder(range.start, 0);
   
-  auto it = _keyedBuffers.find(identifier);
+  auto it = _keyedBuffers.find(series);
   if (it != _keyedBuffers.end()) {
     // get the constituents
+    this->_mergeLiveEdge(it->second);
+    if (it->second.dense) {
+      return it->second.regular.pointsInRange(range);
+    }
     PointBuffer& buffer = (it->second.circularBuffer);
     
     PointBuffer::const_iterator it = lower_bound(buffer.begin(), buffer.end(), finder, &Point::comparePointTime);
@@ -254,8 +318,29 @@ std::vector<Point> BufferPointRecord::pointsInRange(const string& identifier, Ti
 
 
 void BufferPointRecord::addPoint(const string& identifier, Point point) {
+  BufferPointRecord::addPoint(this->handleForIdentifier(identifier), point);
+}
+
+void BufferPointRecord::addPoint(SeriesHandle series, Point point) {
+  
+  if (_liveEdgeCapacity.load(memory_order_relaxed) > 0) {
+    shared_ptr<const LiveEdgeIndex> edges = atomic_load(&_liveEdges);
+    if (edges && series < edges->size() && (*edges)[series]) {
+      if ((*edges)[series]->push(point)) {
+        return;
+      }
+      // ring is full; nobody has read this series lately. merge it ourselves.
+      scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
+      auto it = _keyedBuffers.find(series);
+      if (it != _keyedBuffers.end()) {
+        this->_mergeLiveEdge(it->second);
+        this->_appendLivePoint(it->second, point);
+      }
+      return;
+    }
+  }
   
-  PointRecord::addPoint(identifier, point);
+  this->_cachePoint(series, point);
   
   // do something more interesting in your derived class.
   // why nothing smart? because how can you ensure that a point you want to insert here is contiguous?
@@ -264,16 +349,38 @@ void BufferPointRecord::addPoint(const string& identifier, Point point) {
 }
 
 
-void BufferPointRecord::addPoints(const string& identifier, std::vector<Point> points) {
-  if (points.size() == 0) {
+void BufferPointRecord::addPoints(const string& identifier, const std::vector<Point>& newPoints) {
+  BufferPointRecord::addPoints(this->handleForIdentifier(identifier), newPoints);
+}
+
+void BufferPointRecord::addPoints(SeriesHandle series, const std::vector<Point>& newPoints) {
+  if (newPoints.size() == 0) {
     return;
   }
   
+  // make sure they're in order. they almost always are, so only copy when we have to sort.
+  vector<Point> sortedCopy;
+  if (!std::is_sorted(newPoints.begin(), newPoints.end(), &Point::comparePointTime)) {
+    sortedCopy = newPoints;
+    std::sort(sortedCopy.begin(), sortedCopy.end(), &Point::comparePointTime);
+  }
+  const vector<Point>& points = (sortedCopy.empty()) ? newPoints : sortedCopy;
+  
   scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
   
   // check the cache size, and upgrade if needed.
-  auto it = _keyedBuffers.find(identifier);
+  auto it = _keyedBuffers.find(series);
   if (it != _keyedBuffers.end()) {
+    this->_mergeLiveEdge(it->second); // keep live points ordered ahead of this batch
+    if (it->second.dense) {
+      if (it->second.denseCapacity < points.size()) {
+        it->second.denseCapacity += points.size();
+      }
+      if (this->_addPointsDense(it->second, points)) {
+        return;
+      }
+      _makeSparse(it->second);
+    }
     PointBuffer& buffer = (it->second.circularBuffer);
     size_t capacity = buffer.capacity();
     if (capacity < points.size()) {
@@ -287,10 +394,7 @@ void BufferPointRecord::addPoints(const string& identifier, std::vector<Point> p
     time_t firstInsertionTime = points.front().time;
     time_t lastInsertionTime = points.back().time;
     
-    TimeRange existingRange = BufferPointRecord::range(identifier);
-    
-    // make sure they're in order
-    std::sort(points.begin(), points.end(), &Point::comparePointTime);
+    TimeRange existingRange(_firstPoint(it->second).time, _lastPoint(it->second).time);
     
     // scoped for clarity
     {
@@ -306,7 +410,7 @@ void BufferPointRecord::addPoints(const string& identifier, std::vector<Point> p
         // now insert these trailing points.
         while (pIt != points.end()) {
           if (pIt->time > existingRange.end) {
-            //BufferPointRecord::addPoint(identifier, *pIt);
+            //Bufferthis->_cachePoint(series, *pIt);
             // append to circular buffer.
             buffer.push_back(*pIt);
           }
@@ -346,18 +450,20 @@ void BufferPointRecord::addPoints(const string& identifier, std::vector<Point> p
       // and insert the new points all by themselves.
       if (gap) {
         // clear the buffer and set the capacity to something more conservative.
+        // never below the default, or small live-edge appends would immediately push out older points.
         buffer.clear();
-        buffer.set_capacity(points.size());
+        buffer.set_capacity(RTX_MAX(points.size(), _defaultCapacity));
         
         // add new points.
         for(const Point &p : points) {
           buffer.push_back(p);
         }
+        this->_makeDenseIfRegular(it->second);
       } // gap
     }// scoped
   }
   else {
-    cerr << "keyed buffer not found for id: " << identifier << EOL;
+    cerr << "keyed buffer not found for id: " << this->identifierForHandle(series) << EOL;
   }
 }
 
@@ -373,47 +479,221 @@ void BufferPointRecord::reset() {
 }
 
 void BufferPointRecord::reset(const string& identifier) {
+  BufferPointRecord::reset(this->handleForIdentifier(identifier));
+}
+
+void BufferPointRecord::reset(SeriesHandle series) {
   scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
-  auto it = _keyedBuffers.find(identifier);
+  auto it = _keyedBuffers.find(series);
   if (it != _keyedBuffers.end()) {
     PointBuffer& buffer = (it->second.circularBuffer);
+    if (it->second.live) {
+      Point discard;
+      while (it->second.live->pop(discard)) {}
+    }
+    if (it->second.dense) {
+      buffer.set_capacity(it->second.denseCapacity);
+      it->second.regular = RegularSeries();
+      it->second.dense = false;
+    }
     buffer.clear();
   }
 }
 
 
 Point BufferPointRecord::firstPoint(const string& id) {
-  Point foundPoint;
-  auto it = _keyedBuffers.find(id);
-  if (it != _keyedBuffers.end()) {
-    PointBuffer& buffer = (it->second.circularBuffer);
-    if (buffer.empty()) {
-      return foundPoint;
+  auto it = _keyedBuffers.find(this->handleForIdentifier(id));
+  return (it != _keyedBuffers.end()) ? _firstPoint(it->second) : Point();
+}
+
+Point BufferPointRecord::lastPoint(const string& id) {
+  auto it = _keyedBuffers.find(this->handleForIdentifier(id));
+  return (it != _keyedBuffers.end()) ? _lastPoint(it->second) : Point();
+}
+
+TimeRange BufferPointRecord::range(const string& id) {
+  return TimeRange(BufferPointRecord::firstPoint(id).time, BufferPointRecord::lastPoint(id).time);
+}
+
+Point BufferPointRecord::_firstPoint(const Buffer& b) {
+  if (b.dense) {
+    return b.regular.first();
+  }
+  return (b.circularBuffer.empty()) ? Point() : b.circularBuffer.front();
+}
+
+Point BufferPointRecord::_lastPoint(const Buffer& b) {
+  if (b.dense) {
+    return b.regular.last();
+  }
+  return (b.circularBuffer.empty()) ? Point() : b.circularBuffer.back();
+}
+
+
+
+#pragma mark - live edge
+
+void BufferPointRecord::setLiveEdgeCapacity(size_t capacity) {
+  scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
+  for (auto& kb : _keyedBuffers) {
+    this->_mergeLiveEdge(kb.second);
+    kb.second.live = (capacity > 0) ? make_shared<LiveEdge>(capacity) : shared_ptr<LiveEdge>();
+  }
+  _liveEdgeCapacity.store(capacity);
+  this->_publishLiveEdges();
+}
+
+size_t BufferPointRecord::liveEdgeCapacity() {
+  return _liveEdgeCapacity.load();
+}
+
+void BufferPointRecord::_publishLiveEdges() {
+  // call with _bigMutex held
+  shared_ptr<LiveEdgeIndex> edges(new LiveEdgeIndex);
+  for (auto& kb : _keyedBuffers) {
+    if (kb.second.live) {
+      if (kb.first >= edges->size()) {
+        edges->resize(kb.first + 1);
+      }
+      (*edges)[kb.first] = kb.second.live;
     }
-    foundPoint = buffer.front(); // Point(tpPair.first, tpPair.second.first);
   }
-  return foundPoint;
+  atomic_store(&_liveEdges, shared_ptr<const LiveEdgeIndex>(edges));
 }
 
-Point BufferPointRecord::lastPoint(const string& id) {
-  Point foundPoint;
-  auto it = _keyedBuffers.find(id);
-  if (it != _keyedBuffers.end()) {
-    // get the constituents
-    //boost::signals2::mutex *mutex = (it->second.second.get());
-    PointBuffer& buffer = (it->second.circularBuffer);
-    
-    if (buffer.empty()) {
-      return foundPoint;
+void BufferPointRecord::_mergeLiveEdge(Buffer& buffer) {
+  // call with _bigMutex held, which also makes this the ring's only consumer
+  if (!buffer.live) {
+    return;
+  }
+  Point p;
+  while (buffer.live->pop(p)) {
+    this->_appendLivePoint(buffer, p);
+  }
+}
+
+void BufferPointRecord::_appendLivePoint(Buffer& b, const Point& p) {
+  if (b.dense) {
+    RegularSeries& dense = b.regular;
+    if (!dense.empty() && p.time < dense.range().start) {
+      return; // history, not live data. use addPoints for that.
     }
-    
-    //TimePointPair_t tpPair = buffer.back();
-    foundPoint = buffer.back(); // Point(tpPair.first, tpPair.second.first);
-    
+    if (dense.isAligned(p.time) && dense.slotsToInclude(p.time) <= std::max(dense.slots(), (size_t)64)) {
+      dense.set(p);
+      dense.trimFront(b.denseCapacity); // like the full circular buffer, let go of the oldest
+      return;
+    }
+    _makeSparse(b);
+  }
+  
+  PointBuffer& buffer = b.circularBuffer;
+  if (buffer.empty() || buffer.back().time < p.time) {
+    buffer.push_back(p); // a full buffer lets go of its oldest point
+    if (buffer.size() == 2) {
+      this->_makeDenseIfRegular(b);
+    }
+    return;
+  }
+  if (p.time < buffer.front().time) {
+    return; // history, not live data. use addPoints for that.
+  }
+  PointBuffer::iterator pos = lower_bound(buffer.begin(), buffer.end(), p, &Point::comparePointTime);
+  if (pos != buffer.end() && pos->time == p.time) {
+    *pos = p;
+  }
+  else {
+    buffer.insert(pos, p);
   }
-  return foundPoint;
 }
 
-TimeRange BufferPointRecord::range(const string& id) {
-  return TimeRange(BufferPointRecord::firstPoint(id).time, BufferPointRecord::lastPoint(id).time);
+
+#pragma mark - regular storage
+
+void BufferPointRecord::setRegularStorage(bool regular) {
+  scoped_lock<boost::signals2::mutex> bigLock(_bigMutex);
+  _regularStorage.store(regular);
+  for (auto& kb : _keyedBuffers) {
+    if (regular) {
+      this->_makeDenseIfRegular(kb.second);
+    }
+    else {
+      _makeSparse(kb.second);
+    }
+  }
+}
+
+bool BufferPointRecord::regularStorage() {
+  return _regularStorage.load();
+}
+
+bool BufferPointRecord::_addPointsDense(Buffer& b, const std::vector<Point>& points) {
+  // same placement rules as the point buffer in addPoints. false if the points don't fit the grid.
+  RegularSeries& dense = b.regular;
+  TimeRange existing = dense.range();
+  time_t first = points.front().time, last = points.back().time;
+  bool append = (first <= existing.end && existing.end < last);
+  bool prepend = (first < existing.start && existing.start <= last);
+  bool overlap = (existing.start <= first && last <= existing.end);
+  if (!append && !prepend && !overlap) {
+    return false; // a gap. the point buffer path starts over, and may come back to dense.
+  }
+  
+  // check everything before changing anything
+  for (const Point& p : points) {
+    if ((p.time < existing.start || existing.end < p.time) && !dense.isAligned(p.time)) {
+      return false;
+    }
+  }
+  size_t newSlots = (append ? dense.slotsToInclude(last) : 0) + (prepend ? dense.slotsToInclude(first) : 0);
+  if (newSlots > 2 * points.size()) {
+    return false;
+  }
+  
+  if (append) {
+    for (const Point& p : points) {
+      if (p.time > existing.end) {
+        dense.set(p);
+      }
+    }
+    dense.trimFront(b.denseCapacity);
+  }
+  if (prepend) {
+    for (auto pIt = points.rbegin(); pIt != points.rend(); ++pIt) {
+      if (pIt->time < existing.start) {
+        dense.set(*pIt);
+      }
+    }
+    dense.trimBack(b.denseCapacity);
+  }
+  return true;
+}
+
+void BufferPointRecord::_makeDenseIfRegular(Buffer& b) {
+  if (!_regularStorage.load(memory_order_relaxed) || b.dense || b.circularBuffer.size() < 2) {
+    return;
+  }
+  vector<Point> points(b.circularBuffer.begin(), b.circularBuffer.end());
+  time_t period;
+  if (!RegularSeries::detectPeriod(points, period)) {
+    return;
+  }
+  b.regular = RegularSeries(period);
+  for (const Point& p : points) {
+    b.regular.set(p);
+  }
+  b.denseCapacity = b.circularBuffer.capacity();
+  PointBuffer().swap(b.circularBuffer); // give back the point buffer's memory
+  b.dense = true;
+}
+
+void BufferPointRecord::_makeSparse(Buffer& b) {
+  if (!b.dense) {
+    return;
+  }
+  b.circularBuffer.set_capacity(std::max(b.denseCapacity, b.regular.count()));
+  for (const Point& p : b.regular.points()) {
+    b.circularBuffer.push_back(p);
+  }
+  b.regular = RegularSeries();
+  b.dense = false;
 }
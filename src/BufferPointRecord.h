@@ -20,7 +20,11 @@
 #include "rtxMacros.h"
 #include "rtxExceptions.h"
 #include "PointRecord.h"
+#include "RtxRing.h"
+#include "RegularSeries.h"
 
+#include <atomic>
+#include <memory>
 #include <boost/circular_buffer.hpp>
 #include <boost/signals2/mutex.hpp>
 
@@ -48,26 +52,74 @@ namespace RTX {
     virtual TimeRange range(const string& id);
     
     virtual void addPoint(const string& identifier, Point point);
-    virtual void addPoints(const string& identifier, std::vector<Point> points);
+    virtual void addPoints(const string& identifier, const std::vector<Point>& newPoints);
     
     virtual void reset();
     virtual void reset(const string& identifier);
     
+    virtual Point point(SeriesHandle series, time_t time);
+    virtual Point pointBefore(SeriesHandle series, time_t time, WhereClause q = WhereClause());
+    virtual Point pointAfter(SeriesHandle series, time_t time, WhereClause q = WhereClause());
+    virtual std::vector<Point> pointsInRange(SeriesHandle series, TimeRange range);
+    virtual void addPoint(SeriesHandle series, Point point);
+    virtual void addPoints(SeriesHandle series, const std::vector<Point>& newPoints);
+    virtual void reset(SeriesHandle series);
+    
     virtual std::ostream& toStream(std::ostream &stream);
     
+    /*!
+     \fn void BufferPointRecord::setLiveEdgeCapacity(size_t capacity)
+     \brief Opt in to lock-free appends at the live edge of each series.
+     
+     With a non-zero capacity, addPoint() hands each point to a per-series lock-free ring instead of taking the record's lock. The next reader of that series merges the ring, in order, into the sorted buffer before it looks anything up. New times append to the buffer, repeated times replace the buffered value, and times before the start of the buffer are ignored. If a ring fills up because nobody is reading, the producer merges it under the lock itself.
+     
+     firstPoint(), lastPoint() and range() only see points that have been merged. Zero (the default) turns live-edge mode off, and addPoint() only feeds the single-point cache.
+     */
+    void setLiveEdgeCapacity(size_t capacity);
+    size_t liveEdgeCapacity();
+    
+    /*!
+     \fn void BufferPointRecord::setRegularStorage(bool regular)
+     \brief Store clock-aligned series densely.
+     
+     When enabled, a series whose points fall on a regular time grid is kept as a RegularSeries instead of a buffer of points. That is roughly a third of the memory, and time lookups are O(1) instead of a binary search. A series is checked when it is (re)filled after a gap, and when a live edge reaches two points. It goes back to a point buffer (until its next refill) if a point arrives off the grid. Lookups return the same points either way, except that a filtered pointBefore() or pointAfter() on dense storage returns an invalid point when nothing passes the WhereClause.
+     */
+    void setRegularStorage(bool regular);
+    bool regularStorage();
     
   protected:
     
   private:
     typedef boost::circular_buffer<Point> PointBuffer;
+    typedef RtxRing<Point> LiveEdge;
+    typedef std::vector<std::shared_ptr<LiveEdge> > LiveEdgeIndex; // by handle
     class Buffer {
     public:
       Units units;
       PointBuffer circularBuffer;
+      std::shared_ptr<LiveEdge> live;
+      bool dense = false;     // points are in `regular`, and circularBuffer is empty
+      RegularSeries regular;
+      size_t denseCapacity = 0;
     };
-    std::map<std::string, Buffer> _keyedBuffers;
+    std::map<SeriesHandle, Buffer> _keyedBuffers;
+    static Point _firstPoint(const Buffer& buffer);
+    static Point _lastPoint(const Buffer& buffer);
     size_t _defaultCapacity;
     boost::signals2::mutex _bigMutex;
+    
+    // live edge: producers look up rings in an immutable snapshot, republished (under _bigMutex) when series change
+    std::atomic<size_t> _liveEdgeCapacity;
+    std::shared_ptr<const LiveEdgeIndex> _liveEdges;
+    void _publishLiveEdges();
+    void _mergeLiveEdge(Buffer& buffer);
+    void _appendLivePoint(Buffer& buffer, const Point& p);
+    
+    // dense storage for regular series
+    std::atomic<bool> _regularStorage;
+    bool _addPointsDense(Buffer& buffer, const std::vector<Point>& points);
+    void _makeDenseIfRegular(Buffer& buffer);
+    static void _makeSparse(Buffer& buffer);
   };
   
   std::ostream& operator<< (std::ostream &out, BufferPointRecord &pr);
@@ -134,7 +134,7 @@ PointCollection CorrelatorTimeSeries::filterPointsInRange(TimeRange range) {
         for (Point &p : pv) {
           p.time -= timeDistance;
         }          
-        secondaryCollection.setPoints(pv);
+        secondaryCollection.setPoints(std::move(pv));
       }
       
       // resample secondary points for the correlation analysis.
@@ -182,7 +182,7 @@ PointCollection CorrelatorTimeSeries::filterPointsInRange(TimeRange range) {
     
   }
   
-  return PointCollection(thePoints, RTX_DIMENSIONLESS);
+  return PointCollection(std::move(thePoints), RTX_DIMENSIONLESS);
 }
 
 bool CorrelatorTimeSeries::canSetSource(TimeSeries::_sp ts) {
@@ -209,3 +209,14 @@ bool CorrelatorTimeSeries::canChangeToUnits(Units units) {
   return false;
 }
 
+TimeSeriesFilter::Reach CorrelatorTimeSeries::reach() {
+  // correlation window behind, lag search on both sides
+  Reach r;
+  r.resampleNeighbors = true;
+  r.lookBehind = 2 * _lagSeconds;
+  r.lookAhead = 2 * _lagSeconds;
+  if (this->correlationWindow()) {
+    r.lookBehind += this->correlationWindow()->period();
+  }
+  return r;
+}
@@ -37,6 +37,8 @@ namespace RTX {
     CorrelatorTimeSeries::_sp window(Clock::_sp w) {this->setCorrelationWindow(w); return share_me(this);};
     CorrelatorTimeSeries::_sp lag(int seconds) {this->setLagSeconds(seconds); return share_me(this);};
     
+    Reach reach();
+    
   protected:
     bool canSetSecondary(TimeSeries::_sp secondary);
     void didSetSecondary(TimeSeries::_sp secondary);
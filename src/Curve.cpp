@@ -62,6 +62,6 @@ PointCollection Curve::convert(const PointCollection &pc, bool saturate) {
       outp.push_back(op);
     }
   });
-  out.setPoints(outp);
+  out.setPoints(std::move(outp));
   return out;
 }
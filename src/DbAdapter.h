@@ -61,8 +61,15 @@ namespace RTX {
     
     // CREATE
     virtual bool insertIdentifierAndUnits(const std::string& id, Units units) = 0;
+    virtual bool insertIdentifiersAndUnits(const std::vector< std::pair<std::string, Units> >& idUnits) {
+      bool ok = true;
+      for (auto& idu : idUnits) {
+        ok = this->insertIdentifierAndUnits(idu.first, idu.second) && ok;
+      }
+      return ok;
+    };
     virtual void insertSingle(const std::string& id, Point point) = 0;
-    virtual void insertRange(const std::string& id, std::vector<Point> points) = 0;
+    virtual void insertRange(const std::string& id, const std::vector<Point>& points) = 0;
     
     // UPDATE
     virtual bool assignUnitsToRecord(const std::string& name, const Units& units) = 0;
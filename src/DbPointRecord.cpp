@@ -16,6 +16,7 @@
 
 #include "DbPointRecord.h"
 #include "DbAdapter.h"
+#include "RtxTrace.h"
 
 using namespace RTX;
 using namespace std;
@@ -23,15 +24,16 @@ using boost::signals2::mutex;
 
 #define _DB_MAX_CONNECT_TRY 5
 #define SERIES_LIST_TTL 30
+#define _DB_NO_SERIES ((PointRecord::SeriesHandle)-1)
 
 /************ request type *******************/
 
-DbPointRecord::request_t::request_t(string id, TimeRange r_range) : range(r_range), id(id) { }
+DbPointRecord::request_t::request_t(SeriesHandle series, TimeRange r_range) : range(r_range), series(series) { }
 
-bool DbPointRecord::request_t::contains(std::string id, time_t t) {
+bool DbPointRecord::request_t::contains(SeriesHandle series, time_t t) {
   if (this->range.start <= t 
       && t <= this->range.end 
-      && RTX_STRINGS_ARE_EQUAL(id, this->id)) {
+      && series == this->series) {
     return true;
   }
   return false;
@@ -39,7 +41,7 @@ bool DbPointRecord::request_t::contains(std::string id, time_t t) {
 
 void DbPointRecord::request_t::clear() {
   this->range = TimeRange();
-  this->id = "";
+  this->series = _DB_NO_SERIES;
 }
 
 
@@ -50,7 +52,7 @@ void DbPointRecord::request_t::clear() {
 
 /************ impl *******************/
 
-DbPointRecord::DbPointRecord() : _last_request("",TimeRange()) {
+DbPointRecord::DbPointRecord() : _last_request(_DB_NO_SERIES,TimeRange()) {
   _adapter = NULL;
   errorMessage = "Not Connected";
   _readOnly = false;
@@ -152,11 +154,6 @@ bool DbPointRecord::registerAndGetIdentifierForSeriesWithUnits(string name, Unit
     return DB_PR_SUPER::registerAndGetIdentifierForSeriesWithUnits(name, units);
   }
   
-  // no matter what happens, we are messing with cache invalidation... 
-  if (!_adapter->inTransaction()) {
-    _lastIdRequest = 0; // so invalidate the request cache.  
-  }
-
   // almost ideal: name is good, units mismatch, but adaptor doesn't care
   if (nameExists 
       && !unitsMatch 
@@ -172,6 +169,8 @@ bool DbPointRecord::registerAndGetIdentifierForSeriesWithUnits(string name, Unit
       && existingUnits == RTX_NO_UNITS) 
   {
     _adapter->assignUnitsToRecord(name, units);
+    _identifiersAndUnitsCache.set(name, units); // keep the catalog current, rather than re-listing everything
+    this->_catalogChanged();
     return DB_PR_SUPER::registerAndGetIdentifierForSeriesWithUnits(name, units);
   }
   
@@ -186,6 +185,10 @@ bool DbPointRecord::registerAndGetIdentifierForSeriesWithUnits(string name, Unit
     
     // by now, nothing is there - insert a new series.
     bool inserted = _adapter->insertIdentifierAndUnits(name, units);
+    if (inserted) {
+      _identifiersAndUnitsCache.set(name, units);
+    }
+    this->_catalogChanged();
     bool cached = DB_PR_SUPER::registerAndGetIdentifierForSeriesWithUnits(name, units);
     return inserted && cached;
   }
@@ -204,6 +207,67 @@ bool DbPointRecord::registerAndGetIdentifierForSeriesWithUnits(string name, Unit
 }
 
 
+vector<bool> DbPointRecord::registerAndGetIdentifiersForSeriesWithUnits(const vector< pair<string, Units> >& idUnits) {
+  vector<bool> registered(idUnits.size(), false);
+  
+  // one catalog lookup for the lot.
+  IdentifierUnitsList known = this->identifiersAndUnits();
+  vector<pair<string,Units> > missing;
+  vector<size_t> missingIndex, mismatchedIndex;
+  
+  for (size_t i = 0; i < idUnits.size(); ++i) {
+    const string& name = idUnits[i].first;
+    if (name.length() == 0) {
+      continue;
+    }
+    auto match = known.doesHaveIdUnits(name, idUnits[i].second);
+    if (match.first && match.second) {
+      registered[i] = DB_PR_SUPER::registerAndGetIdentifierForSeriesWithUnits(name, idUnits[i].second);
+    }
+    else if (!match.first) {
+      missing.push_back(idUnits[i]);
+      missingIndex.push_back(i);
+    }
+    else {
+      mismatchedIndex.push_back(i);
+    }
+  }
+  
+  // new series are created in one adapter call, inside one transaction.
+  if (!missing.empty()) {
+    std::lock_guard<std::mutex> lock(_db_pr_mtx);
+    bool connected = checkConnected();
+    bool inserted = false;
+    if (connected && !this->readonly()) {
+      bool wasInTransaction = _adapter->inTransaction();
+      if (!wasInTransaction) {
+        _adapter->beginTransaction();
+      }
+      inserted = _adapter->insertIdentifiersAndUnits(missing);
+      if (!wasInTransaction) {
+        _adapter->endTransaction();
+      }
+      if (inserted) {
+        _identifiersAndUnitsCache.set(missing);
+        this->_catalogChanged();
+      }
+    }
+    for (size_t k = 0; k < missing.size(); ++k) {
+      if (!connected || inserted) {
+        registered[missingIndex[k]] = DB_PR_SUPER::registerAndGetIdentifierForSeriesWithUnits(missing[k].first, missing[k].second);
+      }
+    }
+  }
+  
+  // units conflicts are rare, and have their own rules.
+  for (size_t i : mismatchedIndex) {
+    registered[i] = this->registerAndGetIdentifierForSeriesWithUnits(idUnits[i].first, idUnits[i].second);
+  }
+  
+  return registered;
+}
+
+
 IdentifierUnitsList DbPointRecord::identifiersAndUnits() {
   std::lock_guard<std::mutex> lock(_db_pr_mtx);
   time_t now = time(NULL);
@@ -214,7 +278,11 @@ IdentifierUnitsList DbPointRecord::identifiersAndUnits() {
   }
   
   if (checkConnected()) {
-    _identifiersAndUnitsCache = _adapter->idUnitsList();
+    IdentifierUnitsList fresh = _adapter->idUnitsList();
+    if (!(*fresh.get() == *_identifiersAndUnitsCache.get())) {
+      this->_catalogChanged(); // somebody else changed the database
+    }
+    _identifiersAndUnitsCache = fresh;
     _lastIdRequest = time(NULL);
   }
   return _identifiersAndUnitsCache;
@@ -253,7 +321,8 @@ vector<Point> DbPointRecord::pointsWithQuery(const string& query, TimeRange rang
 
 Point DbPointRecord::point(const string& id, time_t time) {
   
-  Point p = DB_PR_SUPER::point(id, time);
+  SeriesHandle series = this->handleForIdentifier(id);
+  Point p = DB_PR_SUPER::point(series, time);
   
   if (!checkConnected()) {
     return p;
@@ -265,7 +334,7 @@ Point DbPointRecord::point(const string& id, time_t time) {
     // if so, and Super couldn't find it, then it's just not here.
     // todo -- check staleness
     
-    if (_last_request.contains(id, time)) {
+    if (_last_request.contains(series, time)) {
       return Point();
     }
     
@@ -274,14 +343,13 @@ Point DbPointRecord::point(const string& id, time_t time) {
     
     // do the request, and cache the request parameters.
     
-    vector<Point> pVec = _adapter->selectRange(id, TimeRange(start, end));
-    pVec = this->pointsWithOpcFilter(pVec);
+    vector<Point> pVec = this->_selectRange(id, TimeRange(start, end));
     
     if (pVec.size() > 0) {
-      _last_request = request_t(id, TimeRange(pVec.front().time, pVec.back().time));
+      _last_request = request_t(series, TimeRange(pVec.front().time, pVec.back().time));
     }
     else {
-      _last_request = request_t(id,TimeRange());
+      _last_request = request_t(series,TimeRange());
     }
     
     
@@ -296,7 +364,7 @@ Point DbPointRecord::point(const string& id, time_t time) {
       ++pIt;
     }
     // cache this latest result set
-    DB_PR_SUPER::addPoints(id, pVec);
+    DB_PR_SUPER::addPoints(series, pVec);
   }
   
   
@@ -308,7 +376,7 @@ Point DbPointRecord::point(const string& id, time_t time) {
 Point DbPointRecord::pointBefore(const string& id, time_t time, WhereClause q) {
   
   // available in circular buffer?
-  Point p = DB_PR_SUPER::pointBefore(id, time, q);
+  Point p = DB_PR_SUPER::pointBefore(this->handleForIdentifier(id), time, q);
   if (p.isValid) {
     return p;
   }
@@ -346,7 +414,7 @@ Point DbPointRecord::pointBefore(const string& id, time_t time, WhereClause q) {
 
 Point DbPointRecord::pointAfter(const string& id, time_t time, WhereClause q) {
   // buffered?
-  Point p = DB_PR_SUPER::pointAfter(id, time, q);
+  Point p = DB_PR_SUPER::pointAfter(this->handleForIdentifier(id), time, q);
   if (p.isValid) {
     return p;
   }
@@ -432,14 +500,18 @@ Point DbPointRecord::searchNextIteratively(const string& id, time_t time) {
 
 std::vector<Point> DbPointRecord::pointsInRange(const string& id, TimeRange qrange) {
   std::lock_guard<std::mutex> lock(_db_pr_mtx);
+  SeriesHandle series = this->handleForIdentifier(id);
   
   // limit double-queries
-  if (_last_request.range.containsRange(qrange) && _last_request.id == id) {
-    return DB_PR_SUPER::pointsInRange(id, qrange);
+  if (_last_request.range.containsRange(qrange) && _last_request.series == series) {
+    if (RtxTrace::enabled()) {
+      RtxTrace::note("cache", "hit");
+    }
+    return DB_PR_SUPER::pointsInRange(series, qrange);
   }
   
   if (!checkConnected()) {
-    return DB_PR_SUPER::pointsInRange(id, qrange);
+    return DB_PR_SUPER::pointsInRange(series, qrange);
   }
   
   TimeRange range = DB_PR_SUPER::range(id);
@@ -447,9 +519,15 @@ std::vector<Point> DbPointRecord::pointsInRange(const string& id, TimeRange qran
 
   // if the requested range is not in memcache, then fetch it.
   if ( intersect == TimeRange::intersect_other_internal ) {
-    return DB_PR_SUPER::pointsInRange(id, qrange);
+    if (RtxTrace::enabled()) {
+      RtxTrace::note("cache", "hit");
+    }
+    return DB_PR_SUPER::pointsInRange(series, qrange);
   }
   else {
+    if (RtxTrace::enabled()) {
+      RtxTrace::note("cache", (intersect == TimeRange::intersect_none) ? "miss" : "partial");
+    }
     vector<Point> left, middle, right;
     TimeRange n_range;
     
@@ -457,15 +535,15 @@ std::vector<Point> DbPointRecord::pointsInRange(const string& id, TimeRange qran
       // left-fill query
       n_range.start = qrange.start;
       n_range.end = range.start;
-      middle = this->pointsWithOpcFilter(_adapter->selectRange(id, n_range));
-      right = DB_PR_SUPER::pointsInRange(id, TimeRange(range.start, qrange.end));
+      middle = this->_selectRange(id, n_range);
+      right = DB_PR_SUPER::pointsInRange(series, TimeRange(range.start, qrange.end));
     }
     else if (intersect == TimeRange::intersect_right) {
       // right-fill query
       n_range.start = range.end;
       n_range.end = qrange.end;
-      left = DB_PR_SUPER::pointsInRange(id, TimeRange(qrange.start, range.end));
-      middle = this->pointsWithOpcFilter(_adapter->selectRange(id, n_range));
+      left = DB_PR_SUPER::pointsInRange(series, TimeRange(qrange.start, range.end));
+      middle = this->_selectRange(id, n_range);
     }
     else if (intersect == TimeRange::intersect_other_external){
       // query overlaps but extends on both sides
@@ -476,12 +554,12 @@ std::vector<Point> DbPointRecord::pointsInRange(const string& id, TimeRange qran
       q_right.start = range.end;
       q_right.end = qrange.end;
       
-      left = this->pointsWithOpcFilter(_adapter->selectRange(id, q_left));
-      middle = DB_PR_SUPER::pointsInRange(id, range);
-      right = this->pointsWithOpcFilter(_adapter->selectRange(id, q_right));
+      left = this->_selectRange(id, q_left);
+      middle = DB_PR_SUPER::pointsInRange(series, range);
+      right = this->_selectRange(id, q_right);
     }
     else {
-      middle = this->pointsWithOpcFilter(_adapter->selectRange(id, qrange));
+      middle = this->_selectRange(id, qrange);
     }
     // db hit
     
@@ -503,26 +581,48 @@ std::vector<Point> DbPointRecord::pointsInRange(const string& id, TimeRange qran
       }
     }
     
-    _last_request = (deDuped.size() > 0) ? request_t(id, qrange) : request_t(id,TimeRange());
-    DB_PR_SUPER::addPoints(id, deDuped);
+    _last_request = (deDuped.size() > 0) ? request_t(series, qrange) : request_t(series,TimeRange());
+    DB_PR_SUPER::addPoints(series, deDuped);
     return deDuped;
   }
 }
 
 
+vector<Point> DbPointRecord::_selectRange(const string& id, TimeRange range) {
+  RtxTrace::Span span("adapter");
+  if (span.active()) {
+    span.setName(RtxTrace::typeName(typeid(*_adapter)) + "::selectRange");
+    span.setSeries(id);
+    span.arg("start", range.start);
+    span.arg("end", range.end);
+  }
+  vector<Point> points = this->pointsWithOpcFilter(_adapter->selectRange(id, range));
+  if (span.active()) {
+    span.setPointsOut(points.size());
+  }
+  return points;
+}
+
+
 void DbPointRecord::addPoint(const string& id, Point point) {
   std::lock_guard<std::mutex> lock(_db_pr_mtx);
   if (!this->readonly() && checkConnected()) {
-    DB_PR_SUPER::addPoint(id, point);
+    DB_PR_SUPER::addPoint(this->handleForIdentifier(id), point);
     _adapter->insertSingle(id, point);
   }
 }
 
 
-void DbPointRecord::addPoints(const string& id, std::vector<Point> points) {
+void DbPointRecord::addPoints(const string& id, const std::vector<Point>& points) {
   std::lock_guard<std::mutex> lock(_db_pr_mtx);
   if (!this->readonly() && checkConnected()) {
-    DB_PR_SUPER::addPoints(id, points);
+    DB_PR_SUPER::addPoints(this->handleForIdentifier(id), points);
+    RtxTrace::Span span("adapter");
+    if (span.active()) {
+      span.setName(RtxTrace::typeName(typeid(*_adapter)) + "::insertRange");
+      span.setSeries(id);
+      span.arg("points", points.size());
+    }
     _adapter->insertRange(id, points);
   }
 }
@@ -533,6 +633,7 @@ void DbPointRecord::truncate() {
   if (!this->readonly() && checkConnected()) {
     DB_PR_SUPER::reset();
     _adapter->removeAllRecords();
+    this->_catalogChanged();
   }
 }
 
@@ -551,7 +652,7 @@ void DbPointRecord::reset(const string& id) {
   if (!this->readonly() && checkConnected()) {
     // deprecate?
     //cout << "Whoops - don't use this" << endl;
-    DB_PR_SUPER::reset(id);
+    DB_PR_SUPER::reset(this->handleForIdentifier(id));
     _last_request.clear();
     //this->removeRecord(id);
     // wiped out the record completely, so re-initialize it.
@@ -559,9 +660,38 @@ void DbPointRecord::reset(const string& id) {
   }
 }
 
+Point DbPointRecord::point(SeriesHandle series, time_t time) {
+  return this->point(this->identifierForHandle(series), time);
+}
+
+Point DbPointRecord::pointBefore(SeriesHandle series, time_t time, WhereClause q) {
+  return this->pointBefore(this->identifierForHandle(series), time, q);
+}
+
+Point DbPointRecord::pointAfter(SeriesHandle series, time_t time, WhereClause q) {
+  return this->pointAfter(this->identifierForHandle(series), time, q);
+}
+
+std::vector<Point> DbPointRecord::pointsInRange(SeriesHandle series, TimeRange range) {
+  return this->pointsInRange(this->identifierForHandle(series), range);
+}
+
+void DbPointRecord::addPoint(SeriesHandle series, Point point) {
+  this->addPoint(this->identifierForHandle(series), point);
+}
+
+void DbPointRecord::addPoints(SeriesHandle series, const std::vector<Point>& points) {
+  this->addPoints(this->identifierForHandle(series), points);
+}
+
+void DbPointRecord::reset(SeriesHandle series) {
+  this->reset(this->identifierForHandle(series));
+}
+
 void DbPointRecord::invalidate(const string &identifier) {
   if (!this->readonly() && checkConnected()) {
     _adapter->removeRecord(identifier);
+    this->_catalogChanged();
     this->reset(identifier);
   }
 }
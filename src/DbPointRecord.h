@@ -41,6 +41,7 @@ namespace RTX {
     // superclass overrides
     //// registration
     bool registerAndGetIdentifierForSeriesWithUnits(std::string name, Units units);    
+    std::vector<bool> registerAndGetIdentifiersForSeriesWithUnits(const std::vector< std::pair<std::string, Units> >& idUnits);
     IdentifierUnitsList identifiersAndUnits();
 
     //// lookup
@@ -50,10 +51,18 @@ namespace RTX {
     std::vector<Point> pointsInRange(const string& id, TimeRange range);
     //// insert
     void addPoint(const string& id, Point point);
-    void addPoints(const string& id, std::vector<Point> points);
+    void addPoints(const string& id, const std::vector<Point>& points);
     //// drop
     void reset();
     void reset(const string& id);
+    //// by handle: same as above
+    Point point(SeriesHandle series, time_t time);
+    Point pointBefore(SeriesHandle series, time_t time, WhereClause q = WhereClause());
+    Point pointAfter(SeriesHandle series, time_t time, WhereClause q = WhereClause());
+    std::vector<Point> pointsInRange(SeriesHandle series, TimeRange range);
+    void addPoint(SeriesHandle series, Point point);
+    void addPoints(SeriesHandle series, const std::vector<Point>& points);
+    void reset(SeriesHandle series);
     
     // db-only methods
     std::string errorMessage;
@@ -123,9 +132,9 @@ namespace RTX {
     class request_t {
     public:
       TimeRange range;
-      std::string id;
-      request_t(std::string id, TimeRange range);
-      bool contains(std::string id, time_t t);
+      SeriesHandle series;
+      request_t(SeriesHandle series, TimeRange range);
+      bool contains(SeriesHandle series, time_t t);
       void clear();
     };
     request_t _last_request;
@@ -135,6 +144,7 @@ namespace RTX {
     bool checkConnected();
     Point pointWithOpcFilter(Point p);
     std::vector<Point> pointsWithOpcFilter(std::vector<Point> points);
+    std::vector<Point> _selectRange(const std::string& id, TimeRange range); // adapter fetch + opc filter, traced
     
     bool _readOnly;
     std::set<unsigned int> _opcFilterCodes;
@@ -986,7 +986,7 @@ void EpanetModel::setQualityTimeStep(int seconds) {
 
 void EpanetModel::applyInitialQuality() {
   if (!_enOpened) {
-    DebugLog << "Could not apply initial quality conditions; engine not opened" << EOL;
+    RTX_LOG_WARN("epanet") << "could not apply initial quality conditions; engine not opened";
     return;
   }
   EN_API_CHECK(EN_closeQ(_enModel), "EN_closeQ");
@@ -1018,7 +1018,7 @@ void EpanetModel::applyInitialQuality() {
 
 void EpanetModel::applyInitialTankLevels() {
   if (!_enOpened) {
-    DebugLog << "Could not apply initial tank conditions; engine not opened" << EOL;
+    RTX_LOG_WARN("epanet") << "could not apply initial tank conditions; engine not opened";
     return;
   }
   
@@ -0,0 +1,566 @@
+//
+//  ExpressionTimeSeries.cpp
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#include "ExpressionTimeSeries.h"
+#include "SeriesKernels.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <future>
+
+using namespace RTX;
+using namespace std;
+
+
+// same dimension, conversion of one, no offset.
+static Units baseUnits(const Units& u) {
+  if (u.isInvalid()) {
+    return RTX_DIMENSIONLESS;
+  }
+  return u / Units(u.conversion());
+}
+
+
+#pragma mark - Parser
+
+// recursive descent over the expression text, emitting postfix instructions and
+// checking units as it goes.
+class ExpressionTimeSeries::Parser {
+public:
+  Parser(const string& text, const map<string,Units>& varUnits) : _text(text), _pos(0), _varUnits(varUnits) {};
+
+  bool parse() {
+    _units = this->expr();
+    this->skipSpace();
+    if (_error.empty() && _pos < _text.size()) {
+      this->fail("unexpected '" + _text.substr(_pos, 1) + "'");
+    }
+    return _error.empty();
+  };
+
+  vector<Instruction> program;
+  vector<string> slots;
+  Units units() { return _units; };
+  string error() { return _error; };
+
+private:
+  const string _text;
+  size_t _pos;
+  const map<string,Units>& _varUnits;
+  string _error;
+  Units _units;
+
+  void fail(const string& msg) {
+    if (_error.empty()) {
+      _error = msg + " at position " + to_string(_pos);
+    }
+  };
+  void skipSpace() {
+    while (_pos < _text.size() && isspace((unsigned char)_text[_pos])) {
+      ++_pos;
+    }
+  };
+  bool accept(char c) {
+    this->skipSpace();
+    if (_pos < _text.size() && _text[_pos] == c) {
+      ++_pos;
+      return true;
+    }
+    return false;
+  };
+  void emit(opCode_t op, double value = 0, size_t index = 0) {
+    Instruction i;
+    i.op = op;
+    i.value = value;
+    i.index = index;
+    program.push_back(i);
+  };
+
+  Units sameDimension(const Units& a, const Units& b, const string& what) {
+    if (!a.isSameDimensionAs(b)) {
+      this->fail("dimension mismatch in " + what);
+    }
+    return a;
+  };
+
+  // expr := term (('+'|'-') term)*
+  Units expr() {
+    Units u = this->term();
+    while (_error.empty()) {
+      if (this->accept('+')) {
+        u = this->sameDimension(u, this->term(), "addition");
+        this->emit(opAdd);
+      }
+      else if (this->accept('-')) {
+        u = this->sameDimension(u, this->term(), "subtraction");
+        this->emit(opSubtract);
+      }
+      else {
+        break;
+      }
+    }
+    return u;
+  };
+
+  // term := unary (('*'|'/') unary)*
+  Units term() {
+    Units u = this->unary();
+    while (_error.empty()) {
+      if (this->accept('*')) {
+        u = u * this->unary();
+        this->emit(opMultiply);
+      }
+      else if (this->accept('/')) {
+        u = u / this->unary();
+        this->emit(opDivide);
+      }
+      else {
+        break;
+      }
+    }
+    return u;
+  };
+
+  // unary := '-' unary | power
+  Units unary() {
+    if (this->accept('-')) {
+      Units u = this->unary();
+      this->emit(opNegate);
+      return u;
+    }
+    return this->power();
+  };
+
+  // power := primary ('^' signed-number)?
+  Units power() {
+    Units u = this->primary();
+    if (_error.empty() && this->accept('^')) {
+      double sign = this->accept('-') ? -1. : 1.;
+      double exponent;
+      if (!this->number(exponent)) {
+        this->fail("exponent must be a number");
+        return u;
+      }
+      exponent *= sign;
+      u = this->raised(u, exponent);
+      this->emit(opPower, exponent);
+    }
+    return u;
+  };
+
+  Units raised(const Units& u, double exponent) {
+    Units r = u ^ exponent;
+    if (!(r ^ (1. / exponent)).isSameDimensionAs(u)) {
+      this->fail("fractional dimension");
+    }
+    return r;
+  };
+
+  bool number(double& value) {
+    this->skipSpace();
+    const char *start = _text.c_str() + _pos;
+    char *end = NULL;
+    value = strtod(start, &end);
+    if (end == start) {
+      return false;
+    }
+    _pos += (end - start);
+    return true;
+  };
+
+  // primary := number | name | name '(' args ')' | '(' expr ')'
+  Units primary() {
+    this->skipSpace();
+    if (this->accept('(')) {
+      Units u = this->expr();
+      if (!this->accept(')')) {
+        this->fail("expected ')'");
+      }
+      return u;
+    }
+
+    double value;
+    if (_pos < _text.size() && (isdigit((unsigned char)_text[_pos]) || _text[_pos] == '.') && this->number(value)) {
+      this->emit(opConstant, value);
+      return RTX_DIMENSIONLESS;
+    }
+
+    size_t start = _pos;
+    while (_pos < _text.size() && (isalnum((unsigned char)_text[_pos]) || _text[_pos] == '_')) {
+      ++_pos;
+    }
+    if (start == _pos) {
+      this->fail(_pos < _text.size() ? "unexpected '" + _text.substr(_pos, 1) + "'" : "unexpected end of expression");
+      return RTX_DIMENSIONLESS;
+    }
+    string name = _text.substr(start, _pos - start);
+
+    if (this->accept('(')) {
+      return this->function(name);
+    }
+
+    auto found = _varUnits.find(name);
+    if (found == _varUnits.end()) {
+      this->fail("unbound variable '" + name + "'");
+      return RTX_DIMENSIONLESS;
+    }
+    size_t slot = 0;
+    while (slot < slots.size() && slots[slot] != name) {
+      ++slot;
+    }
+    if (slot == slots.size()) {
+      slots.push_back(name);
+    }
+    this->emit(opVariable, 0, slot);
+    return found->second;
+  };
+
+  Units function(const string& name) {
+    Units u = this->expr();
+
+    if (name == "min" || name == "max") {
+      if (!this->accept(',')) {
+        this->fail("expected ','");
+      }
+      u = this->sameDimension(u, this->expr(), name);
+      this->emit(name == "min" ? opMin : opMax);
+    }
+    else if (name == "abs") {
+      this->emit(opAbs);
+    }
+    else if (name == "sqrt") {
+      u = this->raised(u, 0.5);
+      this->emit(opSqrt);
+    }
+    else if (name == "exp" || name == "log" || name == "log10") {
+      if (!u.isSameDimensionAs(RTX_DIMENSIONLESS)) {
+        this->fail(name + " of a dimensional quantity");
+      }
+      this->emit(name == "exp" ? opExp : (name == "log" ? opLog : opLog10));
+      u = RTX_DIMENSIONLESS;
+    }
+    else {
+      this->fail("unknown function '" + name + "'");
+    }
+
+    if (!this->accept(')')) {
+      this->fail("expected ')'");
+    }
+    return u;
+  };
+};
+
+
+#pragma mark - Constructor / properties
+
+ExpressionTimeSeries::ExpressionTimeSeries() {
+  _stackDepth = 0;
+  _compiled = false;
+  _expressionUnits = RTX_DIMENSIONLESS;
+}
+
+std::ostream& ExpressionTimeSeries::toStream(std::ostream &stream) {
+  TimeSeries::toStream(stream);
+  stream << "Expression: " << _expression << "\n";
+  for (auto& v : _variables) {
+    stream << "  " << v.first << " = " << v.second->name() << "\n";
+  }
+  return stream;
+}
+
+string ExpressionTimeSeries::expression() {
+  return _expression;
+}
+
+void ExpressionTimeSeries::setExpression(const string& expression) {
+  _expression = expression;
+  this->compile();
+  this->invalidate();
+}
+
+void ExpressionTimeSeries::setVariable(const string& name, TimeSeries::_sp ts) {
+  this->removeVariable(name);
+  if (!ts) {
+    return;
+  }
+  _variables[name] = ts;
+  ts->filterDidAddSource(share_me(this));
+  this->compile();
+  this->invalidate();
+}
+
+void ExpressionTimeSeries::removeVariable(const string& name) {
+  auto found = _variables.find(name);
+  if (found == _variables.end()) {
+    return;
+  }
+  TimeSeries::_sp ts = found->second;
+  _variables.erase(found);
+  ts->filterDidRemoveSource(share_me(this));
+  this->compile();
+  this->invalidate();
+}
+
+map<string, TimeSeries::_sp> ExpressionTimeSeries::variables() {
+  return _variables;
+}
+
+bool ExpressionTimeSeries::isCompiled() {
+  return _compiled;
+}
+
+string ExpressionTimeSeries::compileError() {
+  return _compileError;
+}
+
+Units ExpressionTimeSeries::expressionUnits() {
+  return _expressionUnits;
+}
+
+
+#pragma mark - Compilation
+
+void ExpressionTimeSeries::compile() {
+  _compiled = false;
+  _program.clear();
+  _slots.clear();
+  _stackDepth = 0;
+
+  if (_expression.empty()) {
+    _compileError = "no expression";
+    return;
+  }
+
+  map<string,Units> varUnits;
+  for (auto& v : _variables) {
+    varUnits[v.first] = baseUnits(v.second->units());
+  }
+
+  Parser parser(_expression, varUnits);
+  if (!parser.parse()) {
+    _compileError = parser.error();
+    return;
+  }
+
+  // depth of the evaluation stack, so the per-row evaluation never has to grow it.
+  size_t depth = 0;
+  for (const Instruction& i : parser.program) {
+    switch (i.op) {
+      case opConstant:
+      case opVariable:
+        ++depth;
+        break;
+      case opAdd:
+      case opSubtract:
+      case opMultiply:
+      case opDivide:
+      case opMin:
+      case opMax:
+        --depth;
+        break;
+      default:
+        break;
+    }
+    _stackDepth = RTX_MAX(_stackDepth, depth);
+  }
+
+  _program = parser.program;
+  _slots = parser.slots;
+  _expressionUnits = parser.units();
+  _compileError = "";
+  _compiled = true;
+
+  if (!this->units().isSameDimensionAs(_expressionUnits)) {
+    Units u = _expressionUnits;
+    TimeSeries::setUnits(u);
+  }
+}
+
+
+#pragma mark - Sources
+
+TimeSeries::_sp ExpressionTimeSeries::source() {
+  if (_variables.size() > 0) {
+    return _variables.begin()->second;
+  }
+  return TimeSeries::_sp();
+}
+
+void ExpressionTimeSeries::setSource(TimeSeries::_sp ts) {
+  // nope -- use setVariable
+}
+
+bool ExpressionTimeSeries::canSetSource(TimeSeries::_sp ts) {
+  return false;
+}
+
+bool ExpressionTimeSeries::canChangeToUnits(Units units) {
+  return !_compiled || units.isSameDimensionAs(_expressionUnits);
+}
+
+bool ExpressionTimeSeries::hasUpstreamSeries(TimeSeries::_sp other) {
+  for (auto& v : _variables) {
+    if (v.second == other || v.second->hasUpstreamSeries(other)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+vector<TimeSeries::_sp> ExpressionTimeSeries::inputs() {
+  vector<TimeSeries::_sp> in;
+  for (auto& v : _variables) {
+    in.push_back(v.second);
+  }
+  return in;
+}
+
+TimeSeriesFilter::Reach ExpressionTimeSeries::reach() {
+  // every variable is resampled onto the frame times
+  Reach r;
+  r.resampleNeighbors = true;
+  return r;
+}
+
+
+#pragma mark - Time values
+
+time_t ExpressionTimeSeries::timeBefore(time_t time) {
+  if (this->clock()) {
+    return this->clock()->timeBefore(time);
+  }
+  time_t before = 0;
+  for (auto& v : _variables) {
+    before = RTX_MAX(before, v.second->timeBefore(time));
+  }
+  return before;
+}
+
+time_t ExpressionTimeSeries::timeAfter(time_t time) {
+  if (this->clock()) {
+    return this->clock()->timeAfter(time);
+  }
+  time_t after = 0;
+  for (auto& v : _variables) {
+    time_t t = v.second->timeAfter(time);
+    if (t != 0 && (after == 0 || t < after)) {
+      after = t;
+    }
+  }
+  return after;
+}
+
+set<time_t> ExpressionTimeSeries::timeValuesInRange(TimeRange range) {
+  if (this->clock()) {
+    return this->clock()->timeValuesInRange(range);
+  }
+  set<time_t> times;
+  for (auto& v : _variables) {
+    set<time_t> varTimes = v.second->timeValuesInRange(range);
+    times.insert(varTimes.begin(), varTimes.end());
+  }
+  return times;
+}
+
+
+#pragma mark - Evaluation
+
+PointCollection ExpressionTimeSeries::filterPointsInRange(TimeRange range) {
+  PointCollection out(vector<Point>(), this->units());
+  if (!_compiled) {
+    return out;
+  }
+
+  set<time_t> frameTimes = this->timeValuesInRange(range);
+  if (frameTimes.empty()) {
+    return out;
+  }
+  vector<time_t> frame(frameTimes.begin(), frameTimes.end());
+  const size_t nRows = frame.size();
+  const size_t nSlots = _slots.size();
+
+  // build the aligned frame: one column per variable, in base units. fetch variables concurrently.
+  vector< future< vector<double> > > tasks;
+  for (const string& name : _slots) {
+    TimeSeries::_sp ts = _variables[name];
+    TimeRange q = this->inputRange(ts, range);
+    tasks.push_back(async(launch::async, [=,&frameTimes,&frame]() -> vector<double> {
+      vector<double> column(nRows, NAN);
+      PointCollection c = ts->pointCollection(q);
+      c.resample(frameTimes);
+      UnitFactor toBase(c.units, baseUnits(c.units));
+      auto raw = c.raw();
+      size_t iRow = 0;
+      for (auto it = raw.first; it != raw.second; ++it) {
+        while (iRow < nRows && frame[iRow] < it->time) {
+          ++iRow;
+        }
+        if (iRow == nRows) {
+          break;
+        }
+        if (frame[iRow] == it->time && it->isValid) {
+          column[iRow] = it->value * toBase.scale + toBase.offset;
+        }
+      }
+      return column;
+    }));
+  }
+  vector< vector<double> > columns;
+  for (auto& task : tasks) {
+    columns.push_back(task.get());
+  }
+
+  // fused evaluation, one row at a time, on a fixed-size stack.
+  UnitFactor toOutput(_expressionUnits, this->units());
+  vector<double> stack(RTX_MAX(_stackDepth, (size_t)1));
+  vector<Point> outPoints;
+  outPoints.reserve(nRows);
+
+  for (size_t iRow = 0; iRow < nRows; ++iRow) {
+    bool complete = true;
+    for (size_t s = 0; s < nSlots; ++s) {
+      if (std::isnan(columns[s][iRow])) {
+        complete = false;
+        break;
+      }
+    }
+    if (!complete) {
+      continue; // a variable has no value here
+    }
+
+    double *top = stack.data() - 1;
+    for (const Instruction& i : _program) {
+      switch (i.op) {
+        case opConstant: *(++top) = i.value; break;
+        case opVariable: *(++top) = columns[i.index][iRow]; break;
+        case opAdd:      --top; *top = *top + *(top+1); break;
+        case opSubtract: --top; *top = *top - *(top+1); break;
+        case opMultiply: --top; *top = *top * *(top+1); break;
+        case opDivide:   --top; *top = *top / *(top+1); break;
+        case opMin:      --top; *top = fmin(*top, *(top+1)); break;
+        case opMax:      --top; *top = fmax(*top, *(top+1)); break;
+        case opNegate:   *top = -(*top); break;
+        case opPower:    *top = pow(*top, i.value); break;
+        case opAbs:      *top = fabs(*top); break;
+        case opSqrt:     *top = sqrt(*top); break;
+        case opExp:      *top = exp(*top); break;
+        case opLog:      *top = log(*top); break;
+        case opLog10:    *top = log10(*top); break;
+      }
+    }
+
+    double value = *top * toOutput.scale + toOutput.offset;
+    if (std::isfinite(value)) {
+      outPoints.push_back(Point(frame[iRow], value));
+    }
+  }
+
+  out.setPoints(std::move(outPoints));
+  return out;
+}
@@ -0,0 +1,107 @@
+//
+//  ExpressionTimeSeries.h
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#ifndef __epanet_rtx__ExpressionTimeSeries__
+#define __epanet_rtx__ExpressionTimeSeries__
+
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "TimeSeriesFilter.h"
+
+namespace RTX {
+
+  /*!
+   \class ExpressionTimeSeries
+   \brief Evaluates an arithmetic expression over named input series.
+
+   Replaces chains of single-purpose filters (Multiplier, Gain, Offset, Inversion, MathOps...) with one series. For example, with variables "q" and "h" bound to a flow and a head series:
+
+     expr->setExpression("0.5 * (q * h) / 3.6 + abs(h - 10)");
+
+   Supported syntax: numbers, variable names, + - * / and unary minus, ^ with a constant exponent, parentheses, and the functions abs, sqrt, exp, log, log10, min and max.
+
+   The expression is compiled once (whenever it or a variable changes) into a postfix program, and its units are derived from the variable units; adding or comparing quantities of different dimension is a compile error, as is taking exp/log of a dimensional quantity. Evaluation aligns all variables on a common set of times (clock ticks, or the union of variable times) in one frame, and runs the program in a single pass over that frame. Times at which any variable has no value are dropped.
+   */
+
+  /*!
+   \fn bool ExpressionTimeSeries::isCompiled()
+   \brief Whether the expression parsed, all its variables are bound, and its units are consistent.
+   \sa ExpressionTimeSeries::compileError
+   */
+
+  class ExpressionTimeSeries : public TimeSeriesFilter {
+  public:
+    RTX_BASE_PROPS(ExpressionTimeSeries);
+    ExpressionTimeSeries();
+    virtual std::ostream& toStream(std::ostream &stream);
+
+    std::string expression();
+    void setExpression(const std::string& expression);
+
+    void setVariable(const std::string& name, TimeSeries::_sp ts);
+    void removeVariable(const std::string& name);
+    std::map<std::string, TimeSeries::_sp> variables();
+
+    bool isCompiled();
+    std::string compileError();
+    Units expressionUnits(); /// dimension of the result, in base units
+
+    TimeSeries::_sp source();
+    void setSource(TimeSeries::_sp ts);
+    virtual bool hasUpstreamSeries(TimeSeries::_sp other);
+    virtual std::vector<TimeSeries::_sp> inputs();
+    virtual Reach reach();
+    virtual time_t timeBefore(time_t time);
+    virtual time_t timeAfter(time_t time);
+
+    // chainable
+    ExpressionTimeSeries::_sp expression(const std::string& e) {this->setExpression(e); return share_me(this);};
+    ExpressionTimeSeries::_sp variable(const std::string& name, TimeSeries::_sp ts) {this->setVariable(name, ts); return share_me(this);};
+
+  protected:
+    PointCollection filterPointsInRange(TimeRange range);
+    std::set<time_t> timeValuesInRange(TimeRange range);
+    bool canSetSource(TimeSeries::_sp ts);
+    bool canChangeToUnits(Units units);
+
+  private:
+    typedef enum {
+      opConstant, opVariable,
+      opAdd, opSubtract, opMultiply, opDivide, opNegate, opPower,
+      opAbs, opSqrt, opExp, opLog, opLog10, opMin, opMax
+    } opCode_t;
+
+    class Instruction {
+    public:
+      opCode_t op;
+      double value;   // constant, or exponent for opPower
+      size_t index;   // variable slot
+    };
+
+    class Parser;
+
+    void compile();
+
+    std::string _expression;
+    std::map<std::string, TimeSeries::_sp> _variables;
+
+    // compiled state
+    std::vector<Instruction> _program;
+    std::vector<std::string> _slots; // variable name for each slot
+    size_t _stackDepth;
+    bool _compiled;
+    std::string _compileError;
+    Units _expressionUnits;
+  };
+
+}
+
+#endif /* defined(__epanet_rtx__ExpressionTimeSeries__) */
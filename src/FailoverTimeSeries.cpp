@@ -162,7 +162,7 @@ PointCollection FailoverTimeSeries::filterPointsInRange(TimeRange range) {
     
   }
   
-  PointCollection outData(merged, this->units());
+  PointCollection outData(std::move(merged), this->units());
   
   if (this->willResample()) {
     outData.resample(this->timeValuesInRange(range));
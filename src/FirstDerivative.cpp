@@ -7,6 +7,7 @@
 //  
 
 #include "FirstDerivative.h"
+#include "SeriesKernels.h"
 
 using namespace std;
 using namespace RTX;
@@ -26,17 +27,8 @@ PointCollection FirstDerivative::filterPointsInRange(TimeRange range) {
   vector<Point> outPoints;
   Units fromUnits = this->source()->units();
   
-  TimeRange qRange = range;
-  if (this->willResample()) {
-    // expand range
-    qRange.start = this->source()->timeBefore(range.start + 1);
-    qRange.end = this->source()->timeAfter(range.end - 1);
-  }
-  
-  // one prior
-  qRange.start = this->source()->timeBefore(qRange.start);
-  
-  qRange.correctWithRange(range);
+  // resample neighbors and one prior
+  TimeRange qRange = this->inputRange(this->source(), range);
   PointCollection sourceData = this->source()->pointCollection(qRange);
   
   if (sourceData.count() < 2) {
@@ -44,22 +36,19 @@ PointCollection FirstDerivative::filterPointsInRange(TimeRange range) {
   }
   
   auto raw = sourceData.raw();
-  auto cursor = raw.first;
-  auto prev = raw.first;
-  auto vEnd = raw.second;
+  SeriesColumns cols(raw.first, raw.second);
+  UnitFactor factor(fromUnits / RTX_SECOND, this->units());
+  SeriesKernels::carry_t prior;
+  vector<double> dvdt(cols.size());
+  size_t nOut = SeriesKernels::difference(cols.time.data(), cols.value.data(), cols.size(), prior, factor, dvdt.data());
   
-  ++cursor;
-  while (cursor != vEnd) {
-    time_t dt = cursor->time - prev->time;
-    double dv = cursor->value - prev->value;
-    double dvdt = Units::convertValue(dv / double(dt), fromUnits / RTX_SECOND, this->units());
-    outPoints.push_back(Point(cursor->time, dvdt));
-    ++cursor;
-    ++prev;
+  // the first source point only primes the difference.
+  outPoints.reserve(nOut);
+  for (size_t i = 0; i < nOut; ++i) {
+    outPoints.push_back(Point(cols.time[i + 1], dvdt[i]));
   }
   
-  
-  data.setPoints(outPoints);
+  data.setPoints(std::move(outPoints));
   
   if (this->willResample()) {
     set<time_t> timeValues = this->timeValuesInRange(range);
@@ -105,3 +94,9 @@ std::ostream& FirstDerivative::toStream(std::ostream &stream) {
   
   return stream;
 }
+
+TimeSeriesFilter::Reach FirstDerivative::reach() {
+  Reach r = TimeSeriesFilter::reach();
+  r.pointsBehind = 1;
+  return r;
+}
@@ -19,6 +19,7 @@ namespace RTX {
     FirstDerivative();
     virtual ~FirstDerivative();
     virtual std::ostream& toStream(std::ostream &stream);
+    Reach reach();
     
   protected:
     PointCollection filterPointsInRange(TimeRange range);
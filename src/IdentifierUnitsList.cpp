@@ -1,43 +1,158 @@
 #include "IdentifierUnitsList.h"
 
+#include <atomic>
+#include <cmath>
 
 using namespace std;
 using namespace RTX;
 
+static shared_ptr<const IdentifierUnitsList::map_t> _emptyMap() {
+  static shared_ptr<const IdentifierUnitsList::map_t> empty(new IdentifierUnitsList::map_t);
+  return empty;
+}
 
 IdentifierUnitsList::IdentifierUnitsList() {
-  _d.reset(new map<string,pair<Units,string> >);
+  this->clear();
+}
+
+IdentifierUnitsList::IdentifierUnitsList(const IdentifierUnitsList& other) {
+  _snap = other._load();
+}
+
+IdentifierUnitsList& IdentifierUnitsList::operator=(const IdentifierUnitsList& other) {
+  if (this != &other) {
+    atomic_store(&_snap, other._load());
+  }
+  return *this;
+}
+
+shared_ptr<const IdentifierUnitsList::Snapshot> IdentifierUnitsList::_load() const {
+  return atomic_load(&_snap);
+}
+
+bool IdentifierUnitsList::_swap(shared_ptr<const Snapshot>& expected, shared_ptr<const Snapshot> next) const {
+  return atomic_compare_exchange_weak(&_snap, &expected, next);
 }
-bool IdentifierUnitsList::hasIdentifierAndUnits(const std::string &identifier, const RTX::Units &units) {
+
+const pair<Units,string>* IdentifierUnitsList::_find(const Snapshot& s, const string& identifier) {
+  auto found = s.recent->find(identifier);
+  if (found != s.recent->end()) {
+    return &found->second;
+  }
+  found = s.base->find(identifier);
+  if (found != s.base->end()) {
+    return &found->second;
+  }
+  return NULL;
+}
+
+bool IdentifierUnitsList::hasIdentifierAndUnits(const std::string &identifier, const RTX::Units &units) const {
   auto pr = this->doesHaveIdUnits(identifier, units);
   return pr.first && pr.second;
 }
-pair<bool,bool> IdentifierUnitsList::doesHaveIdUnits(const string& identifier, const Units& units) {
+
+pair<bool,bool> IdentifierUnitsList::doesHaveIdUnits(const string& identifier, const Units& units) const {
   bool nameExists = false, unitsMatch = false;
-  map<string,pair<Units,string> >::const_iterator found = _d->find(identifier);
-  if (found != _d->end()) {
+  auto snap = this->_load();
+  const pair<Units,string>* found = _find(*snap, identifier);
+  if (found) {
     nameExists = true;
-    const Units existingUnits = found->second.first;
-    if (existingUnits == units) {
+    if (found->first == units) {
       unitsMatch = true;
     }
   }
   return make_pair(nameExists,unitsMatch);
 }
 
-
-map<string, pair<Units,string> >* IdentifierUnitsList::get() {
-  return _d.get();
+shared_ptr<const IdentifierUnitsList::map_t> IdentifierUnitsList::get() const {
+  auto snap = this->_load();
+  if (snap->recent->empty()) {
+    return snap->base;
+  }
+  // fold the recent entries in. the next reader would do the same, so publish the result.
+  shared_ptr<map_t> merged(new map_t(*snap->base));
+  for (auto& entry : *snap->recent) {
+    (*merged)[entry.first] = entry.second;
+  }
+  shared_ptr<Snapshot> folded(new Snapshot);
+  folded->base = merged;
+  folded->recent = _emptyMap();
+  this->_swap(snap, folded);
+  return merged;
 }
+
 void IdentifierUnitsList::set(const std::string &identifier, const RTX::Units &units) {
-  (*_d.get())[identifier] = {units, units.to_string()};
+  auto snap = this->_load();
+  while (true) {
+    const pair<Units,string>* existing = _find(*snap, identifier);
+    if (existing && existing->first == units) {
+      return; // nothing to change
+    }
+    shared_ptr<Snapshot> next(new Snapshot);
+    size_t foldAt = (size_t)sqrt((double)snap->base->size()) + 16;
+    if (snap->recent->size() >= foldAt) {
+      shared_ptr<map_t> merged(new map_t(*snap->base));
+      for (auto& entry : *snap->recent) {
+        (*merged)[entry.first] = entry.second;
+      }
+      (*merged)[identifier] = {units, units.to_string()};
+      next->base = merged;
+      next->recent = _emptyMap();
+    }
+    else {
+      shared_ptr<map_t> recent(new map_t(*snap->recent));
+      (*recent)[identifier] = {units, units.to_string()};
+      next->base = snap->base;
+      next->recent = recent;
+    }
+    if (this->_swap(snap, next)) {
+      return;
+    }
+  }
+}
+
+void IdentifierUnitsList::set(const std::vector<std::pair<std::string, Units> > &idUnits) {
+  if (idUnits.empty()) {
+    return;
+  }
+  auto snap = this->_load();
+  while (true) {
+    shared_ptr<map_t> merged(new map_t(*snap->base));
+    merged->reserve(snap->base->size() + snap->recent->size() + idUnits.size());
+    for (auto& entry : *snap->recent) {
+      (*merged)[entry.first] = entry.second;
+    }
+    for (auto& idu : idUnits) {
+      (*merged)[idu.first] = {idu.second, idu.second.to_string()};
+    }
+    shared_ptr<Snapshot> next(new Snapshot);
+    next->base = merged;
+    next->recent = _emptyMap();
+    if (this->_swap(snap, next)) {
+      return;
+    }
+  }
 }
+
 void IdentifierUnitsList::clear() {
-  _d.reset(new map<string,pair<Units,string> >);
+  shared_ptr<Snapshot> empty(new Snapshot);
+  empty->base = _emptyMap();
+  empty->recent = _emptyMap();
+  atomic_store(&_snap, shared_ptr<const Snapshot>(empty));
 }
-size_t IdentifierUnitsList::count() {
-  return _d->size();
+
+size_t IdentifierUnitsList::count() const {
+  auto snap = this->_load();
+  size_t n = snap->base->size();
+  for (auto& entry : *snap->recent) {
+    if (snap->base->count(entry.first) == 0) {
+      ++n;
+    }
+  }
+  return n;
 }
-bool IdentifierUnitsList::empty() {
-  return _d->empty();
+
+bool IdentifierUnitsList::empty() const {
+  auto snap = this->_load();
+  return snap->base->empty() && snap->recent->empty();
 }
@@ -4,22 +4,46 @@
 #include <stdio.h>
 
 #include <string>
-#include <map>
+#include <memory>
+#include <vector>
+#include <unordered_map>
 #include "Units.h"
 
 namespace RTX {
+  /*!
+   \class IdentifierUnitsList
+   \brief A catalog of series identifiers and their units.
+
+   Reads never block: the catalog is an immutable, hashed snapshot that is swapped atomically when it changes, so a copy of an IdentifierUnitsList (or a map returned by get()) is a consistent snapshot that later changes do not affect.
+
+   Single insertions go into a small side table that is folded into the main snapshot once it grows to about the square root of the catalog size, which keeps one-at-a-time registration cheap. Use the bulk form of set() to register many identifiers at once.
+   */
   class IdentifierUnitsList {
   public:
+    typedef std::unordered_map< std::string, std::pair<Units, std::string> > map_t; // ID => (units, units_str)
+
     IdentifierUnitsList();
-    bool hasIdentifierAndUnits(const std::string& identifier, const Units& units);
-    std::pair<bool,bool> doesHaveIdUnits(const std::string& identifier, const Units& units);
+    IdentifierUnitsList(const IdentifierUnitsList& other);
+    IdentifierUnitsList& operator=(const IdentifierUnitsList& other);
+
+    bool hasIdentifierAndUnits(const std::string& identifier, const Units& units) const;
+    std::pair<bool,bool> doesHaveIdUnits(const std::string& identifier, const Units& units) const;
     void set(const std::string& identifier, const Units& units);
-    std::map< std::string, std::pair<Units, std::string> > *get();
+    void set(const std::vector< std::pair<std::string, Units> >& idUnits); /// bulk insert, one snapshot swap
+    std::shared_ptr<const map_t> get() const; /// immutable snapshot of the whole catalog
     void clear();
-    size_t count();
-    bool empty();
-  private:        // ID => (units, units_str)
-    std::shared_ptr< std::map< std::string, std::pair<Units, std::string> > > _d;
+    size_t count() const;
+    bool empty() const;
+
+  private:
+    class Snapshot {
+    public:
+      std::shared_ptr<const map_t> base, recent; // recent entries take precedence over base
+    };
+    std::shared_ptr<const Snapshot> _load() const;
+    bool _swap(std::shared_ptr<const Snapshot>& expected, std::shared_ptr<const Snapshot> next) const;
+    static const std::pair<Units, std::string>* _find(const Snapshot& s, const std::string& identifier);
+    mutable std::shared_ptr<const Snapshot> _snap; // only ever accessed with the atomic shared_ptr functions
   };
 }
 
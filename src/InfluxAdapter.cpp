@@ -155,16 +155,13 @@ void InfluxAdapter::commitTransactionLines() {
 
 bool InfluxAdapter::insertIdentifierAndUnits(const std::string &id, RTX::Units units) {
   
-  MetricInfo m(id);
-  m.tags.erase("units"); // get rid of units if they are included.
-  string properId = m.name();
+  string properId = MetricInfo::properIdWithoutUnits(id); // get rid of units if they are included.
   
   _idCache.set(properId, units);
   
   // insert a field key/value for something that we won't ever query again.
   // pay attention to bulk operations here, since we may be inserting new ids en-masse
-  string tsNameEscaped = influxIdForTsId(id);
-  boost::replace_all(tsNameEscaped, " ", "\\ ");
+  string tsNameEscaped = MetricInfo::lineProtocolKey(properId, units.to_string(), true);
   const string content(tsNameEscaped + " exist=true");
   if (_inTransaction) {
     _RTX_DB_SCOPED_LOCK;
@@ -182,20 +179,18 @@ void InfluxAdapter::insertSingle(const std::string& id, Point point) {
   this->insertRange(id, {point});
 }
 
-void InfluxAdapter::insertRange(const std::string& id, std::vector<Point> points) {
+void InfluxAdapter::insertRange(const std::string& id, const std::vector<Point>& points) {
   if (points.size() == 0) {
     return;
   }
-  string dbId = influxIdForTsId(id);
+  string dbId = influxIdForTsId(id, true);
   auto content = this->insertionLinesFromPoints(dbId, points);
   
   if (_inTransaction) {
     size_t nLines = 0;
     { // mutex
       _RTX_DB_SCOPED_LOCK;
-      for (auto s : content) {
-        _transactionLines.push_back(s);
-      }
+      _transactionLines.insert(_transactionLines.end(), make_move_iterator(content.begin()), make_move_iterator(content.end()));
       nLines = _transactionLines.size();
     } // end mutex
     if (nLines > maxTransactionLines()) {
@@ -203,7 +198,7 @@ void InfluxAdapter::insertRange(const std::string& id, std::vector<Point> points
     }
   }
   else {
-    _transactionLines = content;
+    _transactionLines = std::move(content);
     this->commitTransactionLines();
   }
   
@@ -238,24 +233,21 @@ void InfluxAdapter::sendInfluxString(time_t time, const string& seriesId, const
   }
 }
 
-string InfluxAdapter::influxIdForTsId(const string& id) {
+string InfluxAdapter::influxIdForTsId(const string& id, bool escaped) {
   // sort named keys into proper order...
-  MetricInfo m(id);
-  if (m.tags.count("units")) {
-    m.tags.erase("units");
-  }
-  string tsId = m.name();
-  if (_idCache.get()->count(tsId) == 0) {
+  string tsId = MetricInfo::properIdWithoutUnits(id);
+  auto ids = _idCache.get();
+  auto found = ids->find(tsId);
+  if (found == ids->end()) {
     cerr << "no registered ts with that id: " << tsId << endl;
     // yet i'm being asked for it??
     return "";
   }
-  m.tags["units"] = (*_idCache.get())[tsId].second;
-  return m.name();
+  return MetricInfo::lineProtocolKey(tsId, found->second.second, escaped);
 }
 
 
-vector<string> InfluxAdapter::insertionLinesFromPoints(const string& tsName, vector<Point> points) {
+vector<string> InfluxAdapter::insertionLinesFromPoints(const string& tsNameEscaped, const vector<Point>& points) {
   /*
    As you can see in the example below, you can post multiple points to multiple series at the same time by separating each point with a new line. Batching points in this manner will result in much higher performance.
    
@@ -265,10 +257,8 @@ vector<string> InfluxAdapter::insertionLinesFromPoints(const string& tsName, vec
    cpu_load_short,direction=in,host=server01,region=us-west value=23422.0 1422568543702900257'
    */
   
-  // escape any spaces in the tsName
-  string tsNameEscaped = tsName;
-  boost::replace_all(tsNameEscaped, " ", "\\ ");
   vector<string> outData;
+  outData.reserve(points.size());
   
   for(const Point& p: points) {
     stringstream ss;
@@ -706,7 +696,7 @@ void InfluxTcpAdapter::sendPointsWithString(const std::string& content) {
           // fine.
           break;
         default:
-          DebugLog << "send points to influx: POST returned " << r.status_code() << " - " << r.reason_phrase() << EOL;
+          RTX_LOG_WARN("influx") << "send points: POST returned " << (int)r.status_code() << " - " << r.reason_phrase();
           break;
       }
     } catch (std::exception &e) {
@@ -903,7 +893,7 @@ map<string, vector<Point> > __pointsFromJson(jsValue& json) {
 
 
 InfluxTcpAdapter::Query InfluxTcpAdapter::queryPartsFromMetricId(const std::string &name) {
-  MetricInfo m(name);
+  const MetricInfo& m = *MetricInfo::cached(name);
   
   Query q;
   q.select = {"time", "value", "quality", "confidence"};
@@ -971,7 +961,7 @@ void InfluxUdpAdapter::doConnect() {
     socket.open(udp::v4());
     socket.close();
   } catch (const std::exception &err) {
-    DebugLog << "could not connect to UDP endpoint" << EOL << flush;
+    RTX_LOG_WARN("influx") << "could not connect to UDP endpoint" << RtxLog::field("error", err.what());
     _errCallback("Invalid UDP Endpoint");
     return;
   }
@@ -1026,7 +1016,7 @@ void InfluxUdpAdapter::sendPointsWithString(const std::string& content) {
     boost::system::error_code err;
     socket.send_to(boost::asio::buffer(body, body.size()), receiver_endpoint, 0, err);
     if (err) {
-      DebugLog << "UDP SEND ERROR: " << err.message() << EOL << flush;
+      RTX_LOG_WARN("influx") << "UDP send error: " << err.message();
     }
     socket.close();
     if (conn.msec_ratelimit > 0) {
@@ -26,7 +26,7 @@ namespace RTX {
     // CREATE
     bool insertIdentifierAndUnits(const std::string& id, Units units);
     void insertSingle(const std::string& id, Point point);
-    void insertRange(const std::string& id, std::vector<Point> points);
+    void insertRange(const std::string& id, const std::vector<Point>& points);
     
     // UPDATE
     bool assignUnitsToRecord(const std::string& name, const Units& units);
@@ -52,8 +52,8 @@ namespace RTX {
     };
     connectionInfo conn;
     
-    std::vector<std::string> insertionLinesFromPoints(const std::string& tsName, std::vector<Point> points);
-    std::string influxIdForTsId(const std::string& id);
+    std::vector<std::string> insertionLinesFromPoints(const std::string& tsNameEscaped, const std::vector<Point>& points); /// series key must already be escaped
+    std::string influxIdForTsId(const std::string& id, bool escaped = false); /// line-protocol series key, with units. cached via MetricInfo
     
     std::vector<std::string> _transactionLines;
     IdentifierUnitsList _idCache;
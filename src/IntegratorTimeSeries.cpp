@@ -96,7 +96,7 @@ PointCollection IntegratorTimeSeries::filterPointsInRange(TimeRange range) {
     ++prev;
   }
   
-  data.setPoints(outPoints);
+  data.setPoints(std::move(outPoints));
   data.convertToUnits(this->units());
   
   if (this->willResample()) {
@@ -133,5 +133,14 @@ bool IntegratorTimeSeries::canChangeToUnits(RTX::Units units) {
   }
 }
 
-
-
+TimeRange IntegratorTimeSeries::inputRange(TimeSeries::_sp input, TimeRange range) {
+  // integration starts over at the previous reset, which is not a fixed reach.
+  TimeRange q = range;
+  if (this->resetClock()) {
+    time_t lastReset = this->resetClock()->timeBefore(range.start + 1);
+    if (lastReset != 0) {
+      q.start = lastReset;
+    }
+  }
+  return TimeSeriesFilter::inputRange(input, q);
+}
@@ -24,6 +24,8 @@ namespace RTX {
     
     IntegratorTimeSeries::_sp resetClock(Clock::_sp c) {this->setResetClock(c); return share_me(this);};
     
+    TimeRange inputRange(TimeSeries::_sp input, TimeRange range);
+    
   protected:
     PointCollection filterPointsInRange(TimeRange range);
     bool canSetSource(TimeSeries::_sp ts);
@@ -90,11 +90,11 @@ void Junction::setHeadMeasure(TimeSeries::_sp headMeas) {
   if (headMeas == NULL || !headMeas) {
     _headMeasure = TimeSeries::_sp();
     _pressureMeasure = TimeSeries::_sp();
-    DebugLog << "removing head measure: " << this->name() << EOL;
+    RTX_LOG_DEBUG("junction") << "removing head measure" << RtxLog::field("junction", this->name());
     return;
   }
   else if ( !(headMeas->units().isSameDimensionAs(RTX_METER)) ) {
-    DebugLog << "removing head measure: " << this->name() << EOL;
+    RTX_LOG_WARN("junction") << "head measure is not a length; removing it" << RtxLog::field("junction", this->name()) << RtxLog::field("units", headMeas->units().to_string());
     return;
   }
   
@@ -118,10 +118,10 @@ void Junction::setHeadMeasure(TimeSeries::_sp headMeas) {
   
   _pressureMeasure = gainTs;
   
-  DebugLog << "Setting head measure for: " << this->name() << " -> Units: " << this->head()->units().to_string() <<
-    " -> Elev: " << this->elevation() << EOL;
-  DebugLog << "Head series: " << headMeas->name() << " -> Units: " << headMeas->units().to_string() <<  EOL;
-  DebugLog << "Pres series: " << gainTs->name() << " -> Units: " << gainTs->units().to_string() <<  EOL;
+  RTX_LOG_DEBUG("junction") << "setting head measure"
+    << RtxLog::field("junction", this->name()) << RtxLog::field("units", this->head()->units().to_string()) << RtxLog::field("elevation", this->elevation())
+    << RtxLog::field("head", headMeas->name()) << RtxLog::field("head_units", headMeas->units().to_string())
+    << RtxLog::field("pressure", gainTs->name()) << RtxLog::field("pressure_units", gainTs->units().to_string());
 
   // deprecated because we don't trust hard-coded units conversions
   // outside of the Units class!
@@ -99,15 +99,7 @@ set<time_t> LagTimeSeries::timeValuesInRange(TimeRange range) {
 
 PointCollection LagTimeSeries::filterPointsInRange(TimeRange range) {
   
-  TimeRange laggedRange = range;
-  laggedRange.start -= _lag;
-  laggedRange.end -= _lag;
-  TimeRange queryRange = laggedRange;
-  
-  queryRange.start = this->source()->timeBefore(queryRange.start + 1);
-  queryRange.end = this->source()->timeAfter(queryRange.end - 1);
-  queryRange.correctWithRange(laggedRange);
-  
+  TimeRange queryRange = this->inputRange(this->source(), range);
   PointCollection data = this->source()->pointCollection(queryRange);
   
   // move the points in time
@@ -130,4 +122,9 @@ PointCollection LagTimeSeries::filterPointsInRange(TimeRange range) {
   
 }
 
-
+TimeSeriesFilter::Reach LagTimeSeries::reach() {
+  Reach r;
+  r.offset = _lag;
+  r.resampleNeighbors = true;
+  return r;
+}
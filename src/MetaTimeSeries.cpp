@@ -1,4 +1,5 @@
 #include "MetaTimeSeries.h"
+#include "SeriesKernels.h"
 #include <boost/foreach.hpp>
 
 using namespace std;
@@ -18,17 +19,8 @@ PointCollection MetaTimeSeries::filterPointsInRange(TimeRange range) {
     gaps.units = RTX_SECOND;
   }
   
-  TimeRange qRange = range;
-  if (this->willResample()) {
-    // expand range
-    qRange.start = this->source()->timeBefore(range.start + 1);
-    qRange.end = this->source()->timeAfter(range.end - 1);
-  }
-  
-  // one prior
-  qRange.start = this->source()->timeBefore(qRange.start);
-  
-  qRange.correctWithRange(range);
+  // resample neighbors and one prior
+  TimeRange qRange = this->inputRange(this->source(), range);
   PointCollection sourceData = this->source()->pointCollection(qRange);
   
   if (sourceData.count() < 2) {
@@ -36,6 +28,28 @@ PointCollection MetaTimeSeries::filterPointsInRange(TimeRange range) {
   }
   
   auto raw = sourceData.raw();
+  
+  if (_metaMode == MetaModeGap) {
+    // column kernel, with the conversion from seconds folded in.
+    SeriesColumns cols(raw.first, raw.second);
+    SeriesKernels::carry_t prior;
+    vector<double> dt(cols.size());
+    size_t nOut = SeriesKernels::gap(cols.time.data(), cols.size(), prior, UnitFactor(RTX_SECOND, this->units()), dt.data());
+    vector<Point> theGaps;
+    theGaps.reserve(nOut);
+    for (size_t i = 0; i < nOut; ++i) {
+      Point metaPoint(cols.time[i + 1], dt[i]);
+      metaPoint.addQualFlag(Point::rtx_integrated);
+      theGaps.push_back(metaPoint);
+    }
+    gaps.setPoints(std::move(theGaps));
+    gaps.units = this->units();
+    if (this->willResample()) {
+      gaps.resample(this->timeValuesInRange(range));
+    }
+    return gaps;
+  }
+  
   vector<Point>::const_iterator it = raw.first;
   vector<Point>::const_iterator prev = it;
   if (_metaMode == MetaModeGap) {
@@ -68,7 +82,7 @@ PointCollection MetaTimeSeries::filterPointsInRange(TimeRange range) {
     ++prev;
     ++it;
   }
-  gaps.setPoints(theGaps);
+  gaps.setPoints(std::move(theGaps));
   gaps.convertToUnits(this->units());
   
   if (this->willResample()) {
@@ -116,3 +130,9 @@ void MetaTimeSeries::setMetaMode(RTX::MetaTimeSeries::MetaMode mode) {
 MetaTimeSeries::MetaMode MetaTimeSeries::metaMode() {
   return _metaMode;
 }
+
+TimeSeriesFilter::Reach MetaTimeSeries::reach() {
+  Reach r = TimeSeriesFilter::reach();
+  r.pointsBehind = 1;
+  return r;
+}
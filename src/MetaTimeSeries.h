@@ -36,6 +36,8 @@ namespace RTX {
     
     MetaTimeSeries::_sp mode(MetaMode m) {this->setMetaMode(m); return share_me(this);};
     
+    Reach reach();
+    
   protected:
     PointCollection filterPointsInRange(TimeRange range);
     bool canSetSource(TimeSeries::_sp ts);
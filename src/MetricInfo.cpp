@@ -1,6 +1,9 @@
 #include "MetricInfo.h"
 
-#include <regex>
+#include <sstream>
+#include <mutex>
+#include <deque>
+#include <unordered_map>
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string/replace.hpp>
 
@@ -12,28 +15,135 @@ MetricInfo::MetricInfo(const string& name) {
   size_t firstComma = name.find(",");
   // measure name is everything up to the first comma, even if that's everything
   this->measurement = name.substr(0,firstComma);
-  if (firstComma != string::npos) {
-    // a comma was found. therefore treat the name as tokenized
-    string keysValuesStr = name.substr(firstComma+1);
-    regex kvReg("([^=]+)=([^,]+),?"); // key - value pair
-    auto kv_begin = sregex_iterator(keysValuesStr.begin(), keysValuesStr.end(), kvReg);
-    auto kv_end = sregex_iterator();
-    for (auto i = kv_begin; i != kv_end; ++i) {
-      this->tags[(*i)[1]] = (*i)[2];
+  if (firstComma == string::npos) {
+    return;
+  }
+  // a comma was found. therefore treat the name as tokenized: key=value[,key=value...]
+  size_t pos = firstComma + 1;
+  while (pos < name.length()) {
+    size_t comma = name.find(',', pos);
+    if (comma == string::npos) {
+      comma = name.length();
+    }
+    size_t equals = name.find('=', pos);
+    // a pair needs a non-empty key and value. anything else is skipped.
+    if (equals != string::npos && equals < comma && equals > pos && equals + 1 < comma) {
+      this->tags[name.substr(pos, equals - pos)] = name.substr(equals + 1, comma - equals - 1);
     }
+    pos = comma + 1;
   }
 }
 
-const string MetricInfo::name() {
-  stringstream ss;
-  ss << this->measurement;
-  for (auto p : this->tags) {
-    ss << "," << p.first << "=" << p.second;
+const string MetricInfo::name() const {
+  size_t len = this->measurement.length();
+  for (auto& p : this->tags) {
+    len += p.first.length() + p.second.length() + 2;
+  }
+  string name;
+  name.reserve(len);
+  name += this->measurement;
+  for (auto& p : this->tags) {
+    name += ',';
+    name += p.first;
+    name += '=';
+    name += p.second;
   }
-  const string name = ss.str();
   return name;
 }
 
+
+#pragma mark - cache
+
+namespace {
+  // string-keyed, thread-safe, evicts oldest-first when full.
+  template<class V>
+  class BoundedCache {
+  public:
+    BoundedCache() : _capacity(65536) {};
+    bool find(const string& key, V& value) {
+      lock_guard<mutex> lock(_mtx);
+      auto found = _map.find(key);
+      if (found == _map.end()) {
+        return false;
+      }
+      value = found->second;
+      return true;
+    }
+    void insert(const string& key, const V& value) {
+      lock_guard<mutex> lock(_mtx);
+      if (_map.count(key)) {
+        return;
+      }
+      while (_map.size() >= _capacity && !_order.empty()) {
+        _map.erase(_order.front());
+        _order.pop_front();
+      }
+      _map[key] = value;
+      _order.push_back(key);
+    }
+    void setCapacity(size_t capacity) {
+      lock_guard<mutex> lock(_mtx);
+      _capacity = (capacity > 0) ? capacity : 1;
+    }
+  private:
+    mutex _mtx;
+    unordered_map<string,V> _map;
+    deque<string> _order;
+    size_t _capacity;
+  };
+
+  BoundedCache< shared_ptr<const MetricInfo> > _parsedCache;
+  BoundedCache<string> _idCache, _idNoUnitsCache, _keyCache;
+}
+
+shared_ptr<const MetricInfo> MetricInfo::cached(const std::string &name) {
+  shared_ptr<const MetricInfo> m;
+  if (!_parsedCache.find(name, m)) {
+    m.reset(new MetricInfo(name));
+    _parsedCache.insert(name, m);
+  }
+  return m;
+}
+
 string MetricInfo::properId(const std::string &id) {
-  return MetricInfo(id).name();
+  string proper;
+  if (!_idCache.find(id, proper)) {
+    proper = MetricInfo::cached(id)->name();
+    _idCache.insert(id, proper);
+  }
+  return proper;
+}
+
+string MetricInfo::properIdWithoutUnits(const std::string &id) {
+  string proper;
+  if (!_idNoUnitsCache.find(id, proper)) {
+    MetricInfo m(*MetricInfo::cached(id));
+    m.tags.erase("units");
+    proper = m.name();
+    _idNoUnitsCache.insert(id, proper);
+  }
+  return proper;
+}
+
+string MetricInfo::lineProtocolKey(const std::string &properId, const std::string &units, bool escaped) {
+  // newline can't appear in an identifier, so it is a safe separator for the compound key.
+  string cacheKey = properId + '\n' + units + (escaped ? "\n1" : "\n0");
+  string key;
+  if (!_keyCache.find(cacheKey, key)) {
+    MetricInfo m(*MetricInfo::cached(properId));
+    m.tags["units"] = units;
+    key = m.name();
+    if (escaped) {
+      boost::replace_all(key, " ", "\\ ");
+    }
+    _keyCache.insert(cacheKey, key);
+  }
+  return key;
+}
+
+void MetricInfo::setCacheCapacity(size_t entries) {
+  _parsedCache.setCapacity(entries);
+  _idCache.setCapacity(entries);
+  _idNoUnitsCache.setCapacity(entries);
+  _keyCache.setCapacity(entries);
 }
@@ -4,15 +4,22 @@
 #include <stdio.h>
 #include <string>
 #include <map>
+#include <memory>
 
 namespace RTX {
   class MetricInfo {
   public:
     MetricInfo(const std::string& name); // ctor from string name
-    const std::string name();
+    const std::string name() const;
     static std::string properId(const std::string& id);
     std::map<std::string, std::string> tags;
     std::string measurement;
+
+    // cached lookups, shared by everyone. names are parsed once and kept in a bounded cache.
+    static std::shared_ptr<const MetricInfo> cached(const std::string& name);
+    static std::string properIdWithoutUnits(const std::string& id); /// canonical name, with any units tag removed
+    static std::string lineProtocolKey(const std::string& properId, const std::string& units, bool escaped = false); /// canonical name with a units tag, optionally with spaces escaped for the influx line protocol
+    static void setCacheCapacity(size_t entries); /// per cache. default 65536
   };
 }
 
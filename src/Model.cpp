@@ -30,6 +30,7 @@
 
 #include <boost/range/adaptors.hpp>
 #include <future>
+#include <chrono>
 #include <boost/interprocess/sync/scoped_lock.hpp>
 
 using boost::signals2::mutex;
@@ -40,6 +41,10 @@ using namespace std;
 
 bool _rtxmodel_isDbRecord(PointRecord::_sp record);
 
+static double _rtxmodel_secondsSince(std::chrono::steady_clock::time_point t1) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+}
+
 
 Model::Model() : _flowUnits(1), _headUnits(1), _pressureUnits(1) {
   this->initObj();
@@ -74,6 +79,8 @@ void Model::initObj() {
   
   _filterWallTime.reset(new TimeSeries);
   _filterWallTime->name("duration,component=filter,generator=simulation")->units(RTX_SECOND);
+  _fetchWallTime.reset(new TimeSeries);
+  _fetchWallTime->name("duration,component=fetch,generator=simulation")->units(RTX_SECOND);
   
   _doesOverrideDemands = false;
   _shouldRunWaterQuality = false;
@@ -163,7 +170,14 @@ void Model::setDidSimulateCallback(std::function<void(time_t)> cb) {
 }
 
 void Model::logLine(const std::string& line) {
-  DebugLog << line << EOL << flush;
+  RtxLog::level_t level = RtxLog::RtxLogInfo;
+  if (line.compare(0, 5, "ERROR") == 0) {
+    level = RtxLog::RtxLogError;
+  }
+  else if (line.compare(0, 4, "WARN") == 0) {
+    level = RtxLog::RtxLogWarn;
+  }
+  RTX_LOG(level, "simulation") << line.substr(0, line.find_last_not_of('\n') + 1);
   string myLine(line);
   if (_simLogCallback != NULL) {
     size_t loc = myLine.find("\n");
@@ -266,6 +280,7 @@ void Model::setRecordForSimulationStats(PointRecord::_sp record) {
   _simWallTime->setRecord(record);
   _saveWallTime->setRecord(record);
   _filterWallTime->setRecord(record);
+  _fetchWallTime->setRecord(record);
 }
 
 TimeSeries::_sp Model::heartbeat() {
@@ -705,20 +720,16 @@ bool Model::solveAndSaveOutputAtTime(time_t simulationTime) {
       return false;
     }
   }
-  auto t1 = time(NULL);
+  auto t1 = chrono::steady_clock::now();
   
   // get parameters from the RTX elements, and pull them into the simulation
   setSimulationParameters(simulationTime);
-  auto filterDuration = time(NULL) - t1;
+  _filterWallTime->insert(Point(simulationTime, _rtxmodel_secondsSince(t1)));
   
-  _filterWallTime->insert(Point(simulationTime, (double)filterDuration));
-  
-  t1 = time(NULL);
+  t1 = chrono::steady_clock::now();
   // simulate this period, find the next timestep boundary.
   bool success = solveSimulation(simulationTime);
-  
-  auto simWallDuration = time(NULL) - t1;
-  _simWallTime->insert(Point(simulationTime, (double)simWallDuration));
+  _simWallTime->insert(Point(simulationTime, _rtxmodel_secondsSince(t1)));
   
   
   // save simulation stats here so we can track convergence issues
@@ -742,7 +753,9 @@ bool Model::solveAndSaveOutputAtTime(time_t simulationTime) {
       if (_saveStateFuture.valid()) {
         _saveStateFuture.wait();
       }
+      t1 = chrono::steady_clock::now();
       this->fetchSimulationStates();
+      _fetchWallTime->insert(Point(simulationTime, _rtxmodel_secondsSince(t1)));
       _saveStateFuture = async(launch::async, &Model::saveNetworkStates, this, simulationTime, stateRecordsUsed);
       
     }
@@ -781,19 +794,22 @@ bool Model::updateSimulationToTime(time_t updateToTime) {
     // and step the simulation to that time.
     stepSimulation(stepToTime);
     
-    struct tm * timeinfo;
-    timeinfo = localtime(&stepToTime);
-    stringstream ss;
-    ss << "INFO: Simulation step to :: " << asctime(timeinfo);
-    this->logLine(ss.str());
+    // the step line is only built when someone will see it
+    if (_simLogCallback != NULL) {
+      stringstream ss;
+      ss << "INFO: Simulation step to :: " << asctime(localtime(&stepToTime));
+      this->logLine(ss.str());
+    }
+    else {
+      RTX_LOG_INFO("simulation") << "step" << RtxLog::time("to", stepToTime);
+    }
     
     // solve the simulation at this new time.
     bool simOk = this->solveAndSaveOutputAtTime(this->currentSimulationTime());
     
     if(!simOk) {
-      timeinfo = localtime (&myTime);
       stringstream ss;
-      ss << "ERROR: Simulation failed :: " << asctime(timeinfo);
+      ss << "ERROR: Simulation failed :: " << asctime(localtime(&myTime));
       this->logLine(ss.str());
       this->logLine("INFO: Resetting Tank Levels due to model non-convergence");
       
@@ -818,6 +834,10 @@ void Model::runExtendedPeriod(time_t start, time_t end) {
   
   this->solveInitial(start);
   this->updateSimulationToTime(end);
+  // the last step's states are still being saved in the background
+  if (_saveStateFuture.valid()) {
+    _saveStateFuture.wait();
+  }
   this->cleanupModelAfterSimulation();
   
   _shouldCancelSimulation = false;
@@ -841,7 +861,6 @@ void Model::runForecast(time_t start, time_t end) {
   time_t nextSimulationTime = start;
   time_t nextResetTime = start;
   time_t stepToTime = start;
-  struct tm * timeinfo;
   bool success;
   
   
@@ -887,15 +906,14 @@ void Model::runForecast(time_t start, time_t end) {
       stepSimulation(stepToTime);
       simulationTime = currentSimulationTime();
       
-      timeinfo = localtime (&simulationTime);
-      cout << "Simulation time :: " << asctime(timeinfo) << EOL << flush;
+      RTX_LOG_INFO("simulation") << "forecast step" << RtxLog::time("time", simulationTime);
     }
     else {
       // simulation failed -- advance the time and reset tank levels
       nextClockTime = _regularMasterClock->timeAfter(simulationTime);
       simulationTime = nextClockTime;
       setCurrentSimulationTime(simulationTime);
-      cout << "will reset tanks" << EOL << flush;
+      RTX_LOG_WARN("simulation") << "forecast step failed; will reset tanks" << RtxLog::time("time", simulationTime);
       this->setTanksNeedReset(true);
     }
     
@@ -1137,9 +1155,8 @@ std::ostream& Model::toStream(std::ostream &stream) {
 }
 
 void Model::setSimulationParameters(time_t time) {
-  struct tm * timeinfo = localtime (&time);
-  
-  DebugLog << EOL << "*** SETTING MODEL INPUTS ***" << EOL;
+  // timestamps are only formatted on the (rare) error paths
+  RTX_LOG_DEBUG("model") << "setting model inputs" << RtxLog::time("time", time);
   // set all element parameters
   
   // allocate junction demands based on dmas, and set the junction demand values in the model.
@@ -1148,12 +1165,12 @@ void Model::setSimulationParameters(time_t time) {
     for(Dma::_sp dma: this->dmas()) {
       if ( dma->allocateDemandToJunctions(time) ) {
         stringstream ss;
-        ss << "ERROR: Invalid demand value for DMA " << dma->name() << "(" << dma->junctions().size() << "junctions)" << " :: " << asctime(timeinfo);
+        ss << "ERROR: Invalid demand value for DMA " << dma->name() << "(" << dma->junctions().size() << "junctions)" << " :: " << asctime(localtime(&time));
         this->logLine(ss.str());
       }
       else {
         Point dPoint = dma->demand()->pointAtOrBefore(time);
-        DebugLog << "*  DMA: " << dma->name() << " demand --> " << dPoint.value << EOL;
+        RTX_LOG_DEBUG("model") << "dma demand" << RtxLog::field("dma", dma->name()) << RtxLog::field("value", dPoint.value);
       }
       
     }
@@ -1172,11 +1189,11 @@ void Model::setSimulationParameters(time_t time) {
       if (p.isValid) {
         double headValue = Units::convertValue(p.value, reservoir->boundaryHead()->units(), headUnits());
         setReservoirHead( reservoir->name(), headValue );
-        DebugLog << "*  Reservoir " << reservoir->name() << " head --> " << p.value << EOL;
+        RTX_LOG_DEBUG("model") << "reservoir head" << RtxLog::field("reservoir", reservoir->name()) << RtxLog::field("value", p.value);
       }
       else {
         stringstream ss;
-        ss << "ERROR: Invalid head value for reservoir: " << reservoir->name() << " :: " << asctime(timeinfo);
+        ss << "ERROR: Invalid head value for reservoir: " << reservoir->name() << " :: " << asctime(localtime(&time));
         this->logLine(ss.str());
       }
     }
@@ -1185,7 +1202,7 @@ void Model::setSimulationParameters(time_t time) {
   // check for valid time with tank reset clock
   if (_tankResetClock && _tankResetClock->isValid(time)) {
     this->setTanksNeedReset(true);
-    DebugLog << "*  INFO :: TANKS NEED RESET" << EOL;
+    RTX_LOG_DEBUG("model") << "tanks need reset";
   }
   
   _checkTanksForReset(time);
@@ -1204,7 +1221,7 @@ void Model::setSimulationParameters(time_t time) {
 //      }
 //      else {
         stringstream ss;
-        ss << "ERROR: Invalid status value for valve: " << valve->name() << " :: " << asctime(timeinfo);
+        ss << "ERROR: Invalid status value for valve: " << valve->name() << " :: " << asctime(localtime(&time));
         this->logLine(ss.str());
 //      }
     }
@@ -1220,18 +1237,18 @@ void Model::setSimulationParameters(time_t time) {
             p = Point::convertPoint(p, settingUnits, this->flowUnits());
           }
           setValveSettingControl( valve->name(), p.value, enable );
-          DebugLog << "*  Valve " << valve->name() << " setting --> " << p.value << EOL;
+          RTX_LOG_DEBUG("model") << "valve setting" << RtxLog::field("valve", valve->name()) << RtxLog::field("value", p.value);
         }
         else {
           stringstream ss;
-          ss << "ERROR: Invalid setting value for Valve: " << valve->name() << " :: " << asctime(timeinfo);
+          ss << "ERROR: Invalid setting value for Valve: " << valve->name() << " :: " << asctime(localtime(&time));
           this->logLine(ss.str());
         }
       }
       else {
         setValveSettingControl( valve->name(), 0.0, disable );
         stringstream ss;
-        ss << "WARN: Ignoring setting for Valve because status is Closed: " << valve->name() << " :: " << asctime(timeinfo);
+        ss << "WARN: Ignoring setting for Valve because status is Closed: " << valve->name() << " :: " << asctime(localtime(&time));
 //        this->logLine(ss.str());
       }
     }
@@ -1246,11 +1263,11 @@ void Model::setSimulationParameters(time_t time) {
       if (p.isValid) {
         status = Pipe::status_t((int)(p.value));
         setPumpStatusControl( pump->name(), status, enable );
-        DebugLog << "*  Pump " << pump->name() << " status --> " << (p.value > 0 ? "ON" : "OFF") << EOL;
+        RTX_LOG_DEBUG("model") << "pump status" << RtxLog::field("pump", pump->name()) << RtxLog::field("on", p.value > 0);
       }
       else {
         stringstream ss;
-        ss << "ERROR: Invalid status value for pump: " << pump->name() << " :: " << asctime(timeinfo);
+        ss << "ERROR: Invalid status value for pump: " << pump->name() << " :: " << asctime(localtime(&time));
         this->logLine(ss.str());
       }
     }
@@ -1259,18 +1276,18 @@ void Model::setSimulationParameters(time_t time) {
         Point p = pump->settingBoundary()->pointAtOrBefore(time);
         if (p.isValid) {
           setPumpSettingControl( pump->name(), p.value, enable );
-          DebugLog << "*  Pump " << pump->name() << " setting --> " << p.value << EOL;
+          RTX_LOG_DEBUG("model") << "pump setting" << RtxLog::field("pump", pump->name()) << RtxLog::field("value", p.value);
         }
         else {
           stringstream ss;
-          ss << "ERROR: Invalid setting value for pump: " << pump->name() << " :: " << asctime(timeinfo);
+          ss << "ERROR: Invalid setting value for pump: " << pump->name() << " :: " << asctime(localtime(&time));
           this->logLine(ss.str());
         }
       }
       else {
         setPumpSettingControl( pump->name(), 0.0, disable );
         stringstream ss;
-        ss << "WARN: Ignoring setting for Pump because status is Closed: " << pump->name() << " :: " << asctime(timeinfo);
+        ss << "WARN: Ignoring setting for Pump because status is Closed: " << pump->name() << " :: " << asctime(localtime(&time));
 //        this->logLine(ss.str());
       }
     }
@@ -1283,11 +1300,11 @@ void Model::setSimulationParameters(time_t time) {
       if (p.isValid) {
         Pipe::status_t status = Pipe::status_t((int)(p.value));
         setPipeStatusControl(pipe->name(), status, enable);
-        DebugLog << "*  Pipe " << pipe->name() << " status --> " << (p.value > 0 ? "ON" : "OFF") << EOL;
+        RTX_LOG_DEBUG("model") << "pipe status" << RtxLog::field("pipe", pipe->name()) << RtxLog::field("open", p.value > 0);
       }
       else {
         stringstream ss;
-        ss << "WARN: Invalid status value for pipe" << pipe->name() << " :: " << asctime(timeinfo);
+        ss << "WARN: Invalid status value for pipe" << pipe->name() << " :: " << asctime(localtime(&time));
         this->logLine(ss.str());
       }
     }
@@ -1303,11 +1320,11 @@ void Model::setSimulationParameters(time_t time) {
         if (p.isValid) {
           double quality = Units::convertValue(p.value, j->qualitySource()->units(), qualityUnits());
           setJunctionQuality(j->name(), quality);
-          DebugLog << "*  Junction " << j->name() << " quality --> " << p.value << EOL;
+          RTX_LOG_DEBUG("model") << "junction quality" << RtxLog::field("junction", j->name()) << RtxLog::field("value", p.value);
         }
         else {
           stringstream ss;
-          ss << "ERROR: Invalid quality value for junction" << j->name() << " :: " << asctime(timeinfo);
+          ss << "ERROR: Invalid quality value for junction" << j->name() << " :: " << asctime(localtime(&time));
           this->logLine(ss.str());
         }
       }
@@ -1319,17 +1336,16 @@ void Model::setSimulationParameters(time_t time) {
         if (p.isValid) {
           double qualityValue = Units::convertValue(p.value, reservoir->boundaryQuality()->units(), qualityUnits());
           setReservoirQuality( reservoir->name(), qualityValue );
-          DebugLog << "*  Reservoir " << reservoir->name() << " quality --> " << p.value << EOL;
+          RTX_LOG_DEBUG("model") << "reservoir quality" << RtxLog::field("reservoir", reservoir->name()) << RtxLog::field("value", p.value);
         }
         else {
           stringstream ss;
-          ss << "ERROR: Invalid quality value for reservoir: " << reservoir->name() << " :: " << asctime(timeinfo);
+          ss << "ERROR: Invalid quality value for reservoir: " << reservoir->name() << " :: " << asctime(localtime(&time));
           this->logLine(ss.str());
         }
       }
     }
   }
-  DebugLog << "****************************" << EOL << flush;
 }
 
 
@@ -1430,8 +1446,8 @@ void Model::fetchSimulationStates() {
 
 void Model::saveNetworkStates(time_t simtime, std::set<PointRecord::_sp> bulkRecords) {
   
-  DebugLog << "******* saving network states *********" << EOL << flush;
-  auto t1 = time(NULL);
+  RTX_LOG_DEBUG("model") << "saving network states" << RtxLog::time("time", simtime);
+  auto t1 = chrono::steady_clock::now();
 
   for(PointRecord::_sp r: bulkRecords) {
     r->beginBulkOperation();
@@ -1513,13 +1529,12 @@ void Model::saveNetworkStates(time_t simtime, std::set<PointRecord::_sp> bulkRec
   }
   
   
-  auto saveWallDuration = time(NULL) - t1;
-  _saveWallTime->insert(Point(simtime, (double)saveWallDuration));
+  _saveWallTime->insert(Point(simtime, _rtxmodel_secondsSince(t1)));
   
   // beating heart just after everything else is done.
   _heartbeat->insert(Point(simtime,1.0));
   
-  DebugLog << "******* finished saving states ********" << EOL << flush;
+  RTX_LOG_DEBUG("model") << "finished saving network states" << RtxLog::time("time", simtime);
 }
 
 void Model::setCurrentSimulationTime(time_t time) {
@@ -153,6 +153,12 @@ namespace RTX {
     TimeSeries::_sp relativeError() {return _relativeError;}
     TimeSeries::_sp convergence() {return _convergence; }
     
+    // wall-clock seconds spent in each phase of a simulation step, keyed by simulation time
+    TimeSeries::_sp filterWallTime() {return _filterWallTime;}
+    TimeSeries::_sp simulationWallTime() {return _simWallTime;}
+    TimeSeries::_sp fetchWallTime() {return _fetchWallTime;}
+    TimeSeries::_sp saveWallTime() {return _saveWallTime;}
+    
     void setTankResetClock(Clock::_sp resetClock);
     
     void setTanksNeedReset(bool reset);
@@ -303,7 +309,7 @@ namespace RTX {
     bool _dmaShouldDetectClosedLinks;
     
     Clock::_sp _regularMasterClock, _simReportClock;
-    TimeSeries::_sp _relativeError, _iterations, _convergence, _heartbeat, _simWallTime, _saveWallTime, _filterWallTime;
+    TimeSeries::_sp _relativeError, _iterations, _convergence, _heartbeat, _simWallTime, _saveWallTime, _filterWallTime, _fetchWallTime;
     Clock::_sp _tankResetClock;
     int _qualityTimeStep;
     bool _doesOverrideDemands;
@@ -52,34 +52,10 @@ PointCollection MovingAverage::filterPointsInRange(TimeRange range) {
     rangeToResample.end = this->source()->timeAfter(range.end - 1);
   }
   
-  TimeRange queryRange = rangeToResample;
-  queryRange.correctWithRange(range);
-  
   int margin = this->windowSize() / 2;
   
-  // expand source lookup bounds, counting as we go and ignoring invalid points.
-  for (int leftSeek = 0; leftSeek <= margin; ) {
-    time_t left = this->source()->timeBefore(queryRange.start);
-    if (left != 0) {
-      queryRange.start = left;
-      ++leftSeek;
-    }
-    else {
-      // end of valid points
-      break; // out of for(leftSeek)
-    }
-  }
-  for (int rightSeek = 0; rightSeek <= margin; ) {
-    time_t right = this->source()->timeAfter(queryRange.end);
-    if (right != 0) {
-      queryRange.end = right;
-      ++rightSeek;
-    }
-    else {
-      // end of valid points
-      break; // out of for(rightSeek)
-    }
-  }
+  // expand source lookup bounds
+  TimeRange queryRange = this->inputRange(this->source(), range);
   
   // get the source's points, but
   // only retain valid points.
@@ -175,7 +151,7 @@ PointCollection MovingAverage::filterPointsInRange(TimeRange range) {
   }
   
   
-  PointCollection outData = PointCollection(filteredPoints, source()->units());
+  PointCollection outData = PointCollection(std::move(filteredPoints), source()->units());
   outData.addQualityFlag(Point::rtx_averaged);
   
   bool dataOk = false;
@@ -191,3 +167,12 @@ PointCollection MovingAverage::filterPointsInRange(TimeRange range) {
   
   return PointCollection(vector<Point>(),this->units());
 }
+
+
+TimeSeriesFilter::Reach MovingAverage::reach() {
+  // half a window of valid points on either side, plus one to be sure.
+  Reach r = TimeSeriesFilter::reach();
+  r.pointsBehind = this->windowSize() / 2 + 1;
+  r.pointsAhead = this->windowSize() / 2 + 1;
+  return r;
+}
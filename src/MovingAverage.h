@@ -30,6 +30,8 @@ namespace RTX {
     
     MovingAverage::_sp window(int nPoints) {this->setWindowSize(nPoints); return share_me(this);};
     
+    Reach reach();
+    
   protected:
     PointCollection filterPointsInRange(TimeRange range);
     
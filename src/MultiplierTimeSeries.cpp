@@ -1,4 +1,5 @@
 #include "MultiplierTimeSeries.h"
+#include "RtxArena.h"
 
 #include <stdlib.h>
 #include <boost/foreach.hpp>
@@ -94,18 +95,16 @@ PointCollection MultiplierTimeSeries::filterPointsInRange(RTX::TimeRange range)
   
   PointCollection secondary = this->secondary()->pointCollection(queryRange);
   
-  set<time_t> pTimes = primary.times();
-  set<time_t> sTimes = secondary.times();
-  
   set<time_t> combinedTimes;
-  combinedTimes.insert(pTimes.begin(), pTimes.end());
-  combinedTimes.insert(sTimes.begin(), sTimes.end());
+  auto addTime = [&](Point& p){ combinedTimes.insert(combinedTimes.end(), p.time); };
+  primary.apply(addTime);
+  secondary.apply(addTime);
 
   primary.resample(combinedTimes);
   secondary.resample(combinedTimes);
   
   typedef pair<Point,Point> PointPoint;
-  map<time_t, PointPoint> multiplyPoints;
+  RtxArena::map<time_t, PointPoint> multiplyPoints;
   
   for (auto t : combinedTimes) {
     multiplyPoints[t] = make_pair(Point(), Point());
@@ -116,8 +115,9 @@ PointCollection MultiplierTimeSeries::filterPointsInRange(RTX::TimeRange range)
   secondary.apply([&](Point& p){
     multiplyPoints[p.time].second = p;
   });
-  for (auto ppP : multiplyPoints) {
-    PointPoint pp = ppP.second;
+  dataPoints.reserve(multiplyPoints.size());
+  for (const auto& ppP : multiplyPoints) {
+    const PointPoint& pp = ppP.second;
     if (pp.first.isValid && pp.second.isValid) {
       Point mp;
       switch (_mode) {
@@ -134,7 +134,7 @@ PointCollection MultiplierTimeSeries::filterPointsInRange(RTX::TimeRange range)
     }
   }
   
-  PointCollection data(dataPoints, this->units());
+  PointCollection data(std::move(dataPoints), this->units());
   if (this->willResample()) {
     data.resample(this->timeValuesInRange(range));
   }
@@ -343,7 +343,7 @@ void OdbcAdapter::insertSingle(const std::string& id, Point point) {
   return; // unsupported
 }
 
-void OdbcAdapter::insertRange(const std::string& id, std::vector<Point> points) {
+void OdbcAdapter::insertRange(const std::string& id, const std::vector<Point>& points) {
   return; // unsupported
 }
 
@@ -25,7 +25,7 @@ namespace RTX {
     
     // insertions or alterations: may choose to ignore / deny
     void insertSingle(const std::string& id, Point point) {};
-    void insertRange(const std::string& id, std::vector<Point> points) {};
+    void insertRange(const std::string& id, const std::vector<Point>& points) {};
     void removeRecord(const std::string& id) {};
     bool insertIdentifierAndUnits(const std::string& id, Units units) {};
     
@@ -89,7 +89,7 @@ PointCollection OutlierExclusionTimeSeries::filterPointsInRange(TimeRange range)
     }
   }// end for each raw point
   
-  PointCollection outCollection(goodPoints, this->units());
+  PointCollection outCollection(std::move(goodPoints), this->units());
   if (this->willResample()) {
     outCollection.resample(proposedOutTimes);
   }
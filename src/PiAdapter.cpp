@@ -326,7 +326,7 @@ void PiAdapter::insertSingle(const std::string& id, Point point) {
   // nope.
 }
 
-void PiAdapter::insertRange(const std::string& id, std::vector<Point> points) {
+void PiAdapter::insertRange(const std::string& id, const std::vector<Point>& points) {
   // nope.
 }
 
@@ -22,10 +22,10 @@ inline void __apply(RTX::PointCollection::pvRange r, function<void(Point&)> fn)
 
 
 
-PointCollection::PointCollection(vector<Point> points, Units units) : units(units) {
-  this->setPoints(points);
+PointCollection::PointCollection(vector<Point> points, Units units) : units(units), _regular(-1), _period(0) {
+  this->setPoints(std::move(points));
 }
-PointCollection::PointCollection() : units(1) { 
+PointCollection::PointCollection() : units(1), _regular(-1), _period(0) { 
   this->setPoints(vector<Point>());
 }
 
@@ -36,6 +36,7 @@ pair<pvIt,pvIt> PointCollection::raw() const {
 void PointCollection::apply(std::function<void(Point&)> function) const {
   auto raw = this->raw();
   __apply(raw, function);
+  _regular = -1; // the function may have moved points in time
 }
 
 TimeRange PointCollection::range() const {
@@ -56,8 +57,47 @@ vector<Point> PointCollection::points() const {
   }
 }
 
+const vector<Point>& PointCollection::pointsRef() const {
+  return *_points;
+}
+
+vector<Point> PointCollection::takePoints() {
+  vector<Point> out;
+  if (_points.unique()) {
+    out = std::move(*_points);
+  }
+  else {
+    out = *_points;
+  }
+  this->setPoints(vector<Point>());
+  return out;
+}
+
 void PointCollection::setPoints(vector<Point> points) {
-  _points = make_shared< vector<Point> >(points);
+  _points = make_shared< vector<Point> >(std::move(points));
+  _regular = -1;
+}
+
+bool PointCollection::isRegular(time_t *period) const {
+  if (_regular < 0) {
+    _regular = 0;
+    const vector<Point>& pv = *_points;
+    if (pv.size() >= 2) {
+      time_t step = pv[1].time - pv[0].time;
+      bool even = (step > 0);
+      for (size_t i = 2; even && i < pv.size(); ++i) {
+        even = (pv[i].time - pv[i-1].time == step);
+      }
+      if (even) {
+        _regular = 1;
+        _period = step;
+      }
+    }
+  }
+  if (_regular == 1 && period) {
+    *period = _period;
+  }
+  return (_regular == 1);
 }
 
 const set<time_t> PointCollection::times() const {
@@ -73,10 +113,11 @@ bool PointCollection::convertToUnits(RTX::Units u) {
     return false;
   }
   vector<Point> converted;
+  converted.reserve(this->count());
   this->apply([&](Point& p){
     converted.push_back(Point::convertPoint(p, this->units, u));
   });
-  this->setPoints(converted);
+  this->setPoints(std::move(converted));
   this->units = u;
   return true;
 }
@@ -86,15 +127,16 @@ void PointCollection::addQualityFlag(Point::PointQuality q) {
   for(Point &p : pv) {
     p.addQualFlag(q);
   }
-  this->setPoints(pv);
+  this->setPoints(std::move(pv));
 }
 
 
 
-bool PointCollection::resample(set<time_t> timeList, ResampleMode mode) {
+bool PointCollection::resample(const set<time_t>& timeList, ResampleMode mode) {
   PointCollection c = this->resampledAtTimes(timeList,mode);
-  auto p = c.points();
-  this->setPoints(p);
+  _points = c._points; // take the new storage as-is; no need to copy it again
+  _regular = c._regular;
+  _period = c._period;
   
   if (this->count() > 0) {
     return true;
@@ -161,7 +203,7 @@ PointCollection PointCollection::resampledAtTimes(const std::set<time_t>& timeLi
     }
   }
   
-  return PointCollection(resampled,this->units);
+  return PointCollection(std::move(resampled), this->units);
 }
 
 
@@ -170,6 +212,19 @@ PointCollection::pvRange PointCollection::subRange(TimeRange r, PointCollection:
   pvIt r1 = it, r2 = it;
   pvIt end = _points->end();
   
+  time_t period;
+  if (this->isRegular(&period)) {
+    // evenly spaced: index arithmetic instead of a scan
+    const time_t t0 = _points->front().time;
+    const size_t n = _points->size();
+    size_t i0 = (r.start <= t0) ? 0 : std::min(n, (size_t)((r.start - t0 + period - 1) / period));
+    size_t i1 = (r.end < t0) ? 0 : std::min(n, (size_t)((r.end - t0) / period) + 1);
+    if (i0 >= i1) {
+      return make_pair(it, it);
+    }
+    return make_pair(it + i0, it + i1);
+  }
+  
   /*
    TODO:
    there is a nice optimization to be done here, but this attempt was half-baked.
@@ -211,10 +266,12 @@ PointCollection::pvRange PointCollection::subRange(TimeRange r, PointCollection:
 }
 
 PointCollection PointCollection::trimmedToRange(TimeRange range) const {
+  if (_points->empty() || (range.contains(_points->front().time) && range.contains(_points->back().time))) {
+    return *this; // already inside the range; share the points
+  }
   auto iters = this->subRange(range);
   vector<Point> ranged(iters.first,iters.second);
-  PointCollection c(ranged,this->units);
-  return c;
+  return PointCollection(std::move(ranged), this->units);
 }
 
 
@@ -222,7 +279,7 @@ PointCollection PointCollection::asDelta() const {
   vector<Point> deltaPoints;
   
   if (this->count() == 0) {
-    return PointCollection(deltaPoints, this->units);
+    return PointCollection(std::move(deltaPoints), this->units);
   }
   
   Point lastP = _points->front();
@@ -235,7 +292,7 @@ PointCollection PointCollection::asDelta() const {
     }
   });
   
-  return PointCollection(deltaPoints, this->units);
+  return PointCollection(std::move(deltaPoints), this->units);
 }
 
 
@@ -358,7 +415,10 @@ double PointCollection::interquartilerange(pvRange r) {
 }
 
 TimeRange PointCollection::timeRange(pvRange r) {
-  return TimeRange(r.first->time, r.second->time);
+  if (r.first == r.second) {
+    return TimeRange();
+  }
+  return TimeRange(r.first->time, (r.second - 1)->time); // r.second is one-past-the-end
 }
 
 
@@ -24,19 +24,23 @@ namespace RTX {
     typedef std::vector<Point>::iterator pvIt;
     typedef std::pair<pvIt,pvIt> pvRange;
     
-    PointCollection(std::vector<Point> points, Units units);
+    PointCollection(std::vector<Point> points, Units units); // pass an rvalue to hand over the points without a copy
     PointCollection();
     
     void apply(std::function<void(Point&)> function) const;
     pvRange raw() const;
     std::vector<Point> points() const;
+    const std::vector<Point>& pointsRef() const; /// no copy. valid while this collection is alive and its points are not replaced.
+    std::vector<Point> takePoints();             /// moves the points out if this collection is their only owner (else copies), and leaves it empty.
     void setPoints(std::vector<Point> points);
     
+    bool isRegular(time_t *period = NULL) const; /// evenly spaced, with no gaps. subRange() is O(1) on regular collections.
+    
     Units units;
     const std::set<time_t> times() const;
     TimeRange range() const;
     
-    bool resample(std::set<time_t> timeList, ResampleMode mode = ResampleModeLinear);
+    bool resample(const std::set<time_t>& timeList, ResampleMode mode = ResampleModeLinear);
     bool convertToUnits(Units u);
     void addQualityFlag(Point::PointQuality q);
     
@@ -69,6 +73,8 @@ namespace RTX {
     
   private:
     std::shared_ptr< std::vector<Point> > _points;
+    mutable int _regular; // -1 unknown, 0 irregular, 1 regular (spacing in _period)
+    mutable time_t _period;
   };
 }
 
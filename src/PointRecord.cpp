@@ -14,7 +14,7 @@ using namespace RTX;
 using namespace std;
 
 
-PointRecord::PointRecord() : _name("") {
+PointRecord::PointRecord() : _name(""), _catalogVersion(1) {
   
 }
 
@@ -40,14 +40,23 @@ std::ostream& PointRecord::toStream(std::ostream &stream) {
 
 bool PointRecord::registerAndGetIdentifierForSeriesWithUnits(std::string recordName, Units units) {
   
-  _idsCache.set(recordName, units);
-  
-  if (_singlePointCache.find(recordName) == _singlePointCache.end()) {
-    _singlePointCache[recordName] = Point();
+  if (!_idsCache.hasIdentifierAndUnits(recordName, units)) {
+    _idsCache.set(recordName, units);
+    this->_catalogChanged();
   }
+  this->handleForIdentifier(recordName);
   return true;
 }
 
+vector<bool> PointRecord::registerAndGetIdentifiersForSeriesWithUnits(const vector< pair<string, Units> >& idUnits) {
+  vector<bool> registered;
+  registered.reserve(idUnits.size());
+  for (auto& idu : idUnits) {
+    registered.push_back(this->registerAndGetIdentifierForSeriesWithUnits(idu.first, idu.second));
+  }
+  return registered;
+}
+
 IdentifierUnitsList PointRecord::identifiersAndUnits() {
   return _idsCache;
 }
@@ -58,18 +67,38 @@ bool PointRecord::exists(const std::string &name, const RTX::Units &units) {
 }
 
 
-Point PointRecord::point(const string& identifier, time_t time) {
-  // return the cached point if it is valid
-  
-  if (_singlePointCache.find(identifier) != _singlePointCache.end()) {
-    Point p = _singlePointCache[identifier];
-    if (p.time == time) {
-      return p;
-    }
+uint64_t PointRecord::catalogVersion() {
+  return _catalogVersion.load(std::memory_order_acquire);
+}
+
+void PointRecord::_catalogChanged() {
+  _catalogVersion.fetch_add(1, std::memory_order_acq_rel);
+}
+
+PointRecord::SeriesHandle PointRecord::handleForIdentifier(const std::string& identifier) {
+  std::lock_guard<std::mutex> lock(_handleMutex);
+  auto it = _handles.find(identifier);
+  if (it != _handles.end()) {
+    return it->second;
   }
-  
-  return Point();
-  
+  SeriesHandle handle = _handleNames.size();
+  _handleNames.push_back(identifier);
+  _handles[identifier] = handle;
+  return handle;
+}
+
+const std::string& PointRecord::identifierForHandle(SeriesHandle handle) {
+  std::lock_guard<std::mutex> lock(_handleMutex);
+  if (handle >= _handleNames.size()) {
+    static const std::string none;
+    return none;
+  }
+  return _handleNames[handle];
+}
+
+
+Point PointRecord::point(const string& identifier, time_t time) {
+  return this->_cachedPoint(this->handleForIdentifier(identifier), time);
 }
 
 
@@ -110,12 +139,11 @@ TimeRange PointRecord::range(const string& id) {
 
 
 void PointRecord::addPoint(const string& identifier, Point point) {
-  // Cache this single point
-  _singlePointCache[identifier] = point;
+  this->_cachePoint(this->handleForIdentifier(identifier), point);
 }
 
 
-void PointRecord::addPoints(const string& identifier, std::vector<Point> points) {
+void PointRecord::addPoints(const string& identifier, const std::vector<Point>& points) {
   
 }
 
@@ -129,3 +157,52 @@ void PointRecord::reset(const string& identifier) {
 }
 
 
+#pragma mark - handles
+
+Point PointRecord::point(SeriesHandle series, time_t time) {
+  return this->point(this->identifierForHandle(series), time);
+}
+
+Point PointRecord::pointBefore(SeriesHandle series, time_t time, WhereClause q) {
+  return this->pointBefore(this->identifierForHandle(series), time, q);
+}
+
+Point PointRecord::pointAfter(SeriesHandle series, time_t time, WhereClause q) {
+  return this->pointAfter(this->identifierForHandle(series), time, q);
+}
+
+std::vector<Point> PointRecord::pointsInRange(SeriesHandle series, TimeRange range) {
+  return this->pointsInRange(this->identifierForHandle(series), range);
+}
+
+void PointRecord::addPoint(SeriesHandle series, Point point) {
+  this->addPoint(this->identifierForHandle(series), point);
+}
+
+void PointRecord::addPoints(SeriesHandle series, const std::vector<Point>& points) {
+  this->addPoints(this->identifierForHandle(series), points);
+}
+
+void PointRecord::reset(SeriesHandle series) {
+  this->reset(this->identifierForHandle(series));
+}
+
+
+Point PointRecord::_cachedPoint(SeriesHandle series, time_t time) {
+  // return the cached point if it is valid
+  std::lock_guard<std::mutex> lock(_singlePointMutex);
+  if (series < _singlePointCache.size() && _singlePointCache[series].time == time) {
+    return _singlePointCache[series];
+  }
+  return Point();
+}
+
+void PointRecord::_cachePoint(SeriesHandle series, const Point& point) {
+  std::lock_guard<std::mutex> lock(_singlePointMutex);
+  if (series >= _singlePointCache.size()) {
+    _singlePointCache.resize(series + 1);
+  }
+  _singlePointCache[series] = point;
+}
+
+
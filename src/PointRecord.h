@@ -15,6 +15,9 @@
 #include <deque>
 #include <fstream>
 #include <map>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
 #include <boost/atomic.hpp>
 
 
@@ -57,10 +60,18 @@ namespace RTX {
    */
   
     
+  /*!
+   \typedef PointRecord::SeriesHandle
+   \brief A series identifier interned by a record.
+   
+   Handles are small integers, issued in order by handleForIdentifier() and never reused, so a record can index its series by handle instead of hashing or comparing names. Interning is case-sensitive, and a handle only means something to the record that issued it. TimeSeries gets its handle when it registers, and uses it for every lookup after that.
+   */
+  
   class PointRecord : public RTX_object {
     
   public:
     RTX_BASE_PROPS(PointRecord);
+    typedef size_t SeriesHandle;
     
     PointRecord();
     virtual ~PointRecord() {};
@@ -69,9 +80,14 @@ namespace RTX {
     void setName(std::string name);
     
     virtual bool registerAndGetIdentifierForSeriesWithUnits(std::string recordName, Units units);    // registering record names.
+    virtual std::vector<bool> registerAndGetIdentifiersForSeriesWithUnits(const std::vector< std::pair<std::string, Units> >& idUnits); // bulk form
     virtual IdentifierUnitsList identifiersAndUnits();
     
     bool exists(const std::string& name, const Units& units);
+    uint64_t catalogVersion(); /// changes whenever a series is added, removed, or changes units. if it hasn't changed, neither has exists().
+    
+    SeriesHandle handleForIdentifier(const std::string& identifier); // interns the name on first use
+    const std::string& identifierForHandle(SeriesHandle handle);
     
     //virtual bool isPointAvailable(const string& identifier, time_t time);
     virtual Point point(const string& identifier, time_t time);
@@ -79,7 +95,7 @@ namespace RTX {
     virtual Point pointAfter(const string& identifier, time_t time, WhereClause q = WhereClause());
     virtual std::vector<Point> pointsInRange(const string& identifier, TimeRange range);
     virtual void addPoint(const string& identifier, Point point);
-    virtual void addPoints(const string& identifier, std::vector<Point> points);
+    virtual void addPoints(const string& identifier, const std::vector<Point>& points);
     virtual void reset(); // clear memcache for all ids
     virtual void reset(const string& identifier); // clear memcache for just this id
     virtual void invalidate(const string& identifier) {reset(identifier);}; // alias here, override for database implementations
@@ -90,16 +106,33 @@ namespace RTX {
     
     virtual std::ostream& toStream(std::ostream &stream);
     
+    // lookups by handle. these forward to the name-based methods; records that index by handle override both.
+    virtual Point point(SeriesHandle series, time_t time);
+    virtual Point pointBefore(SeriesHandle series, time_t time, WhereClause q = WhereClause());
+    virtual Point pointAfter(SeriesHandle series, time_t time, WhereClause q = WhereClause());
+    virtual std::vector<Point> pointsInRange(SeriesHandle series, TimeRange range);
+    virtual void addPoint(SeriesHandle series, Point point);
+    virtual void addPoints(SeriesHandle series, const std::vector<Point>& points);
+    virtual void reset(SeriesHandle series);
+    
     virtual void beginBulkOperation() {};
     virtual void endBulkOperation() {};
     
     
   protected:
-    std::map<std::string,Point> _singlePointCache;
+    void _catalogChanged(); // subclasses call this when their list of series changes
+    Point _cachedPoint(SeriesHandle series, time_t time);
+    void _cachePoint(SeriesHandle series, const Point& point);
+    std::vector<Point> _singlePointCache; // by handle
+    std::mutex _singlePointMutex; // filters may be evaluated concurrently
     IdentifierUnitsList _idsCache;
     
   private:
     std::string _name;
+    std::unordered_map<std::string, SeriesHandle> _handles;
+    std::deque<std::string> _handleNames; // by handle. a deque, so names never move once interned.
+    std::mutex _handleMutex;
+    std::atomic<uint64_t> _catalogVersion;
   
   };
   
@@ -0,0 +1,96 @@
+//
+//  QueryPlanner.cpp
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#include "QueryPlanner.h"
+
+#include <set>
+#include <functional>
+
+using namespace RTX;
+using namespace std;
+
+
+static void mergeRange(map<TimeSeries::_sp, TimeRange>& ranges, TimeSeries::_sp ts, TimeRange r) {
+  auto found = ranges.find(ts);
+  if (found == ranges.end()) {
+    ranges[ts] = r;
+  }
+  else {
+    found->second.start = RTX_MIN(found->second.start, r.start);
+    found->second.end = RTX_MAX(found->second.end, r.end);
+  }
+}
+
+
+void QueryPlanner::addQuery(TimeSeries::_sp ts, TimeRange range) {
+  if (!ts || !range.isValid()) {
+    return;
+  }
+  mergeRange(_queries, ts, range);
+}
+
+void QueryPlanner::clear() {
+  _queries.clear();
+}
+
+vector<TimeSeries::_sp> QueryPlanner::evaluationOrder() {
+  // depth-first post-order over inputs: every input is listed before its consumers.
+  vector<TimeSeries::_sp> order;
+  set<TimeSeries::_sp> visited;
+  
+  function<void(TimeSeries::_sp)> visit = [&](TimeSeries::_sp ts) {
+    visited.insert(ts);
+    auto filter = dynamic_pointer_cast<TimeSeriesFilter>(ts);
+    if (filter) {
+      for (auto input : filter->inputs()) {
+        if (input && visited.count(input) == 0) {
+          visit(input);
+        }
+      }
+    }
+    order.push_back(ts);
+  };
+  
+  for (auto& q : _queries) {
+    if (visited.count(q.first) == 0) {
+      visit(q.first);
+    }
+  }
+  return order;
+}
+
+map<TimeSeries::_sp, TimeRange> QueryPlanner::plan() {
+  map<TimeSeries::_sp, TimeRange> ranges = _queries;
+  
+  // consumers first, so that each series' range is complete before it is pushed to its inputs.
+  auto order = this->evaluationOrder();
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    auto filter = dynamic_pointer_cast<TimeSeriesFilter>(*it);
+    auto found = ranges.find(*it);
+    if (!filter || found == ranges.end()) {
+      continue;
+    }
+    for (auto input : filter->inputs()) {
+      if (input) {
+        mergeRange(ranges, input, filter->inputRange(input, found->second));
+      }
+    }
+  }
+  
+  return ranges;
+}
+
+void QueryPlanner::prefetch() {
+  auto ranges = this->plan();
+  for (auto ts : this->evaluationOrder()) {
+    auto found = ranges.find(ts);
+    if (found != ranges.end()) {
+      ts->points(found->second);
+    }
+  }
+}
@@ -0,0 +1,47 @@
+//
+//  QueryPlanner.h
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#ifndef __epanet_rtx__QueryPlanner__
+#define __epanet_rtx__QueryPlanner__
+
+#include <stdio.h>
+#include <map>
+#include <vector>
+
+#include "TimeSeries.h"
+#include "TimeSeriesFilter.h"
+
+namespace RTX {
+  
+  /*!
+   \class QueryPlanner
+   \brief Computes, ahead of time, the exact range of every upstream series that a set of queries will touch.
+   
+   Add the series and ranges you are about to query, then ask for the plan. The planner walks the filter graph from the queried series toward the roots, applying each filter's declared reach (TimeSeriesFilter::reach, TimeSeriesFilter::inputRange) and merging the ranges needed by all consumers of a shared input.
+   
+   QueryPlanner::prefetch then fetches every root series once over its planned range, and evaluates the filters from the roots down, so the real queries that follow are answered from cache.
+   
+   Point-count reach (e.g. a moving average window) is resolved by asking the input for neighboring times, so planning may itself touch the input's records.
+   */
+  
+  class QueryPlanner {
+  public:
+    void addQuery(TimeSeries::_sp ts, TimeRange range);
+    void clear();
+    
+    std::map<TimeSeries::_sp, TimeRange> plan();  /// planned range for every series in the graph
+    std::vector<TimeSeries::_sp> evaluationOrder(); /// inputs before the filters that read them
+    void prefetch();
+    
+  private:
+    std::map<TimeSeries::_sp, TimeRange> _queries;
+  };
+  
+}
+
+#endif /* defined(__epanet_rtx__QueryPlanner__) */
@@ -0,0 +1,301 @@
+//
+//  RegularSeries.cpp
+//  epanet-rtx
+//
+//  Created by the EPANET-RTX Development Team
+//  See README.md and license.txt for more information
+//
+
+#include "RegularSeries.h"
+
+#include <algorithm>
+
+using namespace RTX;
+using namespace std;
+
+RegularSeries::RegularSeries() : _start(0), _period(0), _offset(0), _count(0) {
+}
+
+RegularSeries::RegularSeries(time_t period) : _start(0), _period(period), _offset(0), _count(0) {
+}
+
+bool RegularSeries::detectPeriod(const std::vector<Point>& points, time_t& period) {
+  if (points.size() < 2) {
+    return false;
+  }
+  time_t step = 0;
+  for (size_t i = 1; i < points.size(); ++i) {
+    time_t d = points[i].time - points[i-1].time;
+    if (d <= 0) {
+      return false; // unsorted, or repeated times
+    }
+    step = (step == 0) ? d : std::min(step, d);
+  }
+  for (size_t i = 1; i < points.size(); ++i) {
+    if ((points[i].time - points[i-1].time) % step != 0) {
+      return false;
+    }
+  }
+  size_t nSlots = (size_t)((points.back().time - points.front().time) / step) + 1;
+  if (nSlots > 2 * points.size()) {
+    return false; // too sparse to be worth it
+  }
+  period = step;
+  return true;
+}
+
+
+#pragma mark - lookup
+
+bool RegularSeries::isAligned(time_t time) const {
+  if (_count == 0) {
+    return true;
+  }
+  return _period > 0 && (time - _start) % _period == 0;
+}
+
+bool RegularSeries::_slot(time_t time, size_t& i) const {
+  if (_count == 0 || time < _start || (time - _start) % _period != 0) {
+    return false;
+  }
+  i = (size_t)((time - _start) / _period);
+  return i < this->slots();
+}
+
+Point RegularSeries::_at(size_t i) const {
+  size_t k = _offset + i;
+  Point p(_start + (time_t)i * _period, _values[k], (Point::PointQuality)_quality[k], (_confidence.empty()) ? 0. : _confidence[k]);
+  p.isValid = _valid[k];
+  return p;
+}
+
+TimeRange RegularSeries::range() const {
+  if (_count == 0) {
+    return TimeRange();
+  }
+  return TimeRange(_start, _start + (time_t)(this->slots() - 1) * _period);
+}
+
+size_t RegularSeries::bytes() const {
+  return _values.capacity() * sizeof(double) + _quality.capacity() + (_present.capacity() + _valid.capacity()) / 8 + _confidence.capacity() * sizeof(double);
+}
+
+Point RegularSeries::point(time_t time) const {
+  size_t i;
+  if (_slot(time, i) && _has(i)) {
+    return _at(i);
+  }
+  return Point();
+}
+
+Point RegularSeries::first() const {
+  return (_count == 0) ? Point() : _at(0);
+}
+
+Point RegularSeries::last() const {
+  return (_count == 0) ? Point() : _at(this->slots() - 1);
+}
+
+Point RegularSeries::pointBefore(time_t time, std::function<bool(const Point&)> accept) const {
+  if (_count == 0 || time <= _start) {
+    return Point();
+  }
+  size_t i = std::min((size_t)((time - 1 - _start) / _period), this->slots() - 1);
+  for (;;) {
+    if (_has(i)) {
+      Point p = _at(i);
+      if (!accept || accept(p)) {
+        return p;
+      }
+    }
+    if (i == 0) {
+      break;
+    }
+    --i;
+  }
+  return Point();
+}
+
+Point RegularSeries::pointAfter(time_t time, std::function<bool(const Point&)> accept) const {
+  if (_count == 0 || time >= this->range().end) {
+    return Point();
+  }
+  size_t i = (time < _start) ? 0 : (size_t)((time - _start) / _period) + 1;
+  for (; i < this->slots(); ++i) {
+    if (_has(i)) {
+      Point p = _at(i);
+      if (!accept || accept(p)) {
+        return p;
+      }
+    }
+  }
+  return Point();
+}
+
+vector<Point> RegularSeries::pointsInRange(TimeRange range) const {
+  vector<Point> out;
+  TimeRange mine = this->range();
+  if (_count == 0 || range.end < mine.start || range.start > mine.end) {
+    return out;
+  }
+  size_t i0 = (range.start <= _start) ? 0 : (size_t)((range.start - _start + _period - 1) / _period);
+  size_t i1 = std::min((size_t)((range.end - _start) / _period), this->slots() - 1);
+  out.reserve(i1 - i0 + 1);
+  for (size_t i = i0; i <= i1; ++i) {
+    if (_has(i)) {
+      out.push_back(_at(i));
+    }
+  }
+  return out;
+}
+
+vector<Point> RegularSeries::points() const {
+  return this->pointsInRange(this->range());
+}
+
+
+#pragma mark - storage
+
+size_t RegularSeries::slotsToInclude(time_t time) const {
+  if (_count == 0) {
+    return 1;
+  }
+  if (time < _start) {
+    return (size_t)((_start - time) / _period);
+  }
+  size_t i = (size_t)((time - _start) / _period);
+  return (i >= this->slots()) ? i - this->slots() + 1 : 0;
+}
+
+bool RegularSeries::set(const Point& p) {
+  if (_period <= 0) {
+    return false;
+  }
+  if (_count == 0) {
+    this->clear();
+    _start = p.time;
+    _grow(0, 1);
+  }
+  else if (!this->isAligned(p.time)) {
+    return false;
+  }
+  else if (p.time < _start) {
+    _grow((size_t)((_start - p.time) / _period), 0);
+    _start = p.time;
+  }
+  else {
+    size_t extra = this->slotsToInclude(p.time);
+    if (extra > 0) {
+      _grow(0, extra);
+    }
+  }
+
+  size_t k = _offset + (size_t)((p.time - _start) / _period);
+  if (!_present[k]) {
+    _present[k] = true;
+    ++_count;
+  }
+  _values[k] = p.value;
+  _quality[k] = (uint8_t)p.quality;
+  _valid[k] = p.isValid;
+  if (p.confidence != 0 || !_confidence.empty()) {
+    if (_confidence.empty()) {
+      _confidence.assign(_values.size(), 0.);
+    }
+    _confidence[k] = p.confidence;
+  }
+  return true;
+}
+
+void RegularSeries::trimFront(size_t maxCount) {
+  while (_count > maxCount && this->slots() > 0) {
+    if (_has(0)) {
+      --_count;
+    }
+    ++_offset;
+    _start += _period;
+  }
+  while (_count > 0 && !_has(0)) {
+    ++_offset;
+    _start += _period;
+  }
+  if (_count == 0) {
+    this->clear();
+  }
+  else if (_offset > 1024 && _offset * 2 > _values.size()) {
+    _compact();
+  }
+}
+
+void RegularSeries::trimBack(size_t maxCount) {
+  auto popBack = [&]() {
+    _values.pop_back();
+    _quality.pop_back();
+    _present.pop_back();
+    _valid.pop_back();
+    if (!_confidence.empty()) {
+      _confidence.pop_back();
+    }
+  };
+  while (_count > maxCount && this->slots() > 0) {
+    if (_has(this->slots() - 1)) {
+      --_count;
+    }
+    popBack();
+  }
+  while (_count > 0 && !_has(this->slots() - 1)) {
+    popBack();
+  }
+  if (_count == 0) {
+    this->clear();
+  }
+}
+
+void RegularSeries::clear() {
+  _values.clear();
+  _quality.clear();
+  _present.clear();
+  _valid.clear();
+  _confidence.clear();
+  _offset = 0;
+  _count = 0;
+  _start = 0;
+}
+
+void RegularSeries::_grow(size_t front, size_t back) {
+  if (back > 0) {
+    size_t n = _values.size() + back;
+    _values.resize(n, 0.);
+    _quality.resize(n, 0);
+    _present.resize(n, false);
+    _valid.resize(n, false);
+    if (!_confidence.empty()) {
+      _confidence.resize(n, 0.);
+    }
+  }
+  if (front > 0) {
+    // earlier history is rare; reclaim trimmed space, then shift everything over
+    _compact();
+    _values.insert(_values.begin(), front, 0.);
+    _quality.insert(_quality.begin(), front, 0);
+    _present.insert(_present.begin(), front, false);
+    _valid.insert(_valid.begin(), front, false);
+    if (!_confidence.empty()) {
+      _confidence.insert(_confidence.begin(), front, 0.);
+    }
+  }
+}
+
+void RegularSeries::_compact() {
+  if (_offset == 0) {
+    return;
+  }
+  _values.erase(_values.begin(), _values.begin() + _offset);
+  _quality.erase(_quality.begin(), _quality.begin() + _offset);
+  _present.erase(_present.begin(), _present.begin() + _offset);
+  _valid.erase(_valid.begin(), _valid.begin() + _offset);
+  if (!_confidence.empty()) {
+    _confidence.erase(_confidence.begin(), _confidence.begin() + _offset);
+  }
+  _offset = 0;
+}
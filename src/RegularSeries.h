@@ -0,0 +1,76 @@
+//
+//  RegularSeries.h
+//  epanet-rtx
+//
+//  Created by the EPANET-RTX Development Team
+//  See README.md and license.txt for more information
+//
+
+#ifndef epanet_rtx_RegularSeries_h
+#define epanet_rtx_RegularSeries_h
+
+#include <vector>
+#include <functional>
+#include <stdint.h>
+
+#include "Point.h"
+#include "TimeRange.h"
+
+namespace RTX {
+
+  /*!
+   \class RegularSeries
+   \brief Dense storage for points on a regular time grid (start + n * period).
+
+   Instead of a (time, value, quality, confidence) tuple per point, this keeps one value and one quality byte per slot, plus bitmaps for which slots hold a point and which of those points are valid. Confidence is only stored once a point with a non-zero confidence arrives. Finding a time is arithmetic, not a search.
+
+   Empty slots (gaps in the grid) are allowed. The first and last slots always hold a point, so range() spans exactly the stored points.
+   */
+  class RegularSeries {
+  public:
+    RegularSeries();
+    RegularSeries(time_t period);
+
+    /// the common spacing of these sorted points, if it exists, gaps are no more than one slot per point, and there are at least two points
+    static bool detectPeriod(const std::vector<Point>& points, time_t& period);
+
+    time_t period() const {return _period;};
+    size_t count() const {return _count;};   /// stored points
+    size_t slots() const {return _values.size() - _offset;};
+    bool empty() const {return _count == 0;};
+    bool isAligned(time_t time) const;       /// on the grid. any time is, while the series is empty.
+    TimeRange range() const;
+    size_t bytes() const;                    /// heap memory in use
+
+    Point point(time_t time) const;          /// invalid Point() if nothing is stored at that time
+    Point first() const;
+    Point last() const;
+    Point pointBefore(time_t time, std::function<bool(const Point&)> accept = nullptr) const; /// latest stored point before time
+    Point pointAfter(time_t time, std::function<bool(const Point&)> accept = nullptr) const;  /// earliest stored point after time
+    std::vector<Point> pointsInRange(TimeRange range) const;
+    std::vector<Point> points() const;
+
+    bool set(const Point& p);                /// store or replace; grows the grid at either end. false if the time is not aligned.
+    size_t slotsToInclude(time_t time) const; /// slots set() would add to reach this time
+    void trimFront(size_t maxCount);         /// drop the oldest points until at most maxCount remain
+    void trimBack(size_t maxCount);          /// drop the newest points until at most maxCount remain
+    void clear();
+
+  private:
+    time_t _start, _period;
+    size_t _offset, _count; // storage index of the first slot (trimmed slots ahead of it are reclaimed lazily)
+    std::vector<double> _values;
+    std::vector<uint8_t> _quality;
+    std::vector<bool> _present, _valid;
+    std::vector<double> _confidence; // empty while every confidence is zero
+
+    bool _slot(time_t time, size_t& i) const;
+    Point _at(size_t i) const;
+    bool _has(size_t i) const {return _present[_offset + i];};
+    void _grow(size_t front, size_t back);
+    void _compact();
+  };
+
+}
+
+#endif
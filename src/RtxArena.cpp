@@ -0,0 +1,137 @@
+//
+//  RtxArena.cpp
+//  epanet-rtx
+//
+//  Created by the EPANET-RTX Development Team
+//  See README.md and license.txt for more information
+//
+
+#include "RtxArena.h"
+
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+using namespace RTX;
+
+namespace {
+  const size_t _arenaFirstBlock = 64 * 1024;
+  atomic<size_t> _arenaRetained(4 * 1024 * 1024);
+
+  // the arena itself is created lazily, by the first scope on each thread
+  thread_local RtxArena *_arenaCurrent = NULL;
+}
+
+
+#pragma mark - Scope
+
+RtxArena::Scope::Scope() {
+  if (!_arenaCurrent) {
+    static thread_local RtxArena arena;
+    _arenaCurrent = &arena;
+  }
+  _arena = _arenaCurrent;
+  _block = _arena->_block;
+  _offset = _arena->_offset;
+  ++_arena->_depth;
+}
+
+RtxArena::Scope::~Scope() {
+  _arena->_release(_block, _offset);
+}
+
+
+#pragma mark - arena
+
+RtxArena::RtxArena() : _block(0), _offset(0), _depth(0) {
+}
+
+RtxArena::~RtxArena() {
+  for (auto& b : _blocks) {
+    ::free(b.data);
+  }
+  if (_arenaCurrent == this) {
+    _arenaCurrent = NULL;
+  }
+}
+
+RtxArena* RtxArena::current() {
+  if (_arenaCurrent && _arenaCurrent->_depth > 0) {
+    return _arenaCurrent;
+  }
+  return NULL;
+}
+
+void* RtxArena::allocate(size_t bytes, size_t alignment) {
+  if (bytes == 0) {
+    bytes = 1;
+  }
+  // find room in the current block, or move on to the next one that fits
+  while (_block < _blocks.size()) {
+    Block& b = _blocks[_block];
+    size_t aligned = (_offset + alignment - 1) & ~(alignment - 1);
+    if (aligned + bytes <= b.size) {
+      _offset = aligned + bytes;
+      return b.data + aligned;
+    }
+    ++_block;
+    _offset = 0;
+  }
+
+  // new block: double the last one, or large enough for this request
+  size_t size = (_blocks.empty()) ? _arenaFirstBlock : _blocks.back().size * 2;
+  size = std::max(size, bytes + alignment);
+  Block b;
+  b.data = static_cast<char*>(::malloc(size));
+  if (!b.data) {
+    throw std::bad_alloc();
+  }
+  b.size = size;
+  _blocks.push_back(b);
+  _block = _blocks.size() - 1;
+  size_t aligned = ((size_t)b.data + alignment - 1) & ~(alignment - 1);
+  _offset = (aligned - (size_t)b.data) + bytes;
+  return reinterpret_cast<void*>(aligned);
+}
+
+void RtxArena::_release(size_t block, size_t offset) {
+  _block = block;
+  _offset = offset;
+  if (--_depth > 0) {
+    return;
+  }
+  // outermost scope closed: trim what we hold onto between queries
+  size_t retained = _arenaRetained.load(memory_order_relaxed);
+  size_t kept = 0, nKept = 0;
+  while (nKept < _blocks.size() && kept + _blocks[nKept].size <= retained) {
+    kept += _blocks[nKept].size;
+    ++nKept;
+  }
+  for (size_t i = nKept; i < _blocks.size(); ++i) {
+    ::free(_blocks[i].data);
+  }
+  _blocks.resize(nKept);
+  _block = 0;
+  _offset = 0;
+}
+
+size_t RtxArena::bytesInUse() const {
+  size_t n = 0;
+  for (size_t i = 0; i < _block && i < _blocks.size(); ++i) {
+    n += _blocks[i].size;
+  }
+  return n + _offset;
+}
+
+size_t RtxArena::bytesReserved() const {
+  size_t n = 0;
+  for (auto& b : _blocks) {
+    n += b.size;
+  }
+  return n;
+}
+
+void RtxArena::setRetainedBytes(size_t bytes) {
+  _arenaRetained.store(bytes);
+}
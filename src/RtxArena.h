@@ -0,0 +1,99 @@
+//
+//  RtxArena.h
+//  epanet-rtx
+//
+//  Created by the EPANET-RTX Development Team
+//  See README.md and license.txt for more information
+//
+
+#ifndef epanet_rtx_RtxArena_h
+#define epanet_rtx_RtxArena_h
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <set>
+#include <map>
+#include <functional>
+
+namespace RTX {
+
+  /*!
+   \class RtxArena
+   \brief Per-thread monotonic memory for short-lived temporaries during filter evaluation.
+
+   Each thread owns one arena. A Scope marks the arena when it opens and rewinds it when it closes, so allocations made inside a scope are released together, with no per-object frees; scopes nest. The arena keeps its blocks between queries, so a warm thread evaluates filters without going to the heap for its scratch containers.
+
+   Containers using RtxArena::allocator bind to the current thread's arena when they are constructed (or to the heap, if no scope is open) and must not outlive the scope they were created in. Use them only for locals -- never for data that is returned, cached, or handed to another thread that may outlive the call.
+   */
+  class RtxArena {
+  public:
+    /// marks the current thread's arena, and rewinds it to the mark on destruction.
+    class Scope {
+    public:
+      Scope();
+      ~Scope();
+      Scope(const Scope&) = delete;
+      Scope& operator=(const Scope&) = delete;
+    private:
+      RtxArena *_arena;
+      size_t _block, _offset;
+    };
+
+    template<typename T>
+    class allocator {
+    public:
+      typedef T value_type;
+      allocator() : _arena(RtxArena::current()) {};
+      template<typename U> allocator(const allocator<U>& other) : _arena(other._arena) {};
+
+      T* allocate(size_t n) {
+        if (_arena) {
+          return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+      };
+      void deallocate(T* p, size_t) {
+        if (!_arena) {
+          ::operator delete(p);
+        }
+        // arena memory is released when the scope closes
+      };
+
+      template<typename U> bool operator==(const allocator<U>& other) const {return _arena == other._arena;};
+      template<typename U> bool operator!=(const allocator<U>& other) const {return _arena != other._arena;};
+
+    private:
+      template<typename U> friend class allocator;
+      RtxArena *_arena;
+    };
+
+    template<typename T> using vector = std::vector<T, allocator<T> >;
+    template<typename T> using set = std::set<T, std::less<T>, allocator<T> >;
+    template<typename K, typename V> using map = std::map<K, V, std::less<K>, allocator< std::pair<const K, V> > >;
+
+    static RtxArena* current(); /// this thread's arena, or NULL if no scope is open
+    void* allocate(size_t bytes, size_t alignment);
+
+    size_t bytesInUse() const;
+    size_t bytesReserved() const;
+    static void setRetainedBytes(size_t bytes); /// memory kept per thread when the outermost scope closes (default 4 MB)
+
+    ~RtxArena();
+
+  private:
+    RtxArena();
+    class Block {
+    public:
+      char *data;
+      size_t size;
+    };
+    std::vector<Block> _blocks;
+    size_t _block, _offset; // allocation cursor
+    int _depth;
+    void _release(size_t block, size_t offset);
+  };
+
+}
+
+#endif
@@ -0,0 +1,332 @@
+//
+//  RtxLog.cpp
+//  epanet-rtx
+//
+//  Created by the EPANET-RTX Development Team
+//  See README.md and license.txt for more information
+//
+
+#include "RtxLog.h"
+#include "RtxRing.h"
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <boost/algorithm/string/case_conv.hpp>
+
+using namespace std;
+using namespace RTX;
+
+namespace {
+
+  atomic<int> _logLevel(-1);
+  atomic<bool> _coreAlive(true);
+
+  class LogCore {
+  public:
+    LogCore() : ring(8192), stop(false), submitted(0), written(0), dropped(0) {};
+    ~LogCore() {
+      // static teardown. anything logged from here on goes straight to stderr.
+      _coreAlive.store(false);
+      stop.store(true);
+      if (worker.joinable()) {
+        worker.join();
+      }
+    }
+    void start() {
+      call_once(started, [this]() { worker = thread(&LogCore::run, this); });
+    }
+    void run() {
+      RtxLog::Record r;
+      int idle = 0;
+      for (;;) {
+        if (ring.pop(r)) {
+          idle = 0;
+          string line = RtxLog::format(r);
+          {
+            lock_guard<mutex> lock(sinkMutex);
+            if (sink) {
+              sink(r, line);
+            }
+            else {
+              cout << line << '\n' << flush;
+            }
+          }
+          written.fetch_add(1, memory_order_release);
+          continue;
+        }
+        if (stop.load()) {
+          return;
+        }
+        // back off while idle, so a quiet log costs nothing.
+        if (++idle < 64) {
+          this_thread::yield();
+        }
+        else {
+          this_thread::sleep_for(chrono::milliseconds(1));
+        }
+      }
+    }
+
+    RtxRing<RtxLog::Record> ring; // a full ring drops the record, it never blocks the caller
+    atomic<bool> stop;
+    atomic<uint64_t> submitted, written, dropped;
+    once_flag started;
+    thread worker;
+    mutex sinkMutex;
+    RtxLog::sink_t sink;
+  };
+
+  LogCore& _core() {
+    static LogCore core;
+    return core;
+  }
+
+  int _initialLevel() {
+    const char *env = getenv("RTX_LOG_LEVEL");
+    int level = (env) ? (int)RtxLog::levelFromString(env) : (int)RtxLog::RtxLogInfo;
+    int expected = -1;
+    _logLevel.compare_exchange_strong(expected, level);
+    return _logLevel.load(memory_order_relaxed);
+  }
+}
+
+
+#pragma mark - levels
+
+bool RtxLog::enabled(level_t level) {
+  int current = _logLevel.load(memory_order_relaxed);
+  if (current < 0) {
+    current = _initialLevel();
+  }
+  return (int)level >= current && level < RtxLogOff;
+}
+
+RtxLog::level_t RtxLog::level() {
+  int current = _logLevel.load(memory_order_relaxed);
+  return (level_t)((current < 0) ? _initialLevel() : current);
+}
+
+void RtxLog::setLevel(level_t level) {
+  _logLevel.store((int)level, memory_order_relaxed);
+}
+
+RtxLog::level_t RtxLog::levelFromString(const std::string& str) {
+  string s = boost::algorithm::to_lower_copy(str);
+  if (s == "trace") return RtxLogTrace;
+  if (s == "debug") return RtxLogDebug;
+  if (s == "info")  return RtxLogInfo;
+  if (s == "warn" || s == "warning") return RtxLogWarn;
+  if (s == "error") return RtxLogError;
+  if (s == "off" || s == "none")  return RtxLogOff;
+  return RtxLogInfo;
+}
+
+string RtxLog::levelName(level_t level) {
+  switch (level) {
+    case RtxLogTrace: return "TRACE";
+    case RtxLogDebug: return "DEBUG";
+    case RtxLogInfo:  return "INFO";
+    case RtxLogWarn:  return "WARN";
+    case RtxLogError: return "ERROR";
+    default:          return "OFF";
+  }
+}
+
+
+#pragma mark - sink
+
+void RtxLog::setSink(sink_t sink) {
+  LogCore& core = _core();
+  lock_guard<mutex> lock(core.sinkMutex);
+  core.sink = sink;
+}
+
+void RtxLog::flush() {
+  if (!_coreAlive.load()) {
+    return;
+  }
+  LogCore& core = _core();
+  uint64_t target = core.submitted.load(memory_order_acquire);
+  while (core.written.load(memory_order_acquire) < target && core.worker.joinable()) {
+    this_thread::sleep_for(chrono::microseconds(200));
+  }
+}
+
+uint64_t RtxLog::dropped() {
+  return _core().dropped.load();
+}
+
+void RtxLog::_submit(Record&& record) {
+  if (!_coreAlive.load(memory_order_relaxed)) {
+    fprintf(stderr, "%s\n", format(record).c_str());
+    return;
+  }
+  LogCore& core = _core();
+  core.start();
+  if (core.ring.push(std::move(record))) {
+    core.submitted.fetch_add(1, memory_order_release);
+  }
+  else {
+    core.dropped.fetch_add(1, memory_order_relaxed);
+  }
+}
+
+
+#pragma mark - formatting
+
+static void _rtxlog_appendValue(ostream& out, const RtxLog::Value& v) {
+  switch (v.type) {
+    case RtxLog::Value::ValueString:
+      out << v.s;
+      break;
+    case RtxLog::Value::ValueInt:
+      out << v.i;
+      break;
+    case RtxLog::Value::ValueDouble:
+      out << v.d;
+      break;
+    case RtxLog::Value::ValueBool:
+      out << (v.i ? "true" : "false");
+      break;
+    case RtxLog::Value::ValueTime: {
+      time_t t = (time_t)v.i;
+      struct tm tm;
+      gmtime_r(&t, &tm);
+      char buf[32];
+      strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+      out << buf;
+      break;
+    }
+  }
+}
+
+string RtxLog::format(const Record& record) {
+  stringstream out;
+  auto sinceEpoch = record.time.time_since_epoch();
+  time_t secs = (time_t)chrono::duration_cast<chrono::seconds>(sinceEpoch).count();
+  int millis = (int)(chrono::duration_cast<chrono::milliseconds>(sinceEpoch).count() % 1000);
+  struct tm tm;
+  gmtime_r(&secs, &tm);
+  char stamp[32];
+  strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &tm);
+
+  out << stamp << "." << setw(3) << setfill('0') << millis << setfill(' ') << "Z " << levelName(record.level);
+  if (record.component) {
+    out << " [" << record.component << "]";
+  }
+  out << " ";
+  for (const Value& v : record.message) {
+    _rtxlog_appendValue(out, v);
+  }
+  for (const Field& f : record.fields) {
+    out << " " << f.key << "=";
+    if (f.value.type == Value::ValueString && f.value.s.find(' ') != string::npos) {
+      out << "\"" << f.value.s << "\"";
+    }
+    else {
+      _rtxlog_appendValue(out, f.value);
+    }
+  }
+  return out.str();
+}
+
+
+#pragma mark - fields
+
+RtxLog::Field RtxLog::field(const std::string& key, const std::string& value) {
+  Field f;
+  f.key = key;
+  f.value.s = value;
+  return f;
+}
+
+RtxLog::Field RtxLog::field(const std::string& key, const char *value) {
+  return field(key, string(value ? value : ""));
+}
+
+RtxLog::Field RtxLog::field(const std::string& key, double value) {
+  Field f;
+  f.key = key;
+  f.value.type = Value::ValueDouble;
+  f.value.d = value;
+  return f;
+}
+
+RtxLog::Field RtxLog::field(const std::string& key, int64_t value) {
+  Field f;
+  f.key = key;
+  f.value.type = Value::ValueInt;
+  f.value.i = value;
+  return f;
+}
+
+RtxLog::Field RtxLog::field(const std::string& key, bool value) {
+  Field f;
+  f.key = key;
+  f.value.type = Value::ValueBool;
+  f.value.i = value ? 1 : 0;
+  return f;
+}
+
+RtxLog::Field RtxLog::time(const std::string& key, time_t value) {
+  Field f;
+  f.key = key;
+  f.value.type = Value::ValueTime;
+  f.value.i = (int64_t)value;
+  return f;
+}
+
+
+#pragma mark - Line
+
+RtxLog::Line::Line(level_t level, const char *component) {
+  _r.level = level;
+  _r.component = component;
+  _r.time = chrono::system_clock::now();
+}
+
+RtxLog::Line::~Line() {
+  RtxLog::_submit(std::move(_r));
+}
+
+RtxLog::Line& RtxLog::Line::operator<<(const Field& f) {
+  _r.fields.push_back(f);
+  return *this;
+}
+
+RtxLog::Line& RtxLog::Line::operator<<(const std::string& s) {
+  Value v;
+  v.s = s;
+  _r.message.push_back(std::move(v));
+  return *this;
+}
+
+RtxLog::Line& RtxLog::Line::operator<<(const char *s) {
+  return (*this) << string(s ? s : "");
+}
+
+RtxLog::Line& RtxLog::Line::operator<<(char c) {
+  return (*this) << string(1, c);
+}
+
+RtxLog::Line& RtxLog::Line::operator<<(bool b) {
+  Value v;
+  v.type = Value::ValueBool;
+  v.i = b ? 1 : 0;
+  _r.message.push_back(std::move(v));
+  return *this;
+}
+
+RtxLog::Line& RtxLog::Line::operator<<(double d) {
+  Value v;
+  v.type = Value::ValueDouble;
+  v.d = d;
+  _r.message.push_back(std::move(v));
+  return *this;
+}
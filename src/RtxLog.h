@@ -0,0 +1,129 @@
+//
+//  RtxLog.h
+//  epanet-rtx
+//
+//  Created by the EPANET-RTX Development Team
+//  See README.md and license.txt for more information
+//
+
+#ifndef epanet_rtx_RtxLog_h
+#define epanet_rtx_RtxLog_h
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <type_traits>
+#include <ctime>
+#include <stdint.h>
+
+/// statements below this level are compiled out entirely (0 trace, 1 debug, 2 info, 3 warn, 4 error)
+#ifndef RTX_LOG_COMPILED_LEVEL
+#define RTX_LOG_COMPILED_LEVEL 1
+#endif
+
+/*!
+ usage: RTX_LOG_INFO("model") << "simulation step" << RtxLog::time("to", t) << RtxLog::field("dma", name);
+ nothing after the macro is evaluated unless the level is enabled.
+ */
+#define RTX_LOG(level, component) if ((level) < RTX_LOG_COMPILED_LEVEL || !RTX::RtxLog::enabled(level)) {} else RTX::RtxLog::Line((level), (component))
+#define RTX_LOG_TRACE(component) RTX_LOG(RTX::RtxLog::RtxLogTrace, component)
+#define RTX_LOG_DEBUG(component) RTX_LOG(RTX::RtxLog::RtxLogDebug, component)
+#define RTX_LOG_INFO(component)  RTX_LOG(RTX::RtxLog::RtxLogInfo, component)
+#define RTX_LOG_WARN(component)  RTX_LOG(RTX::RtxLog::RtxLogWarn, component)
+#define RTX_LOG_ERROR(component) RTX_LOG(RTX::RtxLog::RtxLogError, component)
+
+namespace RTX {
+
+  /*!
+   \class RtxLog
+   \brief Leveled, structured logging with a background sink.
+
+   A log statement captures its arguments as raw values (numbers, strings, times) into a record and hands it to a lock-free ring buffer; a single background thread formats the record and passes it to the sink. The calling thread never formats, never waits on the sink, and never blocks -- if the ring is full, the record is dropped and counted.
+
+   The runtime level defaults to Info, or to the RTX_LOG_LEVEL environment variable (trace, debug, info, warn, error, off) if it is set. The default sink writes one line per record to standard output.
+   */
+  class RtxLog {
+  public:
+    typedef enum {
+      RtxLogTrace = 0,
+      RtxLogDebug = 1,
+      RtxLogInfo  = 2,
+      RtxLogWarn  = 3,
+      RtxLogError = 4,
+      RtxLogOff   = 5
+    } level_t;
+
+    class Value {
+    public:
+      typedef enum { ValueString, ValueInt, ValueDouble, ValueBool, ValueTime } type_t;
+      Value() : type(ValueString), i(0), d(0) {};
+      type_t type;
+      int64_t i;  // integers, bools and times
+      double d;
+      std::string s;
+    };
+
+    class Field {
+    public:
+      std::string key;
+      Value value;
+    };
+
+    class Record {
+    public:
+      level_t level;
+      std::chrono::system_clock::time_point time;
+      const char *component; // expected to be a string literal
+      std::vector<Value> message;
+      std::vector<Field> fields;
+    };
+
+    typedef std::function<void(const Record& record, const std::string& formatted)> sink_t;
+
+    static bool enabled(level_t level);
+    static level_t level();
+    static void setLevel(level_t level);
+    static level_t levelFromString(const std::string& str); /// unknown strings map to Info
+
+    static void setSink(sink_t sink); /// called from the background thread only. pass NULL to restore the default.
+    static void flush();              /// block until everything logged so far has reached the sink
+    static uint64_t dropped();        /// records lost to a full ring
+
+    static std::string format(const Record& record);
+    static std::string levelName(level_t level);
+
+    static Field field(const std::string& key, const std::string& value);
+    static Field field(const std::string& key, const char *value);
+    static Field field(const std::string& key, double value);
+    static Field field(const std::string& key, int64_t value);
+    static Field field(const std::string& key, int value) {return field(key, (int64_t)value);};
+    static Field field(const std::string& key, size_t value) {return field(key, (int64_t)value);};
+    static Field field(const std::string& key, bool value);
+    static Field time(const std::string& key, time_t value); /// formatted as an ISO-8601 UTC time by the sink thread
+
+    /// one statement under construction; submitted when it goes out of scope.
+    class Line {
+    public:
+      Line(level_t level, const char *component);
+      ~Line();
+      Line& operator<<(const Field& f);
+      Line& operator<<(const std::string& s);
+      Line& operator<<(const char *s);
+      Line& operator<<(char c);
+      Line& operator<<(bool b);
+      Line& operator<<(double d);
+      template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+      Line& operator<<(T i) { Value v; v.type = Value::ValueInt; v.i = (int64_t)i; _r.message.push_back(std::move(v)); return *this; };
+
+    private:
+      Record _r;
+    };
+
+  private:
+    static void _submit(Record&& record);
+  };
+
+}
+
+#endif
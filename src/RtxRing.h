@@ -0,0 +1,97 @@
+//
+//  RtxRing.h
+//  epanet-rtx
+//
+//  Created by the EPANET-RTX Development Team
+//  See README.md and license.txt for more information
+//
+
+#ifndef epanet_rtx_RtxRing_h
+#define epanet_rtx_RtxRing_h
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace RTX {
+
+  /*!
+   \class RtxRing
+   \brief Bounded multi-producer / single-consumer queue (Vyukov).
+
+   push() may be called from any number of threads; pop() from one thread at a time. Neither blocks: a full ring rejects the push, an empty one fails the pop. Items become visible to the consumer in the order their pushes completed, and a pop never sees a partially written slot. The capacity is rounded up to a power of two.
+   */
+  template<typename T>
+  class RtxRing {
+  public:
+    RtxRing(size_t capacity) : _mask(_roundUp(capacity) - 1), _slots(_mask + 1), _head(0), _tail(0) {
+      for (size_t i = 0; i <= _mask; ++i) {
+        _slots[i].seq.store(i, std::memory_order_relaxed);
+      }
+    };
+
+    size_t capacity() const {return _mask + 1;};
+
+    bool push(const T& item) {
+      T copy(item);
+      return this->push(std::move(copy));
+    };
+
+    bool push(T&& item) {
+      size_t pos = _head.load(std::memory_order_relaxed);
+      Slot *slot;
+      for (;;) {
+        slot = &_slots[pos & _mask];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+          if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+            break;
+          }
+        }
+        else if (diff < 0) {
+          return false; // full
+        }
+        else {
+          pos = _head.load(std::memory_order_relaxed);
+        }
+      }
+      slot->item = std::move(item);
+      slot->seq.store(pos + 1, std::memory_order_release);
+      return true;
+    };
+
+    bool pop(T& item) {
+      Slot *slot = &_slots[_tail & _mask];
+      if (slot->seq.load(std::memory_order_acquire) != _tail + 1) {
+        return false;
+      }
+      item = std::move(slot->item);
+      slot->seq.store(_tail + _mask + 1, std::memory_order_release);
+      ++_tail;
+      return true;
+    };
+
+  private:
+    static size_t _roundUp(size_t n) {
+      size_t c = 2;
+      while (c < n) {
+        c <<= 1;
+      }
+      return c;
+    };
+    class Slot {
+    public:
+      std::atomic<size_t> seq;
+      T item;
+    };
+    const size_t _mask;
+    std::vector<Slot> _slots;
+    std::atomic<size_t> _head;
+    size_t _tail; // consumer only
+  };
+
+}
+
+#endif
@@ -0,0 +1,222 @@
+//
+//  RtxTrace.cpp
+//  epanet-rtx
+//
+//  Created by the EPANET-RTX Development Team
+//  See README.md and license.txt for more information
+//
+
+#include "RtxTrace.h"
+
+#include <mutex>
+#include <chrono>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <boost/core/demangle.hpp>
+
+using namespace std;
+using namespace RTX;
+
+std::atomic<bool> RtxTrace::_enabled(getenv("RTX_TRACE") != NULL);
+
+namespace {
+  mutex _traceMutex;
+  vector<RtxTrace::Event> _traceEvents;
+  size_t _traceMaxEvents = 1000000;
+  atomic<uint64_t> _traceQueries(0), _traceDropped(0);
+  atomic<uint32_t> _traceThreads(0);
+  const chrono::steady_clock::time_point _traceEpoch = chrono::steady_clock::now();
+
+  // per thread: the innermost open span, and the finished spans of the query in progress.
+  thread_local RtxTrace::Span *_traceCurrent = NULL;
+  thread_local vector<RtxTrace::Event> _tracePending;
+  thread_local uint32_t _traceThreadId = 0;
+
+  int64_t _traceNow() {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - _traceEpoch).count();
+  }
+
+  string _traceJsonString(const string& s) {
+    stringstream out;
+    out << '"';
+    for (char c : s) {
+      switch (c) {
+        case '"':  out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+          if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", (unsigned int)c);
+            out << buf;
+          }
+          else {
+            out << c;
+          }
+      }
+    }
+    out << '"';
+    return out.str();
+  }
+
+  void _traceCommit(vector<RtxTrace::Event>& events) {
+    lock_guard<mutex> lock(_traceMutex);
+    for (auto& e : events) {
+      if (_traceEvents.size() >= _traceMaxEvents) {
+        _traceDropped.fetch_add(1, memory_order_relaxed);
+        continue;
+      }
+      _traceEvents.push_back(std::move(e));
+    }
+    events.clear();
+  }
+}
+
+
+#pragma mark - Span
+
+RtxTrace::Span::Span(const char *category) : _active(RtxTrace::enabled()), _pointsIn(0), _pointsOut(0), _hasPointsOut(false), _parent(NULL) {
+  if (!_active) {
+    return;
+  }
+  if (_traceThreadId == 0) {
+    _traceThreadId = ++_traceThreads;
+  }
+  _parent = _traceCurrent;
+  _traceCurrent = this;
+  _e.category = category;
+  _e.name = category;
+  _e.thread = _traceThreadId;
+  _e.depth = (_parent) ? _parent->_e.depth + 1 : 0;
+  _e.query = (_parent) ? _parent->_e.query : ++_traceQueries;
+  _e.startMicros = _traceNow();
+}
+
+RtxTrace::Span::~Span() {
+  if (!_active) {
+    return;
+  }
+  _e.durationMicros = _traceNow() - _e.startMicros;
+  if (_pointsIn > 0) {
+    this->_argInteger("points_in", (int64_t)_pointsIn);
+  }
+  if (_parent && _hasPointsOut && _series != _parent->_series) {
+    _parent->_pointsIn += _pointsOut;
+  }
+  _e.args.push_back(make_pair(string("query"), to_string(_e.query)));
+  _tracePending.push_back(std::move(_e));
+  _traceCurrent = _parent;
+  if (!_parent) {
+    _traceCommit(_tracePending);
+  }
+}
+
+void RtxTrace::Span::setName(const std::string& name) {
+  _e.name = name;
+}
+
+void RtxTrace::Span::setSeries(const std::string& series) {
+  _series = series;
+  this->arg("series", series);
+}
+
+void RtxTrace::Span::setPointsOut(size_t n) {
+  _pointsOut = n;
+  _hasPointsOut = true;
+  this->_argInteger("points_out", (int64_t)n);
+}
+
+void RtxTrace::Span::arg(const std::string& key, const std::string& value) {
+  if (_active) {
+    _e.args.push_back(make_pair(key, _traceJsonString(value)));
+  }
+}
+
+void RtxTrace::Span::arg(const std::string& key, double value) {
+  if (_active) {
+    stringstream ss;
+    ss << value;
+    _e.args.push_back(make_pair(key, ss.str()));
+  }
+}
+
+void RtxTrace::Span::_argInteger(const std::string& key, int64_t value) {
+  if (_active) {
+    _e.args.push_back(make_pair(key, to_string(value)));
+  }
+}
+
+
+#pragma mark - collection
+
+void RtxTrace::setEnabled(bool enabled) {
+  _enabled.store(enabled);
+}
+
+void RtxTrace::setMaxEvents(size_t maxEvents) {
+  lock_guard<mutex> lock(_traceMutex);
+  _traceMaxEvents = maxEvents;
+}
+
+void RtxTrace::clear() {
+  lock_guard<mutex> lock(_traceMutex);
+  _traceEvents.clear();
+  _traceDropped.store(0);
+}
+
+vector<RtxTrace::Event> RtxTrace::events() {
+  lock_guard<mutex> lock(_traceMutex);
+  return _traceEvents;
+}
+
+uint64_t RtxTrace::dropped() {
+  return _traceDropped.load();
+}
+
+string RtxTrace::chromeTrace() {
+  vector<Event> events = RtxTrace::events();
+  stringstream out;
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (const Event& e : events) {
+    out << (first ? "" : ",") << "\n{\"name\":" << _traceJsonString(e.name) << ",\"cat\":" << _traceJsonString(e.category)
+        << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread << ",\"ts\":" << e.startMicros << ",\"dur\":" << e.durationMicros << ",\"args\":{";
+    bool firstArg = true;
+    for (auto& a : e.args) {
+      out << (firstArg ? "" : ",") << _traceJsonString(a.first) << ":" << a.second;
+      firstArg = false;
+    }
+    out << "}}";
+    first = false;
+  }
+  out << "\n]}\n";
+  return out.str();
+}
+
+bool RtxTrace::writeChromeTrace(const std::string& path) {
+  ofstream f(path);
+  if (!f.is_open()) {
+    cerr << "could not open trace file " << path << endl;
+    return false;
+  }
+  f << RtxTrace::chromeTrace();
+  return f.good();
+}
+
+string RtxTrace::typeName(const std::type_info& type) {
+  string name = boost::core::demangle(type.name());
+  if (name.compare(0, 5, "RTX::") == 0) {
+    name = name.substr(5);
+  }
+  return name;
+}
+
+void RtxTrace::note(const std::string& key, const std::string& value) {
+  if (_traceCurrent) {
+    _traceCurrent->arg(key, value);
+  }
+}
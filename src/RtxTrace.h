@@ -0,0 +1,89 @@
+//
+//  RtxTrace.h
+//  epanet-rtx
+//
+//  Created by the EPANET-RTX Development Team
+//  See README.md and license.txt for more information
+//
+
+#ifndef epanet_rtx_RtxTrace_h
+#define epanet_rtx_RtxTrace_h
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <typeinfo>
+#include <type_traits>
+#include <stdint.h>
+
+namespace RTX {
+
+  /*!
+   \class RtxTrace
+   \brief Optional tracing of nested spans through the filter graph and database adapters.
+
+   While tracing is enabled, each TimeSeriesFilter::points() call, record lookup and adapter call records a span with its timing and details (class, series name, range, points in and out, cache hit or miss). Spans nest per thread; every span opened while no other span is open on that thread starts a new top-level query, and its descendants carry the same query id.
+
+   When tracing is disabled a span costs one relaxed atomic load. Tracing starts out disabled, unless the RTX_TRACE environment variable is set.
+
+   Finished queries are kept in memory (up to a maximum number of events) and can be exported with chromeTrace() for chrome://tracing or Perfetto.
+   */
+  class RtxTrace {
+  public:
+    class Event {
+    public:
+      std::string name, category;
+      uint64_t query;
+      int depth;
+      uint32_t thread;
+      int64_t startMicros, durationMicros;
+      std::vector< std::pair<std::string, std::string> > args; // key => json-encoded value
+    };
+
+    class Span {
+    public:
+      Span(const char *category);
+      ~Span();
+      Span(const Span&) = delete;
+      Span& operator=(const Span&) = delete;
+
+      bool active() const {return _active;};
+      void setName(const std::string& name);
+      void setSeries(const std::string& series); /// also added as an argument
+      void setPointsOut(size_t n);               /// counted as points-in by the enclosing span, if it belongs to another series
+      void arg(const std::string& key, const std::string& value);
+      void arg(const std::string& key, const char *value) {this->arg(key, std::string(value));};
+      void arg(const std::string& key, double value);
+      template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+      void arg(const std::string& key, T value) {this->_argInteger(key, (int64_t)value);};
+
+    private:
+      void _argInteger(const std::string& key, int64_t value);
+      bool _active;
+      Event _e;
+      std::string _series;
+      size_t _pointsIn, _pointsOut;
+      bool _hasPointsOut;
+      Span *_parent;
+    };
+
+    static bool enabled() {return _enabled.load(std::memory_order_relaxed);};
+    static void setEnabled(bool enabled);
+    static void setMaxEvents(size_t maxEvents); /// events beyond this are dropped (default 1,000,000)
+    static void clear();
+    static std::vector<Event> events();
+    static uint64_t dropped();
+
+    static std::string chromeTrace(); /// Chrome trace-event JSON
+    static bool writeChromeTrace(const std::string& path);
+
+    static std::string typeName(const std::type_info& type); /// demangled, without the RTX:: prefix
+    static void note(const std::string& key, const std::string& value); /// add an argument to the innermost open span on this thread
+
+  private:
+    static std::atomic<bool> _enabled;
+  };
+
+}
+
+#endif
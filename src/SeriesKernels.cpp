@@ -0,0 +1,107 @@
+//
+//  SeriesKernels.cpp
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#include "SeriesKernels.h"
+
+#include <cmath>
+#include <iostream>
+
+using namespace RTX;
+using namespace std;
+
+
+SeriesColumns::SeriesColumns(vector<Point>::const_iterator begin, vector<Point>::const_iterator end) {
+  size_t n = std::distance(begin, end);
+  time.resize(n);
+  value.resize(n);
+  size_t i = 0;
+  for (auto it = begin; it != end; ++it, ++i) {
+    time[i] = it->time;
+    value[i] = it->value;
+  }
+}
+
+
+UnitFactor::UnitFactor(const Units& fromUnits, const Units& toUnits) {
+  // ((x + fromOffset) * fromConv / toConv) - toOffset
+  if (fromUnits.isSameDimensionAs(toUnits)) {
+    scale = fromUnits.conversion() / toUnits.conversion();
+    offset = fromUnits.offset() * scale - toUnits.offset();
+  }
+  else {
+    cerr << "Units are not dimensionally consistent" << endl;
+    scale = 0.;
+    offset = 0.;
+  }
+}
+
+
+size_t SeriesKernels::difference(const time_t *t, const double *v, size_t n, carry_t& carry, const UnitFactor& f, double *out) {
+  if (n == 0) {
+    return 0;
+  }
+  size_t i = 0, nOut = 0;
+  if (!carry.isValid) {
+    carry.isValid = true;
+    carry.time = t[0];
+    carry.value = v[0];
+    i = 1;
+  }
+  
+  // first output pairs with the carried point, the rest with their neighbor.
+  if (i < n) {
+    out[nOut++] = (v[i] - carry.value) / double(t[i] - carry.time) * f.scale + f.offset;
+    ++i;
+  }
+  const double scale = f.scale, offset = f.offset;
+  for (; i < n; ++i) {
+    out[nOut++] = (v[i] - v[i-1]) / double(t[i] - t[i-1]) * scale + offset;
+  }
+  
+  carry.time = t[n-1];
+  carry.value = v[n-1];
+  return nOut;
+}
+
+size_t SeriesKernels::gap(const time_t *t, size_t n, carry_t& carry, const UnitFactor& f, double *out) {
+  if (n == 0) {
+    return 0;
+  }
+  size_t i = 0, nOut = 0;
+  if (!carry.isValid) {
+    carry.isValid = true;
+    carry.time = t[0];
+    i = 1;
+  }
+  
+  if (i < n) {
+    out[nOut++] = double(t[i] - carry.time) * f.scale + f.offset;
+    ++i;
+  }
+  const double scale = f.scale, offset = f.offset;
+  for (; i < n; ++i) {
+    out[nOut++] = double(t[i] - t[i-1]) * scale + offset;
+  }
+  
+  carry.time = t[n-1];
+  return nOut;
+}
+
+void SeriesKernels::threshold(const double *v, size_t n, double threshold, double onValue, bool absolute, double *out) {
+  // branch on mode once, keep the loops branch-free.
+  if (absolute) {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = (fabs(v[i]) > threshold) ? onValue : 0.;
+    }
+  }
+  else {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = (v[i] > threshold) ? onValue : 0.;
+    }
+  }
+}
@@ -0,0 +1,75 @@
+//
+//  SeriesKernels.h
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#ifndef __epanet_rtx__SeriesKernels__
+#define __epanet_rtx__SeriesKernels__
+
+#include <stdio.h>
+#include <vector>
+
+#include "Point.h"
+#include "Units.h"
+
+namespace RTX {
+  
+  /*!
+   \class SeriesColumns
+   \brief Column (structure-of-arrays) view of a run of points.
+   
+   Kernels operate on contiguous time and value arrays, so the inner loops have no per-point object overhead and are easy for the compiler to vectorize.
+   */
+  class SeriesColumns {
+  public:
+    SeriesColumns() {};
+    SeriesColumns(std::vector<Point>::const_iterator begin, std::vector<Point>::const_iterator end);
+    
+    size_t size() const { return time.size(); };
+    
+    std::vector<time_t> time;
+    std::vector<double> value;
+  };
+  
+  /*!
+   \class UnitFactor
+   \brief A unit conversion reduced to y = scale * x + offset.
+   
+   Equivalent to Units::convertValue, but computed once per call instead of once per point.
+   */
+  class UnitFactor {
+  public:
+    UnitFactor() : scale(1.), offset(0.) {};
+    UnitFactor(const Units& fromUnits, const Units& toUnits);
+    double scale, offset;
+  };
+  
+  /*!
+   \class SeriesKernels
+   \brief Column kernels for the point-to-point diagnostic filters.
+   
+   Kernels that need the previous point (difference, gap) take a carry_t holding it. If the carry is empty, the first input only primes it and produces no output. On return the carry holds the last input, so consecutive chunks can be processed without re-fetching the "one prior" point.
+   
+   Each kernel writes into the output array (sized by the caller to at least n) and returns the number of values written.
+   */
+  class SeriesKernels {
+  public:
+    class carry_t {
+    public:
+      carry_t() : isValid(false), time(0), value(0) {};
+      bool isValid;
+      time_t time;
+      double value;
+    };
+    
+    static size_t difference(const time_t *t, const double *v, size_t n, carry_t& carry, const UnitFactor& f, double *out); /// converted dv/dt
+    static size_t gap(const time_t *t, size_t n, carry_t& carry, const UnitFactor& f, double *out); /// converted seconds since previous point
+    static void threshold(const double *v, size_t n, double threshold, double onValue, bool absolute, double *out);
+  };
+  
+}
+
+#endif /* defined(__epanet_rtx__SeriesKernels__) */
@@ -159,17 +159,19 @@ IdentifierUnitsList SqliteAdapter::idUnitsList() {
   
   _metaCache.clear();
   _idCache.clear();
-    
+  
+  vector<pair<string,Units> > ids;
   _dbq << _selectNamesStr
   >> [&](int uid, string name, std::unique_ptr<string> unitStr) {
     Units units(RTX_NO_UNITS);
     if (unitStr != nullptr) {
       units = Units::unitOfType(*unitStr);
     }
-    _idCache.set(name,units);
+    ids.push_back(make_pair(name, units));
     _metaCache[name] = uid;
   };
-    
+  _idCache.set(ids);
+  
   return _idCache;
 }
 
@@ -283,7 +285,7 @@ void SqliteAdapter::insertSingleInTransaction(const std::string& id, Point point
 }
 
 
-void SqliteAdapter::insertRange(const std::string& id, std::vector<Point> points) {
+void SqliteAdapter::insertRange(const std::string& id, const std::vector<Point>& points) {
   
   this->commit(); // commit any transactions in progress
   
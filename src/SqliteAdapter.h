@@ -39,7 +39,7 @@ namespace RTX {
     // CREATE
     bool insertIdentifierAndUnits(const std::string& id, Units units);
     void insertSingle(const std::string& id, Point point);
-    void insertRange(const std::string& id, std::vector<Point> points);
+    void insertRange(const std::string& id, const std::vector<Point>& points);
     
     // UPDATE
     bool assignUnitsToRecord(const std::string& name, const Units& units);
@@ -122,7 +122,7 @@ PointCollection StatsTimeSeries::filterPointsInRange(TimeRange range) {
     }
   }
   
-  PointCollection ret(outPoints, this->units());
+  PointCollection ret(std::move(outPoints), this->units());
   
   if (this->willResample()) {
     ret.resample(times);
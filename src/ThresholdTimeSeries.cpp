@@ -1,6 +1,7 @@
 #include <boost/foreach.hpp>
 
 #include "ThresholdTimeSeries.h"
+#include "SeriesKernels.h"
 #include <cmath>
 
 using namespace std;
@@ -38,6 +39,40 @@ ThresholdTimeSeries::thresholdMode_t ThresholdTimeSeries::mode() {
 
 
 
+PointCollection ThresholdTimeSeries::filterPointsInRange(TimeRange range) {
+  TimeRange qRange = range;
+  if (this->willResample()) {
+    // expand range
+    qRange.start = this->source()->timeBefore(range.start + 1);
+    qRange.end = this->source()->timeAfter(range.end - 1);
+  }
+  qRange.correctWithRange(range);
+  
+  PointCollection data;
+  if (this->source()) {
+    data = source()->pointCollection(qRange);
+  }
+  
+  auto raw = data.raw();
+  SeriesColumns cols(raw.first, raw.second);
+  vector<double> status(cols.size());
+  SeriesKernels::threshold(cols.value.data(), cols.size(), _threshold, _fixedValue, (_mode == thresholdModeAbsolute), status.data());
+  
+  // every source point maps to an output point, so nothing is ever dropped.
+  vector<Point> outPoints;
+  outPoints.reserve(cols.size());
+  size_t i = 0;
+  for (auto it = raw.first; it != raw.second; ++it, ++i) {
+    outPoints.push_back(Point(it->time, status[i], it->quality, it->confidence));
+  }
+  
+  PointCollection outData(std::move(outPoints), this->units());
+  if (this->willResample()) {
+    outData.resample(this->timeValuesInRange(range));
+  }
+  return outData;
+}
+
 Point ThresholdTimeSeries::filteredWithSourcePoint(RTX::Point sourcePoint) {
   double pointValue;
   if (_mode == thresholdModeAbsolute) {
@@ -46,6 +46,7 @@ namespace RTX {
     ThresholdTimeSeries::_sp mode(thresholdMode_t m) {this->setMode(m); return share_me(this);};
     
   protected:
+    PointCollection filterPointsInRange(TimeRange range); // column kernel instead of point-by-point
     Point filteredWithSourcePoint(Point sourcePoint);
     virtual void didSetSource(TimeSeries::_sp ts);
     virtual bool canChangeToUnits(Units units);
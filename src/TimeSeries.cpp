@@ -18,6 +18,7 @@
 #include <boost/accumulators/statistics/tail_quantile.hpp>
 
 #include "TimeSeriesFilter.h"
+#include "RtxTrace.h"
 
 
 using namespace RTX;
@@ -27,6 +28,7 @@ using namespace std;
 
 
 TimeSeries::TimeSeries() {
+  _registeredVersion = 0;
   _name = "";
   _points.reset( new PointRecord() );
   setName("Time Series");
@@ -35,10 +37,12 @@ TimeSeries::TimeSeries() {
 }
 
 TimeSeries::TimeSeries(const std::string& name, const RTX::Units& units) {
+  _registeredVersion = 0;
   _name = name;
   _units = units;
   _points.reset( new PointRecord() );
   _points->registerAndGetIdentifierForSeriesWithUnits(name, units);
+  _handle = _points->handleForIdentifier(name);
   _valid = true;
 }
 
@@ -61,7 +65,9 @@ void TimeSeries::setValid(bool v) {
 
 void TimeSeries::setName(const std::string& name) {
   _name = name;
+  _registeredVersion = 0;
   _points->registerAndGetIdentifierForSeriesWithUnits(name, this->units());
+  _handle = _points->handleForIdentifier(name);
 }
 
 std::string TimeSeries::name() {
@@ -78,11 +84,11 @@ void TimeSeries::setUserDescription(const std::string& desc) {
 }
 
 void TimeSeries::insert(Point thisPoint) {
-  _points->addPoint(name(), thisPoint);
+  _points->addPoint(_handle, thisPoint);
 }
 
-void TimeSeries::insertPoints(std::vector<Point> points) {
-  _points->addPoints(name(), points);
+void TimeSeries::insertPoints(const std::vector<Point>& points) {
+  _points->addPoints(_handle, points);
 }
 
 Point TimeSeries::point(time_t time) {
@@ -110,11 +116,27 @@ std::vector< Point > TimeSeries::points(TimeRange range) {
     return points;
   }
   
-  if (!this->record()->exists(this->name(), this->units())) {
-    this->record()->registerAndGetIdentifierForSeriesWithUnits(this->name(), this->units());
+  RtxTrace::Span span("record");
+  if (span.active()) {
+    span.setName(RtxTrace::typeName(typeid(*this->record())));
+    span.setSeries(this->name());
+    span.arg("start", range.start);
+    span.arg("end", range.end);
   }
   
-  points = this->record()->pointsInRange(this->name(), range);
+  PointRecord::_sp record = this->record();
+  if (_registeredVersion.load() != record->catalogVersion()) {
+    // the record's catalog changed since we last looked, so make sure we're still in it.
+    if (!record->exists(this->name(), this->units())) {
+      record->registerAndGetIdentifierForSeriesWithUnits(this->name(), this->units());
+    }
+    _registeredVersion = record->catalogVersion();
+  }
+  
+  points = record->pointsInRange(_handle, range);
+  if (span.active()) {
+    span.setPointsOut(points.size());
+  }
   return points;
 }
 
@@ -147,28 +169,28 @@ Point TimeSeries::pointBefore(time_t time) {
   if (time == 0) {
     return Point();
   }
-  return this->record()->pointBefore(this->name(), time);
+  return this->record()->pointBefore(_handle, time);
 }
 
 Point TimeSeries::pointAfter(time_t time) {
   if (time == 0) {
     return Point();
   }
-  return this->record()->pointAfter(this->name(), time);
+  return this->record()->pointAfter(_handle, time);
 }
 
 Point TimeSeries::pointBefore(time_t time, WhereClause q) {
   if (time == 0) {
     return Point();
   }
-  return this->record()->pointBefore(this->name(), time, q);
+  return this->record()->pointBefore(_handle, time, q);
 }
 
 Point TimeSeries::pointAfter(time_t time, WhereClause q) {
   if (time == 0) {
     return Point();
   }
-  return this->record()->pointAfter(this->name(), time, q);
+  return this->record()->pointAfter(_handle, time, q);
 }
 
 Point TimeSeries::pointAtOrBefore(time_t time) {
@@ -185,26 +207,48 @@ void TimeSeries::setRecord(PointRecord::_sp record) {
     PointRecord::_sp pr( new PointRecord() );
     record = pr;
   }
+  if (record == _points && _registeredVersion.load() == record->catalogVersion()) {
+    return; // already registered there, and nothing has changed since
+  }
   if (record->registerAndGetIdentifierForSeriesWithUnits(this->name(),this->units())) {
     _points = record;
+    _handle = _points->handleForIdentifier(this->name());
+    _registeredVersion = 0;
   }
   return;
 }
 
+void TimeSeries::setRecordForSeries(const std::vector<TimeSeries::_sp>& series, PointRecord::_sp record) {
+  if (record) {
+    // bulk registration first, so that each setRecord below finds its series already there.
+    vector<pair<string,Units> > idUnits;
+    idUnits.reserve(series.size());
+    for (auto ts : series) {
+      idUnits.push_back(make_pair(ts->name(), ts->units()));
+    }
+    record->registerAndGetIdentifiersForSeriesWithUnits(idUnits);
+  }
+  for (auto ts : series) {
+    ts->setRecord(record);
+  }
+}
+
 PointRecord::_sp TimeSeries::record() {
   return _points;
 }
 
 void TimeSeries::resetCache() {
-  _points->reset(name());
+  _points->reset(_handle);
 }
 
 void TimeSeries::invalidate() {
   if(_points) {
+    _registeredVersion = 0;
     _points->invalidate(this->name());
     if (!_points->registerAndGetIdentifierForSeriesWithUnits(this->name(), this->units())) {
       PointRecord::_sp pr( new PointRecord() );
       _points = pr;
+      _handle = _points->handleForIdentifier(this->name());
     }
   }
 }
@@ -220,6 +264,7 @@ void TimeSeries::setUnits(Units newUnits) {
         shouldInvalidate = false;
       }
       _units = newUnits;
+      _registeredVersion = 0;
       if (shouldInvalidate) {
         this->invalidate();
       }
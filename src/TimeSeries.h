@@ -71,7 +71,7 @@ namespace RTX {
     virtual void setClock(Clock::_sp clock) { };
     
     virtual void insert(Point aPoint);
-    virtual void insertPoints(std::vector<Point>);  /// option to add lots of (un)ordered points all at once.
+    virtual void insertPoints(const std::vector<Point>& points);  /// option to add lots of (un)ordered points all at once.
     
     virtual Point point(time_t time);
     virtual Point pointBefore(time_t time);
@@ -94,6 +94,7 @@ namespace RTX {
     
     virtual PointRecord::_sp record();
     virtual void setRecord(PointRecord::_sp record);
+    static void setRecordForSeries(const std::vector<TimeSeries::_sp>& series, PointRecord::_sp record); /// registers all of them with the record at once
     
     Units units();
     virtual void setUnits(Units newUnits);
@@ -137,6 +138,8 @@ namespace RTX {
     
   private:
     PointRecord::_sp _points;
+    PointRecord::SeriesHandle _handle; // interned by _points, for _name
+    boost::atomic<uint64_t> _registeredVersion; // _points->catalogVersion() when this series was last known to be registered; 0 if unknown
     std::string _name, _userDescription;
     Units _units;
     std::pair<time_t, time_t> _validTimeRange;
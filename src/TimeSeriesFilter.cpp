@@ -4,7 +4,11 @@
 //
 
 #include "TimeSeriesFilter.h"
+#include "RtxTrace.h"
+#include "RtxArena.h"
 #include <boost/foreach.hpp>
+#include <future>
+#include <thread>
 
 using namespace RTX;
 using namespace std;
@@ -14,6 +18,8 @@ const time_t _stride = 60*60*24; // 3-days
 
 TimeSeriesFilter::TimeSeriesFilter() {
   _resampleMode = ResampleModeLinear;
+  _partitionDuration = 0;
+  _partitionThreads = 0;
 }
 
 Clock::_sp TimeSeriesFilter::clock() {
@@ -78,6 +84,14 @@ bool TimeSeriesFilter::hasUpstreamSeries(TimeSeries::_sp ts) {
 
 vector<Point> TimeSeriesFilter::points(TimeRange range) {
   
+  RtxTrace::Span span("filter");
+  if (span.active()) {
+    span.setName(RtxTrace::typeName(typeid(*this)));
+    span.setSeries(this->name());
+    span.arg("start", range.start);
+    span.arg("end", range.end);
+  }
+  
   PointCollection cached;
   set<time_t> pointTimes;
   auto canDrop = this->canDropPoints();
@@ -100,7 +114,7 @@ vector<Point> TimeSeriesFilter::points(TimeRange range) {
     // of making a round trip. If the cache is complete, then we have wasted some time
     // although doing a fetch is the only way to know for sure...
     // but if the cache is not complete, then we will have saved time by fetching here.
-    outCollection = this->filterPointsInRange(range);
+    outCollection = this->filterPointsPartitioned(range);
     pointTimes = outCollection.times();
     didFetch = true;
   }
@@ -111,17 +125,123 @@ vector<Point> TimeSeriesFilter::points(TimeRange range) {
   // important optimization. if this range has already been constructed and cached, then don't recreate it.
   if (cached.times() == pointTimes) {
     // all time values are there, so the cache is valid and complete.
-    return cached.points();
+    if (span.active()) {
+      span.arg("cache", "hit");
+      span.setPointsOut(cached.count());
+    }
+    return cached.takePoints();
   }
   else if (!didFetch) {
     // expensive lookup needed.
     // otherwise we've already hit the stack.
-    outCollection = this->filterPointsInRange(range);
+    outCollection = this->filterPointsPartitioned(range);
   }
   
-  this->insertPoints(outCollection.points());
+  this->insertPoints(outCollection.pointsRef());
   outCollection = outCollection.trimmedToRange(range); // safeguard if filter doesn't respected the range
-  return outCollection.points();
+  if (span.active()) {
+    span.arg("cache", "miss");
+    span.setPointsOut(outCollection.count());
+  }
+  return outCollection.takePoints();
+}
+
+
+void TimeSeriesFilter::setPartitioning(time_t chunkDuration, unsigned int maxThreads) {
+  _partitionDuration = (chunkDuration > 0) ? chunkDuration : 0;
+  _partitionThreads = maxThreads;
+}
+
+time_t TimeSeriesFilter::partitionDuration() {
+  return _partitionDuration;
+}
+
+TimeSeriesFilter::Reach TimeSeriesFilter::reach() {
+  Reach r;
+  r.resampleNeighbors = this->willResample();
+  return r;
+}
+
+vector<TimeSeries::_sp> TimeSeriesFilter::inputs() {
+  vector<TimeSeries::_sp> in;
+  if (this->source()) {
+    in.push_back(this->source());
+  }
+  return in;
+}
+
+TimeRange TimeSeriesFilter::inputRange(TimeSeries::_sp input, TimeRange range) {
+  Reach r = this->reach();
+  TimeRange q(range.start - r.offset - r.lookBehind, range.end - r.offset + r.lookAhead);
+  if (!input) {
+    return q;
+  }
+  
+  // each step stays put if there is no data out there.
+  auto stepBack = [&](time_t t) { time_t b = input->timeBefore(t); return (b != 0) ? b : t; };
+  auto stepFwd = [&](time_t t) { time_t a = input->timeAfter(t); return (a != 0) ? a : t; };
+  
+  if (r.resampleNeighbors) {
+    q.start = stepBack(q.start + 1);
+    q.end = stepFwd(q.end - 1);
+  }
+  for (int i = 0; i < r.pointsBehind; ++i) {
+    q.start = stepBack(q.start);
+  }
+  for (int i = 0; i < r.pointsAhead; ++i) {
+    q.end = stepFwd(q.end);
+  }
+  return q;
+}
+
+void TimeSeriesFilter::prefetchSources(TimeRange range) {
+  for (auto input : this->inputs()) {
+    input->points(this->inputRange(input, range));
+  }
+}
+
+PointCollection TimeSeriesFilter::filterPointsPartitioned(TimeRange range) {
+  if (_partitionDuration == 0 || range.duration() <= _partitionDuration) {
+    RtxArena::Scope scratch; // filter temporaries are released together when the query returns
+    return this->filterPointsInRange(range);
+  }
+  
+  // serial fetch of everything upstream, so the parallel chunks only read from cache.
+  this->prefetchSources(range);
+  
+  vector<TimeRange> chunks;
+  for (time_t start = range.start; start <= range.end; start += _partitionDuration) {
+    chunks.push_back(TimeRange(start, RTX_MIN(start + _partitionDuration - 1, range.end)));
+  }
+  
+  size_t nThreads = _partitionThreads;
+  if (nThreads == 0) {
+    nThreads = RTX_MAX(std::thread::hardware_concurrency(), (unsigned int)1);
+  }
+  
+  vector<Point> stitched;
+  for (size_t iChunk = 0; iChunk < chunks.size(); iChunk += nThreads) {
+    vector< future<PointCollection> > tasks;
+    size_t waveEnd = std::min(iChunk + nThreads, chunks.size());
+    for (size_t i = iChunk; i < waveEnd; ++i) {
+      TimeRange chunk = chunks.at(i);
+      tasks.push_back(async(launch::async, [this,chunk]() -> PointCollection {
+        RtxArena::Scope scratch;
+        PointCollection c = this->filterPointsInRange(chunk);
+        if (!(c.units == this->units())) {
+          c.convertToUnits(this->units());
+        }
+        // chunks are disjoint; drop anything a filter computed outside of its chunk.
+        return c.trimmedToRange(chunk);
+      }));
+    }
+    for (auto& task : tasks) {
+      PointCollection c = task.get();
+      stitched.insert(stitched.end(), c.pointsRef().begin(), c.pointsRef().end());
+    }
+  }
+  
+  return PointCollection(std::move(stitched), this->units());
 }
 
 
@@ -282,6 +402,41 @@ TimeRange TimeSeriesFilter::expandedRange(RTX::TimeRange r) {
 }
 
 
+TimeRange TimeSeriesFilter::downstreamRange(TimeRange sourceRange) {
+  // invert the reach: input at time t affects output in [t + offset - lookAhead, t + offset + lookBehind]
+  Reach r = this->reach();
+  TimeRange out(sourceRange.start + r.offset - r.lookAhead, sourceRange.end + r.offset + r.lookBehind);
+  TimeSeries::_sp src = this->source();
+  if (!src) {
+    return out;
+  }
+  
+  // reach back at least one source point: output times between that point and the new data
+  // may not have been computable before, and the overlap keeps the new output contiguous with the cache.
+  time_t start = sourceRange.start;
+  int nBack = std::max(r.pointsAhead, 1);
+  for (int i = 0; i < nBack; ++i) {
+    time_t prior = src->timeBefore(start);
+    if (prior == 0) {
+      break;
+    }
+    start = prior;
+  }
+  out.start = RTX_MIN(out.start, start + r.offset);
+  
+  time_t end = sourceRange.end;
+  for (int i = 0; i < r.pointsBehind; ++i) {
+    time_t next = src->timeAfter(end);
+    if (next == 0) {
+      break;
+    }
+    end = next;
+  }
+  out.end = RTX_MAX(out.end, end + r.offset);
+  return out;
+}
+
+
 PointCollection TimeSeriesFilter::filterPointsInRange(TimeRange range) {
   
   TimeRange queryRange = range;
@@ -57,7 +57,50 @@ namespace RTX {
    
    Overriding this method is optional. Base implementation enforces dimensonal consistency.
    */
+  /*!
+   \fn virtual TimeRange TimeSeriesFilter::downstreamRange(TimeRange sourceRange)
+   \brief The range of this filter's output that is affected when a source changes over sourceRange. Used for push-based evaluation.
+   \param sourceRange The time range of the new/changed source data.
+   \return The range over which this filter should be re-evaluated.
+   \sa TimeSeriesStream
+   
+   Overriding this method is optional. Base implementation inverts TimeSeriesFilter::reach, and always extends back to at least the previous source point so the new output overlaps what is already cached.
+   */
 
+  /*!
+   \fn void TimeSeriesFilter::setPartitioning(time_t chunkDuration, unsigned int maxThreads)
+   \brief Evaluate long queries as independent time chunks, in parallel.
+   \param chunkDuration Length (seconds) of each chunk. Zero disables partitioning (the default).
+   \param maxThreads Maximum number of chunks evaluated at once. Zero means one per hardware thread.
+   
+   Source data is fetched once, serially, over the whole range (see TimeSeriesFilter::inputRange), then TimeSeriesFilter::filterPointsInRange is run per chunk and the results are stitched together. Derived classes must not keep per-call state in filterPointsInRange for this to be safe.
+   */
+  /*!
+   \class TimeSeriesFilter::Reach
+   \brief Declares how much input data a filter needs around each output time.
+   
+   Output at time t is computed from input in [t - offset - lookBehind, t - offset + lookAhead], widened by pointsBehind/pointsAhead additional input points on either side. If resampleNeighbors is set, the input points at-or-before and at-or-after that range are needed too.
+   */
+  /*!
+   \fn virtual TimeSeriesFilter::Reach TimeSeriesFilter::reach()
+   \brief This filter's declared input reach. Used for planning queries (see QueryPlanner) and for partitioning.
+   
+   Overriding this method is optional. Base implementation only needs resample neighbors, and only if the filter will resample.
+   */
+  /*!
+   \fn virtual std::vector<TimeSeries::_sp> TimeSeriesFilter::inputs()
+   \brief Every series this filter reads from. Override if the filter has inputs other than source().
+   */
+  /*!
+   \fn virtual TimeRange TimeSeriesFilter::inputRange(TimeSeries::_sp input, TimeRange range)
+   \brief The exact range of an input needed to compute output over range.
+   
+   Base implementation applies TimeSeriesFilter::reach to the input. Only override for dependencies that cannot be expressed as a fixed reach.
+   */
+  /*!
+   \fn virtual void TimeSeriesFilter::prefetchSources(TimeRange range)
+   \brief Fetch (and thereby cache) all input data needed to compute output over range.
+   */
   
   
   class TimeSeriesFilter : public TimeSeries {
@@ -84,9 +127,26 @@ namespace RTX {
     
     virtual bool canDropPoints() { return false; };
     virtual TimeRange expandedRange(TimeRange r);
+    virtual TimeRange downstreamRange(TimeRange sourceRange);
     
     virtual TimeSeries::_sp rootTimeSeries();
     
+    void setPartitioning(time_t chunkDuration, unsigned int maxThreads = 0);
+    time_t partitionDuration();
+    
+    class Reach {
+    public:
+      Reach() : lookBehind(0), lookAhead(0), pointsBehind(0), pointsAhead(0), offset(0), resampleNeighbors(false) {};
+      time_t lookBehind, lookAhead;   /// seconds
+      int pointsBehind, pointsAhead;  /// input points, beyond the time reach
+      time_t offset;                  /// output time minus input time
+      bool resampleNeighbors;
+    };
+    virtual Reach reach();
+    virtual std::vector<TimeSeries::_sp> inputs();
+    virtual TimeRange inputRange(TimeSeries::_sp input, TimeRange range);
+    virtual void prefetchSources(TimeRange range);
+    
     // methods you must override to provide info to the base class
     virtual PointCollection filterPointsInRange(TimeRange range);
     
@@ -106,9 +166,13 @@ namespace RTX {
     TimeSeriesFilter::_sp source(TimeSeries::_sp source) {this->setSource(source); return share_me(this);};
     
   private:
+    PointCollection filterPointsPartitioned(TimeRange range);
+    
     TimeSeries::_sp _source;
     Clock::_sp _clock;
     ResampleMode _resampleMode;
+    time_t _partitionDuration;
+    unsigned int _partitionThreads;
     
     std::set<TimeSeriesFilter::_sp> _sinks;
     
@@ -12,8 +12,14 @@ using namespace RTX;
 
 void TimeSeriesFilterSecondary::setSecondary(TimeSeries::_sp secondary) {
   if (this->canSetSecondary(secondary)) {
+    if (_secondary) {
+      _secondary->filterDidRemoveSource(share_me(this));
+    }
     _secondary = secondary;
     this->didSetSecondary(secondary);
+    if (secondary) {
+      secondary->filterDidAddSource(share_me(this));
+    }
   }
 }
 
@@ -33,3 +39,11 @@ void TimeSeriesFilterSecondary::didSetSecondary(TimeSeries::_sp secondary) {
 bool TimeSeriesFilterSecondary::hasUpstreamSeries(TimeSeries::_sp other) {
   return TimeSeriesFilter::hasUpstreamSeries(other) || (this->secondary() && this->secondary()->hasUpstreamSeries(other));
 }
+
+std::vector<TimeSeries::_sp> TimeSeriesFilterSecondary::inputs() {
+  auto in = TimeSeriesFilter::inputs();
+  if (this->secondary()) {
+    in.push_back(this->secondary());
+  }
+  return in;
+}
@@ -24,6 +24,7 @@ namespace RTX {
     TimeSeriesFilterSecondary::_sp secondary(TimeSeries::_sp sec) {this->setSecondary(sec); return share_me(this);};
     
     virtual bool hasUpstreamSeries(TimeSeries::_sp other);
+    virtual std::vector<TimeSeries::_sp> inputs();
     
   protected:
     TimeSeries::_sp _secondary;
@@ -1,5 +1,6 @@
 #include "TimeSeriesLowess.h"
 #include "Lowess.h"
+#include "RtxArena.h"
 
 using namespace RTX;
 using namespace std;
@@ -52,7 +53,7 @@ PointCollection TimeSeriesLowess::filterPointsInRange(RTX::TimeRange range) {
     }
   }
   
-  PointCollection ret(outPoints, this->units());
+  PointCollection ret(std::move(outPoints), this->units());
   if (this->willResample()) {
     ret.resample(times);
   }
@@ -61,10 +62,14 @@ PointCollection TimeSeriesLowess::filterPointsInRange(RTX::TimeRange range) {
 
 
 double TimeSeriesLowess::valueFromSampleAtTime(PointCollection::pvRange r, time_t t) {
-  CppLowess::TemplatedLowess<vector<double>, double> lowess;
-  
-  vector<double> x;
-  vector<double> y;
+  // scratch for the smoother comes from the query's arena; this runs once per output time.
+  typedef RtxArena::vector<double> scratch_t;
+  CppLowess::TemplatedLowess<scratch_t, double> lowess;
+  
+  const size_t n = PointCollection::count(r);
+  scratch_t x, y;
+  x.reserve(n);
+  y.reserve(n);
   auto i = r.first;
   while (i != r.second) {
     x.push_back(static_cast<double>(i->time));
@@ -72,24 +77,24 @@ double TimeSeriesLowess::valueFromSampleAtTime(PointCollection::pvRange r, time_
     ++i;
   }
   
-  vector<double> out(x.size()), tmp1(x.size()), tmp2(x.size());
+  scratch_t out(x.size()), tmp1(x.size()), tmp2(x.size());
   
   lowess.lowess(x, y, this->fraction(), 2, 0.0, out, tmp1, tmp2);
   
-  vector<Point> outPoints;
-  for (int i=0; i < x.size(); ++i) {
-    outPoints.push_back(Point(static_cast<time_t>(x.at(i)),out.at(i)));
-  }
-  
-  
-  
-  PointCollection outC(outPoints,this->units());
-  
-  outC.resample({t});
-  
+  // linear resample of the smoothed sample at t
   Point p;
-  if (outC.count() > 0) { 
-    p = outC.points().front();
+  for (size_t j = 0; j < x.size(); ++j) {
+    time_t tj = static_cast<time_t>(x[j]);
+    if (tj == t) {
+      p = Point(tj, out[j]);
+      break;
+    }
+    if (tj > t) {
+      if (j > 0) {
+        p = Point::linearInterpolate(Point(static_cast<time_t>(x[j-1]), out[j-1]), Point(tj, out[j]), t);
+      }
+      break;
+    }
   }
   
   return p.value;
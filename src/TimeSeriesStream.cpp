@@ -0,0 +1,251 @@
+//
+//  TimeSeriesStream.cpp
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#include "TimeSeriesStream.h"
+
+#include <map>
+#include <algorithm>
+
+using namespace RTX;
+using namespace std;
+
+
+TimeSeriesStream::TimeSeriesStream(size_t maxQueuedBatches, size_t maxBatchPoints) {
+  _maxQueued = (maxQueuedBatches > 0) ? maxQueuedBatches : 1;
+  _maxBatchPoints = (maxBatchPoints > 0) ? maxBatchPoints : 1;
+  _shouldRun = false;
+  _isRunning = false;
+  _busy = false;
+}
+
+TimeSeriesStream::~TimeSeriesStream() {
+  this->stop();
+}
+
+void TimeSeriesStream::setEmitCallback(emitCallback_t fn) {
+  std::lock_guard<std::mutex> lock(_mtx);
+  _emit = fn;
+}
+
+
+#pragma mark - run state
+
+void TimeSeriesStream::start() {
+  std::lock_guard<std::mutex> lock(_mtx);
+  if (_isRunning) {
+    return;
+  }
+  _shouldRun = true;
+  _isRunning = true;
+  _worker = std::thread(&TimeSeriesStream::_runLoop, this);
+}
+
+void TimeSeriesStream::stop() {
+  {
+    std::lock_guard<std::mutex> lock(_mtx);
+    _shouldRun = false;
+  }
+  _queueChanged.notify_all();
+  if (_worker.joinable()) {
+    _worker.join();
+  }
+}
+
+bool TimeSeriesStream::isRunning() {
+  std::lock_guard<std::mutex> lock(_mtx);
+  return _isRunning;
+}
+
+size_t TimeSeriesStream::queuedBatches() {
+  std::lock_guard<std::mutex> lock(_mtx);
+  return _queue.size();
+}
+
+
+#pragma mark - queueing
+
+void TimeSeriesStream::push(TimeSeries::_sp root, std::vector<Point> points) {
+  if (!root || points.empty()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(_mtx);
+  // back-pressure. only wait if someone is actually draining the queue.
+  _queueChanged.wait(lock, [&]{ return _queue.size() < _maxQueued || !_isRunning; });
+  Batch b;
+  b.root = root;
+  b.points = std::move(points);
+  _queue.push_back(std::move(b));
+  lock.unlock();
+  _queueChanged.notify_all();
+}
+
+void TimeSeriesStream::flush() {
+  std::unique_lock<std::mutex> lock(_mtx);
+  if (_isRunning) {
+    _queueChanged.wait(lock, [&]{ return (_queue.empty() && !_busy) || !_isRunning; });
+    if (_isRunning) {
+      return;
+    }
+  }
+  lock.unlock();
+
+  // nobody is running, so do the work here.
+  while (true) {
+    vector<Batch> batches = this->_takeCoalesced();
+    if (batches.empty()) {
+      break;
+    }
+    for (const Batch& b : batches) {
+      this->_propagate(b);
+    }
+  }
+}
+
+vector<TimeSeriesStream::Batch> TimeSeriesStream::_takeCoalesced() {
+  vector<Batch> coalesced;
+  {
+    std::lock_guard<std::mutex> lock(_mtx);
+    // merge everything that has piled up, per root, up to the batch size.
+    map<TimeSeries::_sp, size_t> openBatch;
+    while (!_queue.empty()) {
+      Batch b = std::move(_queue.front());
+      _queue.pop_front();
+      auto found = openBatch.find(b.root);
+      if (found != openBatch.end() && coalesced[found->second].points.size() + b.points.size() <= _maxBatchPoints) {
+        auto& pv = coalesced[found->second].points;
+        pv.insert(pv.end(), b.points.begin(), b.points.end());
+      }
+      else {
+        openBatch[b.root] = coalesced.size();
+        coalesced.push_back(std::move(b));
+      }
+    }
+    _busy = !coalesced.empty();
+  }
+  _queueChanged.notify_all();
+  return coalesced;
+}
+
+void TimeSeriesStream::_runLoop() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(_mtx);
+      _busy = false;
+      _queueChanged.notify_all();
+      _queueChanged.wait(lock, [&]{ return !_queue.empty() || !_shouldRun; });
+      if (!_shouldRun) {
+        break;
+      }
+    }
+    for (const Batch& b : this->_takeCoalesced()) {
+      this->_propagate(b);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(_mtx);
+  _busy = false;
+  _isRunning = false;
+  _queueChanged.notify_all();
+}
+
+
+#pragma mark - propagation
+
+vector<TimeSeriesFilter::_sp> TimeSeriesStream::downstreamFilters(TimeSeries::_sp root) {
+  // reverse post-order depth-first traversal of the sink graph is a topological sort.
+  vector<TimeSeriesFilter::_sp> postOrder;
+  set<TimeSeries::_sp> visited;
+
+  function<void(TimeSeries::_sp)> visit = [&](TimeSeries::_sp ts) {
+    visited.insert(ts);
+    for (auto sink : ts->sinks()) {
+      if (visited.count(sink) == 0) {
+        visit(sink);
+      }
+    }
+    auto filter = dynamic_pointer_cast<TimeSeriesFilter>(ts);
+    if (filter && ts != root) {
+      postOrder.push_back(filter);
+    }
+  };
+
+  if (root) {
+    visit(root);
+  }
+
+  return vector<TimeSeriesFilter::_sp>(postOrder.rbegin(), postOrder.rend());
+}
+
+void TimeSeriesStream::_propagate(const Batch& batch) {
+  emitCallback_t emit;
+  {
+    std::lock_guard<std::mutex> lock(_mtx);
+    emit = _emit;
+  }
+
+  vector<Point> rootPoints = batch.points;
+  std::sort(rootPoints.begin(), rootPoints.end(), &Point::comparePointTime);
+  
+  // new points extend the live edge of the root. include the last known point in the insertion
+  // so that the record sees the new points as contiguous with what it already has.
+  vector<Point> insertion;
+  insertion.reserve(rootPoints.size() + 1);
+  Point edge = batch.root->record()->lastPoint(batch.root->name());
+  if (edge.isValid && edge.time < rootPoints.front().time) {
+    insertion.push_back(edge);
+  }
+  insertion.insert(insertion.end(), rootPoints.begin(), rootPoints.end());
+  batch.root->insertPoints(insertion);
+  this->_emitNew(emit, batch.root, rootPoints);
+
+  // affected output range for each series, accumulated from its already-evaluated inputs.
+  map<TimeSeries::_sp, TimeRange> dirty;
+
+  auto markSinks = [&](TimeSeries::_sp ts, TimeRange changed) {
+    for (auto sink : ts->sinks()) {
+      TimeRange r = sink->downstreamRange(changed);
+      auto found = dirty.find(sink);
+      if (found == dirty.end()) {
+        dirty[sink] = r;
+      }
+      else {
+        found->second.start = RTX_MIN(found->second.start, r.start);
+        found->second.end = RTX_MAX(found->second.end, r.end);
+      }
+    }
+  };
+
+  markSinks(batch.root, TimeRange(rootPoints.front().time, rootPoints.back().time));
+
+  for (auto filter : TimeSeriesStream::downstreamFilters(batch.root)) {
+    auto found = dirty.find(filter);
+    if (found == dirty.end() || !found->second.isValid()) {
+      continue; // nothing upstream of this filter produced output
+    }
+    vector<Point> out = filter->points(found->second);
+    if (out.empty()) {
+      continue;
+    }
+    this->_emitNew(emit, filter, out);
+    markSinks(filter, TimeRange(out.front().time, out.back().time));
+  }
+}
+
+void TimeSeriesStream::_emitNew(emitCallback_t& emit, TimeSeries::_sp ts, const std::vector<Point>& points) {
+  // evaluated ranges overlap the previous edge, so only pass along what is actually new.
+  auto found = _emittedThrough.find(ts);
+  time_t through = (found == _emittedThrough.end()) ? 0 : found->second;
+  auto newStart = std::upper_bound(points.begin(), points.end(), Point(through), &Point::comparePointTime);
+  if (newStart == points.end()) {
+    return;
+  }
+  _emittedThrough[ts] = points.back().time;
+  if (emit) {
+    emit(ts, vector<Point>(newStart, points.end()));
+  }
+}
@@ -0,0 +1,97 @@
+//
+//  TimeSeriesStream.h
+//  epanet-rtx
+//
+//  Open Water Analytics [wateranalytics.org]
+//  See README.md and license.txt for more information
+//
+
+#ifndef __epanet_rtx__TimeSeriesStream__
+#define __epanet_rtx__TimeSeriesStream__
+
+#include <stdio.h>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+
+#include "TimeSeries.h"
+#include "TimeSeriesFilter.h"
+
+namespace RTX {
+
+  /*!
+   \class TimeSeriesStream
+   \brief Push-based (event driven) evaluation of a filter graph.
+
+   The normal filter graph is pull-based: a query on a derived series recursively asks its sources for points. A TimeSeriesStream turns this around. Points pushed onto a root TimeSeries are inserted into that series, then every downstream filter (as registered through TimeSeries::sinks) is evaluated over just the affected range, in topological order, so each filter only ever sees fresh, already-cached upstream data.
+
+   Pushed batches are held in a bounded queue, and queued batches for the same root are coalesced before they are propagated. When the queue is full, TimeSeriesStream::push blocks until the worker catches up.
+   */
+
+  /*!
+   \fn void TimeSeriesStream::push(TimeSeries::_sp root, std::vector<Point> points)
+   \brief Queue new points for insertion into a root series and propagation downstream.
+   \param root The series to insert into. It need not be a true root, but only its sinks are evaluated.
+   \param points The new points.
+
+   Blocks if the stream already has its maximum number of batches queued.
+   */
+  /*!
+   \fn void TimeSeriesStream::flush()
+   \brief Block until every queued batch has been propagated.
+
+   If the stream is not running, the queue is processed on the calling thread.
+   */
+  /*!
+   \fn std::vector<TimeSeriesFilter::_sp> TimeSeriesStream::downstreamFilters(TimeSeries::_sp root)
+   \brief The filters that depend on a series, ordered so that every filter comes after all of its (downstream) inputs.
+   */
+
+  class TimeSeriesStream : public RTX_object {
+  public:
+    RTX_BASE_PROPS(TimeSeriesStream);
+    typedef std::function<void(TimeSeries::_sp series, const std::vector<Point>& points)> emitCallback_t;
+
+    TimeSeriesStream(size_t maxQueuedBatches = 64, size_t maxBatchPoints = 4096);
+    virtual ~TimeSeriesStream();
+
+    void setEmitCallback(emitCallback_t fn);
+
+    void start();  /// propagate on a background thread
+    void stop();   /// finish the current batch and stop. queued batches are retained.
+    bool isRunning();
+
+    void push(TimeSeries::_sp root, std::vector<Point> points);
+    void flush();
+    size_t queuedBatches();
+
+    static std::vector<TimeSeriesFilter::_sp> downstreamFilters(TimeSeries::_sp root);
+
+  private:
+    class Batch {
+    public:
+      TimeSeries::_sp root;
+      std::vector<Point> points;
+    };
+
+    void _runLoop();
+    std::vector<Batch> _takeCoalesced();
+    void _propagate(const Batch& batch);
+    void _emitNew(emitCallback_t& emit, TimeSeries::_sp ts, const std::vector<Point>& points);
+
+    std::deque<Batch> _queue;
+    size_t _maxQueued, _maxBatchPoints;
+    bool _shouldRun, _isRunning, _busy;
+    std::mutex _mtx;
+    std::condition_variable _queueChanged;
+    std::thread _worker;
+    emitCallback_t _emit;
+    std::map<TimeSeries::_sp, time_t> _emittedThrough; /// worker only
+
+  };
+}
+
+#endif /* defined(__epanet_rtx__TimeSeriesStream__) */
@@ -10,7 +10,11 @@
 #include <map>
 #include <string>
 #include <vector>
-#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
 #include "Units.h"
 #include "rtxMacros.h"
 
@@ -22,6 +26,89 @@ using namespace RTX;
 using namespace std;
 
 
+#pragma mark - interning
+
+namespace {
+  // parsed units and display strings are interned here. the set of distinct unit strings in any
+  // real database is small, so the tables stop growing at a fixed size rather than evicting.
+  const size_t _maxInterned = 4096;
+  mutex& _internMutex() {
+    static mutex m;
+    return m;
+  }
+  unordered_map<string, Units>& _internedUnits() {
+    static unordered_map<string, Units> interned;
+    return interned;
+  }
+  unordered_map<string, string>& _internedNames() {
+    static unordered_map<string, string> interned; // encoded units => display string
+    return interned;
+  }
+  
+  bool _isSeparator(char c) {
+    return c == '*' || c == '[' || c == ']' || c == '+';
+  }
+  
+  // parses the rawUnitString format, e.g. "0.3048*[m^1]" or "1*[K^1]+[offset=273.15]"
+  bool _parseRawUnits(const string& str, Units& out) {
+    const char *c = str.c_str(), *end = c + str.length();
+    const char *numEnd = c;
+    while (numEnd < end && !_isSeparator(*numEnd)) {
+      ++numEnd;
+    }
+    char *parsedEnd;
+    double conversion = strtod(c, &parsedEnd);
+    if (numEnd == c || parsedEnd != numEnd) {
+      return false;
+    }
+    int dims[7] = {0,0,0,0,0,0,0}; // kg, m, s, A, K, mol, cd
+    double offset = 0;
+    c = numEnd;
+    while (c < end) {
+      if (_isSeparator(*c)) {
+        ++c;
+        continue;
+      }
+      const char *tokEnd = c, *split = NULL;
+      while (tokEnd < end && !_isSeparator(*tokEnd)) {
+        if (!split && (*tokEnd == '^' || *tokEnd == '=')) {
+          split = tokEnd;
+        }
+        ++tokEnd;
+      }
+      if (split && split + 1 < tokEnd) {
+        const string dim(c, split);
+        const string val(split + 1, tokEnd);
+        if (RTX_STRINGS_ARE_EQUAL(dim, "offset")) {
+          offset = strtod(val.c_str(), NULL);
+        }
+        else {
+          int power = (int)strtol(val.c_str(), NULL, 10);
+          if (RTX_STRINGS_ARE_EQUAL(dim, "kilograms")      || RTX_STRINGS_ARE_EQUAL_CS(dim, "kg")) {
+            dims[0] = power;
+          } else if (RTX_STRINGS_ARE_EQUAL(dim, "meters")  || RTX_STRINGS_ARE_EQUAL_CS(dim, "m")) {
+            dims[1] = power;
+          } else if (RTX_STRINGS_ARE_EQUAL(dim, "seconds") || RTX_STRINGS_ARE_EQUAL_CS(dim, "s")) {
+            dims[2] = power;
+          } else if (RTX_STRINGS_ARE_EQUAL(dim, "ampere")  || RTX_STRINGS_ARE_EQUAL_CS(dim, "A")) {
+            dims[3] = power;
+          } else if (RTX_STRINGS_ARE_EQUAL(dim, "kelvin")  || RTX_STRINGS_ARE_EQUAL_CS(dim, "K")) {
+            dims[4] = power;
+          } else if (RTX_STRINGS_ARE_EQUAL(dim, "mole")    || RTX_STRINGS_ARE_EQUAL_CS(dim, "mol")) {
+            dims[5] = power;
+          } else if (RTX_STRINGS_ARE_EQUAL(dim, "candela") || RTX_STRINGS_ARE_EQUAL_CS(dim, "cd")) {
+            dims[6] = power;
+          }
+        }
+      }
+      c = tokEnd;
+    }
+    out = Units(conversion, dims[0], dims[1], dims[2], dims[3], dims[4], dims[5], dims[6], offset);
+    return true;
+  }
+}
+
+
 const std::map<std::string, Units> Units::unitStrings = {
   {"dimensionless", RTX_DIMENSIONLESS},
   {"Hz", RTX_HERTZ},
@@ -279,6 +366,26 @@ ostream& Units::toStream(ostream &stream) const {
 
 const string Units::to_string() const {
   
+  const string key = this->encode();
+  {
+    lock_guard<mutex> lock(_internMutex());
+    auto interned = _internedNames().find(key);
+    if (interned != _internedNames().end()) {
+      return interned->second;
+    }
+  }
+  const string name = this->_findUnitString();
+  {
+    lock_guard<mutex> lock(_internMutex());
+    if (_internedNames().size() < _maxInterned) {
+      _internedNames()[key] = name;
+    }
+  }
+  return name;
+}
+
+const string Units::_findUnitString() const {
+  
   auto it = Units::unitStrings.begin();
   
   while (it != Units::unitStrings.end()) {
@@ -326,21 +433,35 @@ double Units::convertValue(double value, const Units& fromUnits, const Units& to
 // factory for string input
 Units Units::unitOfType(const string& unitString) {
   
-  if (RTX_STRINGS_ARE_EQUAL(unitString, "")) {
+  if (unitString.empty()) {
     return RTX_NO_UNITS;
   }
   
-  double conversionFactor = 1;
-  int mass=0, length=0, time=0, current=0, temperature=0, amount=0, intensity=0;
-  double offset=0;
-  
-//  const map<string, Units> unitMap = Units::unitStrings;
   auto found = Units::unitStrings.find(unitString);
   if (found != Units::unitStrings.end()) {
     return found->second;
   }
   
+  {
+    lock_guard<mutex> lock(_internMutex());
+    auto interned = _internedUnits().find(unitString);
+    if (interned != _internedUnits().end()) {
+      return interned->second;
+    }
+  }
   
+  Units u = Units::_parseUnitString(unitString);
+  
+  {
+    lock_guard<mutex> lock(_internMutex());
+    if (_internedUnits().size() < _maxInterned) {
+      _internedUnits()[unitString] = u;
+    }
+  }
+  return u;
+}
+
+Units Units::_parseUnitString(const string& unitString) {
   
   // superscript?
   {
@@ -355,7 +476,7 @@ Units Units::unitOfType(const string& unitString) {
     }
     
     // try again
-    found = Units::unitStrings.find(uStr);
+    auto found = Units::unitStrings.find(uStr);
     if (found != Units::unitStrings.end()) {
       return found->second;
     }
@@ -372,65 +493,57 @@ Units Units::unitOfType(const string& unitString) {
   }
   
   
-  
   // attempt to deserialize the streamed format of the unit conversion and dimension.
-  deque<string> components;
-  boost::split(components, unitString, boost::is_any_of("*[]"), boost::algorithm::token_compress_on); // split on separators
-  
-  if (components.size() < 1) {
+  Units parsed;
+  if (!_parseRawUnits(unitString, parsed)) {
     cerr << "WARNING: Units not recognized: " << unitString << " - defaulting to NO UNITS." << endl;
     return RTX_NO_UNITS;
   }
-  
-  // first component will be the unit conversion, so cast that into a number.
-  // this may fail, so catch it if so.
-  try {
-    conversionFactor = boost::lexical_cast<double>(components.front());
-  } catch (...) {
-    cerr << "WARNING: Units not recognized: " << unitString << " - defaulting to NO UNITS." << endl;
-    return RTX_NO_UNITS;
+  return parsed;
+}
+
+
+#pragma mark - binary encoding
+
+// layout: conversion and offset as little-endian IEEE-754 doubles, then the seven exponents
+// (kg, m, s, A, K, mol, cd) as signed bytes.
+static void _putDouble(string& buf, double d) {
+  uint64_t bits;
+  memcpy(&bits, &d, sizeof(bits));
+  for (int i = 0; i < 8; ++i) {
+    buf.push_back((char)((bits >> (8*i)) & 0xFF));
   }
-  
-  components.pop_front();
-  
-  // get each dimensional power and set it.
-  for(const string& part : components) {
-    
-    vector<string> dimensionPower;
-    boost::split(dimensionPower, part, boost::is_any_of("^="));
-    if (dimensionPower.size() != 2) {
-      continue;
-    }
-    int power;
-    double offsetFromStr;
-    if (!boost::conversion::try_lexical_convert(dimensionPower.back(), power)) {
-      offsetFromStr = boost::lexical_cast<double>(dimensionPower.back());
-    }
-    dimensionPower.pop_back();
-    string dim = dimensionPower.back();
-    
-    // match the SI dimension name
-    if (RTX_STRINGS_ARE_EQUAL(dim, "kilograms")      || RTX_STRINGS_ARE_EQUAL_CS(dim, "kg")) {
-      mass = power;
-    } else if (RTX_STRINGS_ARE_EQUAL(dim, "meters")  || RTX_STRINGS_ARE_EQUAL_CS(dim, "m")) {
-      length = power;
-    } else if (RTX_STRINGS_ARE_EQUAL(dim, "seconds") || RTX_STRINGS_ARE_EQUAL_CS(dim, "s")) {
-      time = power;
-    } else if (RTX_STRINGS_ARE_EQUAL(dim, "ampere")  || RTX_STRINGS_ARE_EQUAL_CS(dim, "A")) {
-      current = power;
-    } else if (RTX_STRINGS_ARE_EQUAL(dim, "kelvin")  || RTX_STRINGS_ARE_EQUAL_CS(dim, "K")) {
-      temperature = power;
-    } else if (RTX_STRINGS_ARE_EQUAL(dim, "mole")    || RTX_STRINGS_ARE_EQUAL_CS(dim, "mol")) {
-      amount = power;
-    } else if (RTX_STRINGS_ARE_EQUAL(dim, "candela") || RTX_STRINGS_ARE_EQUAL_CS(dim, "cd")) {
-      intensity = power;
-    } else if (RTX_STRINGS_ARE_EQUAL(dim, "offset")) {
-      offset = offsetFromStr;
-    }
+}
+
+static double _getDouble(const unsigned char* p) {
+  uint64_t bits = 0;
+  for (int i = 0; i < 8; ++i) {
+    bits |= ((uint64_t)p[i]) << (8*i);
   }
-  
-  return Units(conversionFactor, mass, length, time, current, temperature, amount, intensity, offset);
-  
+  double d;
+  memcpy(&d, &bits, sizeof(d));
+  return d;
 }
 
+const string Units::encode() const {
+  string buf;
+  buf.reserve(Units::encodedSize);
+  _putDouble(buf, _conversion);
+  _putDouble(buf, _offset);
+  for (int e : {_kg, _m, _s, _A, _K, _mol, _cd}) {
+    buf.push_back((char)(int8_t)e);
+  }
+  return buf;
+}
 
+Units Units::decode(const std::string &encoded) {
+  if (encoded.size() != Units::encodedSize) {
+    cerr << "WARNING: encoded units have the wrong size (" << encoded.size() << ") - defaulting to NO UNITS." << endl;
+    return RTX_NO_UNITS;
+  }
+  const unsigned char* p = (const unsigned char*)encoded.data();
+  double conversion = _getDouble(p);
+  double offset = _getDouble(p + 8);
+  const signed char* e = (const signed char*)(p + 16);
+  return Units(conversion, e[0], e[1], e[2], e[3], e[4], e[5], e[6], offset);
+}
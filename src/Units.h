@@ -144,13 +144,20 @@ namespace RTX {
     const double conversion() const;
     const double offset() const;
     static double convertValue(double value, const Units& fromUnits, const Units& toUnits);
-    static Units unitOfType(const std::string& unitString);
+    static Units unitOfType(const std::string& unitString); /// parsed results are interned, so repeated lookups are cheap
     const std::string to_string() const;
     const std::string rawUnitString(bool ignoreZeroDimensions = true) const;
     
+    // compact, platform-independent binary form for storage
+    static const size_t encodedSize = 23;
+    const std::string encode() const;
+    static Units decode(const std::string& encoded);
+    
     virtual std::ostream& toStream(std::ostream &stream) const;
     
   private:
+    static Units _parseUnitString(const std::string& unitString);
+    const std::string _findUnitString() const;
     int _m;
     int _kg;
     int _s;
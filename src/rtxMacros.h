@@ -49,7 +49,9 @@ namespace RTX {
 #define RTX_BUFFER_DEFAULT_CACHESIZE 100
 #endif
 
-#define DEBUG 1
+// library logging goes through RtxLog (RTX_LOG_DEBUG etc). DebugLog is kept for outside code:
+// define DEBUG to have it write to std::cout.
+#include "RtxLog.h"
 #ifdef DEBUG
 #define DebugLog std::cout
 #else
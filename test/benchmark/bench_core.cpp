@@ -0,0 +1,345 @@
+#include "bench_main.h"
+
+#include <random>
+#include <cmath>
+
+#include "PointCollection.h"
+#include "BufferPointRecord.h"
+#include "TimeSeries.h"
+#include "Clock.h"
+#include "Units.h"
+
+#include "AggregatorTimeSeries.h"
+#include "CorrelatorTimeSeries.h"
+#include "CurveFunction.h"
+#include "ExpressionTimeSeries.h"
+#include "FailoverTimeSeries.h"
+#include "FirstDerivative.h"
+#include "GainTimeSeries.h"
+#include "IntegratorTimeSeries.h"
+#include "InversionTimeSeries.h"
+#include "LagTimeSeries.h"
+#include "MathOpsTimeSeries.h"
+#include "MetaTimeSeries.h"
+#include "MovingAverage.h"
+#include "MultiplierTimeSeries.h"
+#include "OffsetTimeSeries.h"
+#include "OutlierExclusionTimeSeries.h"
+#include "StatsTimeSeries.h"
+#include "ThresholdTimeSeries.h"
+#include "TimeSeriesLowess.h"
+#include "ValidRangeTimeSeries.h"
+
+using namespace RTX;
+using namespace RTX::bench;
+using namespace std;
+
+/*
+ core engine benchmarks. the size argument is the number of points in each synthetic series.
+ series density is set with:
+   --period=<seconds>   nominal spacing of points (default 60)
+   --jitter=<0..1>      random variation of the spacing, as a fraction of the period (default 0: regular)
+ */
+
+#define BENCH_SIZES 1000, 10000, 100000
+
+static const time_t _benchStart = 1499990400; // midnight UTC, so daily clocks line up with the first point
+
+static vector<Point> _syntheticPoints(int64_t n, unsigned int seed = 1) {
+  const double period = std::max(1., option("period", 60.));
+  const double jitter = std::min(std::max(option("jitter", 0.), 0.), 1.);
+  mt19937 gen(seed);
+  uniform_real_distribution<double> u(-0.5, 0.5);
+  vector<Point> points;
+  points.reserve((size_t)n);
+  time_t t = _benchStart;
+  for (int64_t i = 0; i < n; ++i) {
+    double value = 10. + 5. * sin(2. * M_PI * (double)(t - _benchStart) / 86400.) + u(gen);
+    points.push_back(Point(t, value));
+    t += std::max((time_t)1, (time_t)llround(period * (1. + jitter * 2. * u(gen))));
+  }
+  return points;
+}
+
+static TimeSeries::_sp _syntheticSeries(int64_t n, const string& name, unsigned int seed = 1) {
+  BufferPointRecord::_sp record(new BufferPointRecord((int)n));
+  TimeSeries::_sp ts(new TimeSeries);
+  ts->setName(name);
+  ts->setUnits(RTX_FOOT);
+  ts->setRecord(record);
+  ts->insertPoints(_syntheticPoints(n, seed));
+  return ts;
+}
+
+static TimeRange _fullRange(const vector<Point>& points) {
+  return TimeRange(points.front().time, points.back().time);
+}
+
+
+#pragma mark - PointCollection
+
+static void PointCollection_resample(State& state) {
+  vector<Point> points = _syntheticPoints(state.arg());
+  PointCollection pc(points, RTX_FOOT);
+  // resample onto times that fall between the original ones
+  set<time_t> times;
+  for (size_t i = 1; i < points.size(); ++i) {
+    times.insert(points[i-1].time + (points[i].time - points[i-1].time) / 2);
+  }
+  while (state.keepRunning()) {
+    PointCollection r = pc.resampledAtTimes(times, ResampleModeLinear);
+    if (r.count() == 0) {
+      state.skip("resample produced no points");
+    }
+  }
+  state.setItemsProcessed((int64_t)times.size());
+}
+RTX_BENCHMARK(PointCollection_resample, BENCH_SIZES)
+
+static void PointCollection_stats(State& state) {
+  PointCollection pc(_syntheticPoints(state.arg()), RTX_FOOT);
+  double sink = 0;
+  while (state.keepRunning()) {
+    auto raw = pc.raw();
+    sink += PointCollection::mean(raw);
+    sink += PointCollection::variance(raw);
+    sink += PointCollection::min(raw);
+    sink += PointCollection::max(raw);
+    sink += PointCollection::percentile(0.9, raw);
+  }
+  state.setItemsProcessed(state.arg());
+  state.setCounter("checksum", sink / std::max((int64_t)1, state.iterations()));
+}
+RTX_BENCHMARK(PointCollection_stats, BENCH_SIZES)
+
+
+#pragma mark - BufferPointRecord
+
+static void BufferPointRecord_insert(State& state) {
+  vector<Point> points = _syntheticPoints(state.arg());
+  while (state.keepRunning()) {
+    BufferPointRecord record((int)state.arg());
+    record.registerAndGetIdentifierForSeriesWithUnits("bench", RTX_FOOT);
+    record.addPoints("bench", points);
+  }
+  state.setItemsProcessed(state.arg());
+}
+RTX_BENCHMARK(BufferPointRecord_insert, BENCH_SIZES)
+
+static void BufferPointRecord_range(State& state) {
+  vector<Point> points = _syntheticPoints(state.arg());
+  BufferPointRecord record((int)state.arg());
+  record.registerAndGetIdentifierForSeriesWithUnits("bench", RTX_FOOT);
+  record.addPoints("bench", points);
+  TimeRange range = _fullRange(points);
+  while (state.keepRunning()) {
+    vector<Point> found = record.pointsInRange("bench", range);
+    if (found.size() != points.size()) {
+      state.skip("record did not return every point");
+    }
+  }
+  state.setItemsProcessed(state.arg());
+}
+RTX_BENCHMARK(BufferPointRecord_range, BENCH_SIZES)
+
+static void BufferPointRecord_pointBefore(State& state) {
+  const int lookups = 1000;
+  vector<Point> points = _syntheticPoints(state.arg());
+  BufferPointRecord record((int)state.arg());
+  record.registerAndGetIdentifierForSeriesWithUnits("bench", RTX_FOOT);
+  record.addPoints("bench", points);
+  mt19937 gen(2);
+  uniform_int_distribution<time_t> pick(points.front().time + 1, points.back().time);
+  vector<time_t> times;
+  for (int i = 0; i < lookups; ++i) {
+    times.push_back(pick(gen));
+  }
+  while (state.keepRunning()) {
+    for (time_t t : times) {
+      if (!record.pointBefore("bench", t).isValid) {
+        state.skip("pointBefore missed");
+      }
+    }
+  }
+  state.setItemsProcessed(lookups);
+}
+RTX_BENCHMARK(BufferPointRecord_pointBefore, BENCH_SIZES)
+
+
+#pragma mark - filters
+
+// each filter is built on top of a synthetic source (and, where it needs one, a second input)
+// and asked for its whole range, with its cache cleared before every pass.
+// (LogicTimeSeries is declared but has no implementation yet, so it is not covered.)
+typedef function<TimeSeriesFilter::_sp(TimeSeries::_sp source, TimeSeries::_sp other)> filter_factory;
+
+static void _filterBenchmark(State& state, filter_factory make) {
+  TimeSeries::_sp source = _syntheticSeries(state.arg(), "source", 1);
+  TimeSeries::_sp other = _syntheticSeries(state.arg(), "other", 2);
+  TimeSeriesFilter::_sp filter = make(source, other);
+  if (!filter || !filter->source()) {
+    state.skip("filter could not be configured");
+    return;
+  }
+  TimeRange range = source->record()->range(source->name());
+  size_t nOut = 0;
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    filter->resetCache();
+    state.resumeTiming();
+    nOut = filter->points(range).size();
+  }
+  state.setItemsProcessed(state.arg());
+  state.setCounter("points_out", (double)nOut);
+}
+
+static bool _registerFilterBenchmarks() {
+  Clock::_sp m15(new Clock(15*60));
+  Clock::_sp h1(new Clock(60*60));
+  Clock::_sp d1(new Clock(24*60*60));
+
+  map<string, filter_factory> filters = {
+    {"TimeSeriesFilter", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      return static_pointer_cast<TimeSeriesFilter>(s->append(new TimeSeriesFilter)->c(m15));
+    }},
+    {"AggregatorTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      AggregatorTimeSeries::_sp a(new AggregatorTimeSeries);
+      a->setUnits(RTX_FOOT);
+      a->addSource(s, 1.);
+      a->addSource(o, -1.);
+      return a;
+    }},
+    {"CorrelatorTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      CorrelatorTimeSeries::_sp c(new CorrelatorTimeSeries);
+      c->setSource(s);
+      c->setSecondary(o);
+      c->setCorrelationWindow(h1);
+      c->setClock(h1);
+      return c;
+    }},
+    {"CurveFunction", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      Curve::_sp curve(new Curve);
+      curve->inputUnits = RTX_FOOT;
+      curve->outputUnits = RTX_CUBIC_FOOT;
+      for (int i = 0; i <= 20; ++i) {
+        curve->curveData[i] = 100. * i * i;
+      }
+      CurveFunction::_sp f(new CurveFunction);
+      f->setCurve(curve);
+      f->setUnits(RTX_CUBIC_FOOT);
+      f->setSource(s);
+      return f;
+    }},
+    {"ExpressionTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      ExpressionTimeSeries::_sp e(new ExpressionTimeSeries);
+      e->setVariable("a", s);
+      e->setVariable("b", o);
+      e->setExpression("0.5 * (a + b) + abs(a - b)");
+      return e;
+    }},
+    {"FailoverTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      FailoverTimeSeries::_sp f(new FailoverTimeSeries);
+      f->setSource(s);
+      f->setSecondary(o);
+      f->setMaximumStaleness(3600);
+      return f;
+    }},
+    {"FirstDerivative", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      return static_pointer_cast<TimeSeriesFilter>(s->append(new FirstDerivative));
+    }},
+    {"GainTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      return static_pointer_cast<TimeSeriesFilter>(s->append(new GainTimeSeries)->gain(2.5));
+    }},
+    {"IntegratorTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      return static_pointer_cast<TimeSeriesFilter>(s->append(new IntegratorTimeSeries)->resetClock(d1));
+    }},
+    {"InversionTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      return static_pointer_cast<TimeSeriesFilter>(s->append(new InversionTimeSeries));
+    }},
+    {"LagTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      return static_pointer_cast<TimeSeriesFilter>(s->append(new LagTimeSeries)->lag(3600));
+    }},
+    {"MathOpsTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      return static_pointer_cast<TimeSeriesFilter>(s->append(new MathOpsTimeSeries)->type(MathOpsTimeSeries::MathOpsTimeSeriesPow)->arg(2));
+    }},
+    {"MetaTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      return static_pointer_cast<TimeSeriesFilter>(s->append(new MetaTimeSeries)->mode(MetaTimeSeries::MetaModeGap)->units(RTX_SECOND));
+    }},
+    {"MovingAverage", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      return static_pointer_cast<TimeSeriesFilter>(s->append(new MovingAverage)->window(15));
+    }},
+    {"MultiplierTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      return static_pointer_cast<TimeSeriesFilter>(s->append(new MultiplierTimeSeries)->secondary(o));
+    }},
+    {"OffsetTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      return static_pointer_cast<TimeSeriesFilter>(s->append(new OffsetTimeSeries)->offset(1.5));
+    }},
+    {"OutlierExclusionTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      return static_pointer_cast<TimeSeriesFilter>(s->append(new OutlierExclusionTimeSeries)->multiplier(1.5)->window(h1)->c(m15));
+    }},
+    {"StatsTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      return static_pointer_cast<TimeSeriesFilter>(s->append(new StatsTimeSeries)->type(StatsTimeSeries::StatsTimeSeriesMean)->window(h1)->c(m15));
+    }},
+    {"ThresholdTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      return static_pointer_cast<TimeSeriesFilter>(s->append(new ThresholdTimeSeries)->threshold(10));
+    }},
+    {"TimeSeriesLowess", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      TimeSeriesLowess::_sp l(new TimeSeriesLowess);
+      l->setFraction(0.5);
+      l->setSource(s);
+      l->setWindow(h1);
+      l->setClock(m15);
+      return l;
+    }},
+    {"ValidRangeTimeSeries", [=](TimeSeries::_sp s, TimeSeries::_sp o) -> TimeSeriesFilter::_sp {
+      return static_pointer_cast<TimeSeriesFilter>(s->append(new ValidRangeTimeSeries)->range(6, 14)->mode(ValidRangeTimeSeries::drop));
+    }}
+  };
+
+  for (auto& f : filters) {
+    filter_factory make = f.second;
+    registerBenchmark("filter/" + f.first, [make](State& state) { _filterBenchmark(state, make); }, {BENCH_SIZES});
+  }
+  return true;
+}
+static bool _filterBenchmarksRegistered = _registerFilterBenchmarks();
+
+
+#pragma mark - Units
+
+static void Units_convert(State& state) {
+  vector<Point> points = _syntheticPoints(state.arg());
+  double sink = 0;
+  while (state.keepRunning()) {
+    for (const Point& p : points) {
+      sink += Units::convertValue(p.value, RTX_GALLON_PER_MINUTE, RTX_MILLION_GALLON_PER_DAY);
+    }
+  }
+  state.setItemsProcessed(state.arg());
+  state.setCounter("checksum", sink / std::max((int64_t)1, state.iterations()));
+}
+RTX_BENCHMARK(Units_convert, BENCH_SIZES)
+
+static void Units_collectionConvert(State& state) {
+  PointCollection pc(_syntheticPoints(state.arg()), RTX_DEGREE_CELSIUS);
+  while (state.keepRunning()) {
+    pc.convertToUnits(RTX_DEGREE_FARENHEIT);
+    pc.convertToUnits(RTX_DEGREE_CELSIUS);
+  }
+  state.setItemsProcessed(2 * state.arg());
+}
+RTX_BENCHMARK(Units_collectionConvert, BENCH_SIZES)
+
+static void Units_parse(State& state) {
+  // the mix a database catalog load sees: named, superscript-free and raw strings
+  const vector<string> strings = {"ft", "psi", "gpm", "MGD", "ft3", "m3/hr", "0.3048*[m^1]", "1*[K^1]+[offset=273.15]", "5.5*[kg^1]*[m^-3]"};
+  size_t n = 0;
+  while (state.keepRunning()) {
+    for (const string& s : strings) {
+      n += Units::unitOfType(s).to_string().size();
+    }
+  }
+  state.setItemsProcessed((int64_t)strings.size());
+  state.setCounter("chars", (double)n / std::max((int64_t)1, state.iterations()));
+}
+RTX_BENCHMARK(Units_parse)
@@ -0,0 +1,469 @@
+#include "bench_main.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+using namespace RTX::bench;
+using namespace std;
+
+/*
+ usage: rtx-benchmark [--filter=<substring>] [--min-time=<seconds>] [--repetitions=<n>]
+                      [--format=console|json|csv] [--out=<file>] [--list] [--<key>=<value> ...]
+
+ --out writes the results as json (or csv, if the file name ends in .csv) in addition to what
+ is printed. the json layout follows google-benchmark's, so its comparison tools can read it.
+ */
+
+#pragma mark - state
+
+State::State(int64_t arg, double minSeconds) : _arg(arg), _iterations(0), _items(0), _minSeconds(minSeconds), _real(0), _cpu(0), _started(false), _paused(false) {
+
+}
+
+int64_t State::arg() const {
+  return _arg;
+}
+
+bool State::keepRunning() {
+  if (!_skipped.empty()) {
+    return false;
+  }
+  if (!_started) {
+    _started = true;
+    this->resumeTiming();
+    return true;
+  }
+  ++_iterations;
+  double soFar = _real;
+  if (!_paused) {
+    soFar += chrono::duration<double>(clock_t::now() - _realStart).count();
+  }
+  if (soFar < _minSeconds) {
+    return true;
+  }
+  this->pauseTiming();
+  return false;
+}
+
+void State::pauseTiming() {
+  if (_paused || !_started) {
+    return;
+  }
+  _real += chrono::duration<double>(clock_t::now() - _realStart).count();
+  _cpu += (double)(std::clock() - _cpuStart) / CLOCKS_PER_SEC;
+  _paused = true;
+}
+
+void State::resumeTiming() {
+  _realStart = clock_t::now();
+  _cpuStart = std::clock();
+  _paused = false;
+}
+
+void State::setItemsProcessed(int64_t itemsPerIteration) {
+  _items = itemsPerIteration;
+}
+
+void State::setCounter(const std::string &name, double value) {
+  _counters[name] = value;
+}
+
+void State::setLabel(const std::string &label) {
+  _label = label;
+}
+
+void State::skip(const std::string &reason) {
+  _skipped = reason;
+}
+
+int64_t State::iterations() const {
+  return _iterations;
+}
+double State::realSeconds() const {
+  return _real;
+}
+double State::cpuSeconds() const {
+  return _cpu;
+}
+int64_t State::itemsPerIteration() const {
+  return _items;
+}
+const map<string, double>& State::counters() const {
+  return _counters;
+}
+const string& State::label() const {
+  return _label;
+}
+const string& State::skipped() const {
+  return _skipped;
+}
+
+
+#pragma mark - registry
+
+namespace {
+  class Registered {
+  public:
+    string name;
+    benchmark_fn fn;
+    vector<int64_t> args;
+  };
+
+  class Result {
+  public:
+    string name, runName, aggregate, label, skipped;
+    int repetition;
+    int64_t iterations;
+    double realNs, cpuNs, itemsPerSecond;
+    map<string, double> counters;
+  };
+
+  vector<Registered>& _registry() {
+    static vector<Registered> r;
+    return r;
+  }
+
+  map<string, string>& _options() {
+    static map<string, string> o;
+    return o;
+  }
+
+  string _jsonEscape(const string& s) {
+    string out;
+    out.reserve(s.size() + 2);
+    for (char c : s) {
+      switch (c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        default:
+          if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+          }
+          else {
+            out += c;
+          }
+      }
+    }
+    return out;
+  }
+
+  string _jsonNumber(double v) {
+    if (!std::isfinite(v)) {
+      return "null";
+    }
+    stringstream ss;
+    ss << setprecision(10) << v;
+    return ss.str();
+  }
+
+  vector<string> _counterNames(const vector<Result>& results) {
+    vector<string> names;
+    for (auto& r : results) {
+      for (auto& c : r.counters) {
+        if (find(names.begin(), names.end(), c.first) == names.end()) {
+          names.push_back(c.first);
+        }
+      }
+    }
+    return names;
+  }
+
+  void _writeJson(ostream& out, const vector<Result>& results, const string& executable) {
+    time_t now = time(NULL);
+    char date[64];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    out << "{\n  \"context\": {\n";
+    out << "    \"date\": \"" << date << "\",\n";
+    out << "    \"executable\": \"" << _jsonEscape(executable) << "\",\n";
+    out << "    \"num_cpus\": " << thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+    out << "    \"library_build_type\": \"release\",\n";
+#else
+    out << "    \"library_build_type\": \"debug\",\n";
+#endif
+    out << "    \"options\": {";
+    bool first = true;
+    for (auto& o : _options()) {
+      out << (first ? "" : ", ") << "\"" << _jsonEscape(o.first) << "\": \"" << _jsonEscape(o.second) << "\"";
+      first = false;
+    }
+    out << "}\n  },\n  \"benchmarks\": [";
+    first = true;
+    for (auto& r : results) {
+      out << (first ? "\n" : ",\n") << "    {";
+      first = false;
+      out << "\"name\": \"" << _jsonEscape(r.name) << "\", ";
+      out << "\"run_name\": \"" << _jsonEscape(r.runName) << "\", ";
+      out << "\"run_type\": \"" << (r.aggregate.empty() ? "iteration" : "aggregate") << "\", ";
+      if (!r.aggregate.empty()) {
+        out << "\"aggregate_name\": \"" << r.aggregate << "\", ";
+      }
+      out << "\"repetition_index\": " << r.repetition << ", ";
+      if (!r.skipped.empty()) {
+        out << "\"error_occurred\": true, \"error_message\": \"" << _jsonEscape(r.skipped) << "\"}";
+        continue;
+      }
+      out << "\"iterations\": " << r.iterations << ", ";
+      out << "\"real_time\": " << _jsonNumber(r.realNs) << ", ";
+      out << "\"cpu_time\": " << _jsonNumber(r.cpuNs) << ", ";
+      out << "\"time_unit\": \"ns\"";
+      if (r.itemsPerSecond > 0) {
+        out << ", \"items_per_second\": " << _jsonNumber(r.itemsPerSecond);
+      }
+      for (auto& c : r.counters) {
+        out << ", \"" << _jsonEscape(c.first) << "\": " << _jsonNumber(c.second);
+      }
+      if (!r.label.empty()) {
+        out << ", \"label\": \"" << _jsonEscape(r.label) << "\"";
+      }
+      out << "}";
+    }
+    out << "\n  ]\n}\n";
+  }
+
+  void _writeCsv(ostream& out, const vector<Result>& results) {
+    vector<string> counterNames = _counterNames(results);
+    out << "name,iterations,real_time,cpu_time,time_unit,items_per_second";
+    for (auto& n : counterNames) {
+      out << "," << n;
+    }
+    out << ",label,error_message\n";
+    for (auto& r : results) {
+      out << "\"" << r.name << "\"," << r.iterations << "," << _jsonNumber(r.realNs) << "," << _jsonNumber(r.cpuNs) << ",ns,";
+      if (r.itemsPerSecond > 0) {
+        out << _jsonNumber(r.itemsPerSecond);
+      }
+      for (auto& n : counterNames) {
+        out << ",";
+        if (r.counters.count(n)) {
+          out << _jsonNumber(r.counters.at(n));
+        }
+      }
+      out << ",\"" << r.label << "\",\"" << r.skipped << "\"\n";
+    }
+  }
+
+  string _humanTime(double ns) {
+    stringstream ss;
+    ss << fixed << setprecision(1);
+    if (ns < 1e3) {
+      ss << ns << " ns";
+    }
+    else if (ns < 1e6) {
+      ss << ns / 1e3 << " us";
+    }
+    else if (ns < 1e9) {
+      ss << ns / 1e6 << " ms";
+    }
+    else {
+      ss << ns / 1e9 << " s";
+    }
+    return ss.str();
+  }
+
+  void _printConsoleLine(const Result& r) {
+    cout << left << setw(50) << r.name;
+    if (!r.skipped.empty()) {
+      cout << " SKIPPED: " << r.skipped << endl;
+      return;
+    }
+    cout << right << setw(12) << _humanTime(r.realNs) << setw(12) << _humanTime(r.cpuNs) << setw(10) << r.iterations;
+    if (r.itemsPerSecond > 0) {
+      cout << "  items/s=" << setprecision(4) << r.itemsPerSecond;
+    }
+    for (auto& c : r.counters) {
+      cout << "  " << c.first << "=" << setprecision(4) << c.second;
+    }
+    if (!r.label.empty()) {
+      cout << "  " << r.label;
+    }
+    cout << endl;
+  }
+
+  Result _aggregate(const vector<Result>& reps, const string& which) {
+    Result a = reps.front();
+    a.aggregate = which;
+    a.name = a.runName + "_" + which;
+    auto stat = [&](function<double(const Result&)> get) -> double {
+      vector<double> v;
+      for (auto& r : reps) {
+        v.push_back(get(r));
+      }
+      double mean = 0;
+      for (double x : v) {
+        mean += x / v.size();
+      }
+      if (which == "mean") {
+        return mean;
+      }
+      if (which == "median") {
+        sort(v.begin(), v.end());
+        return (v.size() % 2) ? v[v.size() / 2] : (v[v.size() / 2 - 1] + v[v.size() / 2]) / 2.;
+      }
+      double ss = 0;
+      for (double x : v) {
+        ss += (x - mean) * (x - mean);
+      }
+      return sqrt(ss / std::max((size_t)1, v.size() - 1)); // stddev
+    };
+    a.realNs = stat([](const Result& r){ return r.realNs; });
+    a.cpuNs = stat([](const Result& r){ return r.cpuNs; });
+    a.itemsPerSecond = stat([](const Result& r){ return r.itemsPerSecond; });
+    for (auto& c : a.counters) {
+      const string key = c.first;
+      c.second = stat([&](const Result& r){ return r.counters.count(key) ? r.counters.at(key) : 0.; });
+    }
+    return a;
+  }
+}
+
+bool RTX::bench::registerBenchmark(const std::string &name, benchmark_fn fn, std::vector<int64_t> args) {
+  Registered r;
+  r.name = name;
+  r.fn = fn;
+  r.args = args.empty() ? vector<int64_t>({0}) : args;
+  _registry().push_back(r);
+  return true;
+}
+
+string RTX::bench::option(const std::string &key, const std::string &defaultValue) {
+  auto found = _options().find(key);
+  return (found == _options().end()) ? defaultValue : found->second;
+}
+
+double RTX::bench::option(const std::string &key, double defaultValue) {
+  auto found = _options().find(key);
+  if (found == _options().end()) {
+    return defaultValue;
+  }
+  char *end;
+  double v = strtod(found->second.c_str(), &end);
+  return (end == found->second.c_str()) ? defaultValue : v;
+}
+
+
+#pragma mark - run
+
+int RTX::bench::runBenchmarks(int argc, const char *argv[]) {
+  string filter, format = "console", outPath;
+  double minTime = 0.5;
+  int repetitions = 1;
+  bool listOnly = false;
+
+  for (int i = 1; i < argc; ++i) {
+    string a(argv[i]);
+    if (a.compare(0, 2, "--") != 0) {
+      cerr << "unrecognized argument: " << a << endl;
+      return 1;
+    }
+    a = a.substr(2);
+    size_t eq = a.find('=');
+    string key = a.substr(0, eq);
+    string value = (eq == string::npos) ? "" : a.substr(eq + 1);
+    if (key == "filter") {
+      filter = value;
+    } else if (key == "min-time") {
+      minTime = atof(value.c_str());
+    } else if (key == "repetitions") {
+      repetitions = std::max(1, atoi(value.c_str()));
+    } else if (key == "format") {
+      format = value;
+    } else if (key == "out") {
+      outPath = value;
+    } else if (key == "list") {
+      listOnly = true;
+    } else {
+      _options()[key] = value;
+    }
+  }
+
+  if (format != "console" && format != "json" && format != "csv") {
+    cerr << "unknown format: " << format << endl;
+    return 1;
+  }
+
+  vector<Result> results;
+  for (auto& b : _registry()) {
+    for (int64_t arg : b.args) {
+      string runName = b.name + ((b.args.size() > 1 || arg != 0) ? "/" + to_string(arg) : "");
+      if (!filter.empty() && runName.find(filter) == string::npos) {
+        continue;
+      }
+      if (listOnly) {
+        cout << runName << endl;
+        continue;
+      }
+      vector<Result> reps;
+      for (int rep = 0; rep < repetitions; ++rep) {
+        State state(arg, minTime);
+        b.fn(state);
+        Result r;
+        r.name = runName;
+        r.runName = runName;
+        r.repetition = rep;
+        r.label = state.label();
+        r.skipped = state.skipped();
+        r.iterations = state.iterations();
+        r.counters = state.counters();
+        double n = (double)std::max((int64_t)1, state.iterations());
+        r.realNs = state.realSeconds() * 1e9 / n;
+        r.cpuNs = state.cpuSeconds() * 1e9 / n;
+        r.itemsPerSecond = (state.itemsPerIteration() > 0 && state.realSeconds() > 0) ? state.itemsPerIteration() * state.iterations() / state.realSeconds() : 0;
+        if (format == "console") {
+          _printConsoleLine(r);
+        }
+        reps.push_back(r);
+        if (!r.skipped.empty()) {
+          break;
+        }
+      }
+      results.insert(results.end(), reps.begin(), reps.end());
+      if (reps.size() > 1) {
+        for (const string which : {"mean", "median", "stddev"}) {
+          Result a = _aggregate(reps, which);
+          if (format == "console") {
+            _printConsoleLine(a);
+          }
+          results.push_back(a);
+        }
+      }
+    }
+  }
+
+  if (listOnly) {
+    return 0;
+  }
+  if (format == "json") {
+    _writeJson(cout, results, argv[0]);
+  }
+  else if (format == "csv") {
+    _writeCsv(cout, results);
+  }
+  if (!outPath.empty()) {
+    ofstream out(outPath);
+    if (!out) {
+      cerr << "could not write results to " << outPath << endl;
+      return 1;
+    }
+    if (outPath.size() > 4 && outPath.compare(outPath.size() - 4, 4, ".csv") == 0) {
+      _writeCsv(out, results);
+    }
+    else {
+      _writeJson(out, results, argv[0]);
+    }
+  }
+  return 0;
+}
+
+int main(int argc, const char * argv[]) {
+  return RTX::bench::runBenchmarks(argc, argv);
+}
@@ -0,0 +1,67 @@
+#ifndef bench_main_h
+#define bench_main_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <chrono>
+#include <ctime>
+#include <stdint.h>
+
+namespace RTX {
+  namespace bench {
+
+    /*!
+     \class State
+     \brief Per-run state handed to a benchmark function.
+
+     Do any setup, then put the measured work in a `while (state.keepRunning()) { ... }` loop. The loop runs until the minimum run time has passed. Anything that shouldn't be measured can go between pauseTiming() and resumeTiming().
+     */
+    class State {
+    public:
+      State(int64_t arg, double minSeconds);
+      int64_t arg() const;                       /// the size argument this run was registered with
+      bool keepRunning();
+      void pauseTiming();
+      void resumeTiming();
+      void setItemsProcessed(int64_t itemsPerIteration);
+      void setCounter(const std::string& name, double value); /// reported as-is, next to the timings
+      void setLabel(const std::string& label);
+      void skip(const std::string& reason);      /// report this run as skipped, e.g. for a missing input file
+
+      // results
+      int64_t iterations() const;
+      double realSeconds() const;
+      double cpuSeconds() const;
+      int64_t itemsPerIteration() const;
+      const std::map<std::string, double>& counters() const;
+      const std::string& label() const;
+      const std::string& skipped() const;
+
+    private:
+      typedef std::chrono::steady_clock clock_t;
+      int64_t _arg, _iterations, _items;
+      double _minSeconds, _real, _cpu;
+      bool _started, _paused;
+      clock_t::time_point _realStart;
+      std::clock_t _cpuStart;
+      std::map<std::string, double> _counters;
+      std::string _label, _skipped;
+    };
+
+    typedef std::function<void(State&)> benchmark_fn;
+
+    bool registerBenchmark(const std::string& name, benchmark_fn fn, std::vector<int64_t> args = {0});
+
+    // command-line options that aren't the harness' own (--key=value) are passed through to benchmarks
+    std::string option(const std::string& key, const std::string& defaultValue);
+    double option(const std::string& key, double defaultValue);
+
+    int runBenchmarks(int argc, const char* argv[]);
+  }
+}
+
+#define RTX_BENCHMARK(fn, ...) static bool _rtx_bench_registered_##fn = RTX::bench::registerBenchmark(#fn, fn, {__VA_ARGS__});
+
+#endif /* bench_main_h */
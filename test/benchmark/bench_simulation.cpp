@@ -0,0 +1,260 @@
+#include "bench_main.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <sys/resource.h>
+
+#include <boost/filesystem.hpp>
+
+#include "EpanetModel.h"
+#include "BufferPointRecord.h"
+#include "ConcreteDbRecords.h"
+#include "ConstantTimeSeries.h"
+#include "SineTimeSeries.h"
+#include "AggregatorTimeSeries.h"
+
+using namespace RTX;
+using namespace RTX::bench;
+using namespace std;
+
+/*
+ end-to-end simulation benchmarks: Model::runExtendedPeriod over synthetic grid networks of
+ increasing size (the argument is the approximate node count).
+
+ the grid is split into vertical strips, one DMA each. strips are joined by a single metered pipe,
+ and a metered pipe feeds the first strip from a reservoir. metered flows are a constant plus a
+ daily sine, reservoir head is constant. states and DMA demands go to one shared record.
+
+   --hours=<n>          simulated duration (default 24)
+   --step=<seconds>     hydraulic and report step (default 3600)
+   --dmas=<n>           number of DMAs (default 4)
+   --record=memory|sqlite   where states are persisted (default memory)
+   --inp=<file>         also run Simulation_inp against this network, with its own boundary conditions
+
+ counters are per simulated step, from the model's own phase timers (filter, solve, fetch, save).
+ the save phase overlaps the next step's filter and solve, so the phases can add up to more than
+ the step time. peak_rss_mb is the process high-water mark, so it only grows across runs.
+ */
+
+static const time_t _simStart = 1499990400; // midnight UTC
+
+static string _gridInpFile(int64_t nNodes, int nDmas, int stepSeconds) {
+  const int side = std::max(2, (int)ceil(sqrt((double)nNodes)));
+  nDmas = std::min(std::max(nDmas, 1), side);
+  auto strip = [&](int col) { return col * nDmas / side; };
+  auto jName = [](int r, int c) { stringstream ss; ss << "J" << r << "_" << c; return ss.str(); };
+
+  stringstream junctions, pipes, coords;
+  for (int r = 0; r < side; ++r) {
+    for (int c = 0; c < side; ++c) {
+      junctions << " " << jName(r,c) << "\t" << 100 + (r + c) % 7 << "\t1" << endl;
+      coords << " " << jName(r,c) << "\t" << c * 100 << "\t" << r * 100 << endl;
+      // strips are only joined along the first row
+      if (c + 1 < side && (strip(c) == strip(c+1) || r == 0)) {
+        pipes << " PH" << r << "_" << c << "\t" << jName(r,c) << "\t" << jName(r,c+1) << "\t300\t8\t100\t0\tOpen" << endl;
+      }
+      if (r + 1 < side) {
+        pipes << " PV" << r << "_" << c << "\t" << jName(r,c) << "\t" << jName(r+1,c) << "\t300\t8\t100\t0\tOpen" << endl;
+      }
+    }
+  }
+
+  boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("rtx-bench-%%%%%%%%.inp");
+  ofstream inp(path.string());
+  inp << "[TITLE]" << endl << " rtx-benchmark grid, " << side * side << " junctions" << endl << endl;
+  inp << "[JUNCTIONS]" << endl << junctions.str() << endl;
+  inp << "[RESERVOIRS]" << endl << " R1\t250" << endl << endl;
+  inp << "[PIPES]" << endl << " P_R1\tR1\t" << jName(0,0) << "\t300\t24\t120\t0\tOpen" << endl << pipes.str() << endl;
+  inp << "[TIMES]" << endl << " Hydraulic Timestep\t" << stepSeconds << " SEC" << endl << " Report Timestep\t" << stepSeconds << " SEC" << endl << endl;
+  inp << "[OPTIONS]" << endl << " Units\tGPM" << endl << " Headloss\tH-W" << endl << endl;
+  inp << "[COORDINATES]" << endl << " R1\t-100\t0" << endl << coords.str() << endl;
+  inp << "[END]" << endl;
+  return path.string();
+}
+
+// metered pipe i carries the demand of every strip downstream of it
+static void _attachGridBoundaries(Model::_sp model, int nDmas, Clock::_sp clock) {
+  const int side = (int)ceil(sqrt((double)model->junctions().size()));
+  nDmas = std::min(std::max(nDmas, 1), side);
+  const double totalDemand = (double)model->junctions().size(); // 1 gpm each
+
+  ConstantTimeSeries::_sp head(new ConstantTimeSeries);
+  head->setValue(250);
+  head->setUnits(RTX_FOOT);
+  head->setClock(clock);
+  for (auto r : model->reservoirs()) {
+    r->setBoundaryHead(head);
+  }
+
+  vector<Pipe::_sp> metered;
+  metered.push_back(dynamic_pointer_cast<Pipe>(model->linkWithName("P_R1")));
+  int lastStrip = 0;
+  for (int c = 0; c + 1 < side; ++c) {
+    int s = (c + 1) * nDmas / side;
+    if (s != lastStrip) {
+      stringstream name;
+      name << "PH0_" << c;
+      metered.push_back(dynamic_pointer_cast<Pipe>(model->linkWithName(name.str())));
+      lastStrip = s;
+    }
+  }
+
+  for (size_t i = 0; i < metered.size(); ++i) {
+    if (!metered[i]) {
+      continue;
+    }
+    double q = totalDemand * (double)(metered.size() - i) / (double)metered.size();
+    ConstantTimeSeries::_sp base(new ConstantTimeSeries);
+    base->setValue(q);
+    base->setUnits(RTX_GALLON_PER_MINUTE);
+    base->setClock(clock);
+    SineTimeSeries::_sp daily(new SineTimeSeries(0.3 * q, 86400));
+    daily->setUnits(RTX_GALLON_PER_MINUTE);
+    daily->setClock(clock);
+    AggregatorTimeSeries::_sp flow(new AggregatorTimeSeries);
+    flow->setUnits(RTX_GALLON_PER_MINUTE);
+    flow->addSource(base);
+    flow->addSource(daily);
+    metered[i]->setFlowMeasure(flow);
+  }
+}
+
+static PointRecord::_sp _stateRecord(const string& kind, size_t capacity, string& sqlitePath) {
+  if (kind == "sqlite") {
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("rtx-bench-%%%%%%%%.sqlite");
+    sqlitePath = path.string();
+    SqlitePointRecord::_sp record(new SqlitePointRecord);
+    record->setConnectionString(sqlitePath);
+    try {
+      record->dbConnect();
+    } catch (const RtxException& e) {
+      cerr << "could not open benchmark database " << sqlitePath << endl;
+      return PointRecord::_sp();
+    }
+    return record;
+  }
+  return PointRecord::_sp(new BufferPointRecord((int)capacity));
+}
+
+static size_t _pointsInRecord(PointRecord::_sp record, TimeRange range) {
+  size_t n = 0;
+  auto ids = record->identifiersAndUnits().get();
+  for (auto& id : *ids) {
+    n += record->pointsInRange(id.first, range).size();
+  }
+  return n;
+}
+
+static double _peakResidentMegabytes() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return (double)usage.ru_maxrss / (1024. * 1024.);
+#else
+  return (double)usage.ru_maxrss / 1024.;
+#endif
+}
+
+static double _meanValue(TimeSeries::_sp ts, TimeRange range) {
+  PointCollection pc(ts->points(range), ts->units());
+  auto raw = pc.raw();
+  return (raw.first == raw.second) ? 0 : PointCollection::mean(raw);
+}
+
+static void _simulationBenchmark(State& state, const string& inpPath, bool syntheticBoundaries) {
+  const int hours = (int)option("hours", 24.);
+  const int step = std::max(1, (int)option("step", 3600.));
+  const int nDmas = (int)option("dmas", 4.);
+  const string recordKind = option("record", string("memory"));
+  const size_t nSteps = (size_t)hours * 3600 / step + 1;
+  const TimeRange range(_simStart, _simStart + hours * 3600);
+
+  size_t persisted = 0, nJunctions = 0;
+  double filter = 0, solve = 0, fetch = 0, save = 0;
+
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    Model::_sp model;
+    try {
+      model.reset(new EpanetModel(inpPath));
+    } catch (const RtxException& e) {
+      state.skip("could not load " + inpPath);
+      state.resumeTiming();
+      break;
+    }
+    nJunctions = model->junctions().size();
+    model->setHydraulicTimeStep(step);
+    model->setReportTimeStep(step);
+
+    Clock::_sp clock(new Clock(step));
+    if (syntheticBoundaries) {
+      _attachGridBoundaries(model, nDmas, clock);
+    }
+    model->initDMAs();
+    model->overrideControls();
+
+    string sqlitePath;
+    PointRecord::_sp record = _stateRecord(recordKind, nSteps + 1, sqlitePath);
+    if (!record) {
+      state.skip("no state record");
+      state.resumeTiming();
+      break;
+    }
+    for (auto e : model->elements()) {
+      e->setRecord(record);
+    }
+    model->setRecordForDmaDemands(record);
+    model->refreshRecordsForModeledStates();
+    model->setRecordForSimulationStats(PointRecord::_sp(new BufferPointRecord((int)nSteps + 1)));
+    state.resumeTiming();
+
+    model->runExtendedPeriod(range.start, range.end);
+
+    state.pauseTiming();
+    persisted += _pointsInRecord(record, range);
+    filter += _meanValue(model->filterWallTime(), range);
+    solve += _meanValue(model->simulationWallTime(), range);
+    fetch += _meanValue(model->fetchWallTime(), range);
+    save += _meanValue(model->saveWallTime(), range);
+    model.reset();
+    record.reset();
+    if (!sqlitePath.empty()) {
+      std::remove(sqlitePath.c_str());
+    }
+    state.resumeTiming();
+  }
+
+  double runs = (double)std::max((int64_t)1, state.iterations());
+  state.setItemsProcessed((int64_t)nSteps);
+  state.setCounter("junctions", (double)nJunctions);
+  state.setCounter("filter_s_per_step", filter / runs);
+  state.setCounter("solve_s_per_step", solve / runs);
+  state.setCounter("fetch_s_per_step", fetch / runs);
+  state.setCounter("save_s_per_step", save / runs);
+  state.setCounter("points_persisted", (double)persisted / runs);
+  if (state.realSeconds() > 0) {
+    state.setCounter("points_per_second", (double)persisted / state.realSeconds());
+  }
+  state.setCounter("peak_rss_mb", _peakResidentMegabytes());
+  state.setLabel(recordKind);
+}
+
+static void Simulation_grid(State& state) {
+  string path = _gridInpFile(state.arg(), (int)option("dmas", 4.), std::max(1, (int)option("step", 3600.)));
+  _simulationBenchmark(state, path, true);
+  std::remove(path.c_str());
+}
+RTX_BENCHMARK(Simulation_grid, 1000, 10000, 100000)
+
+static void Simulation_inp(State& state) {
+  string path = option("inp", string(""));
+  if (path.empty()) {
+    state.skip("no --inp network given");
+    return;
+  }
+  _simulationBenchmark(state, path, false);
+}
+RTX_BENCHMARK(Simulation_inp)